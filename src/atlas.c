@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <complex.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "julia.h"
+#include "atlas.h"
+
+//4 lanes iterated together, every lane with its own pixel, c and escape radius
+typedef struct {
+    __m128 reals;
+    __m128 imags;
+    __m128 cre;
+    __m128 cim;
+    __m128 radius_sqr;
+    __m128i iterations;
+    __m128 running; //all bits set in lanes which did not finish yet
+    int lanes; //bit mask of lanes holding a job, finished lanes keep it until they are refilled
+    size_t x[4]; //pixel of every lane in the mosaic
+    size_t y[4];
+} lane_group;
+
+//jobs taken from the queue but not started yet. The position of the next job is advanced
+//pixel by pixel, only the first job of a chunk is decoded with divisions.
+typedef struct {
+    AtlasQueue* queue;
+    size_t next;
+    size_t end;
+    size_t thumbnail; //thumbnail of job next
+    size_t x; //pixel of job next inside its thumbnail
+    size_t y;
+} job_cursor;
+
+int atlas_create(Atlas* atlas, size_t cols, size_t rows, size_t width, size_t height, float complex start,
+                                                                    float res, unsigned n, float bailout) {
+    atlas->thumbnails = malloc(cols * rows * sizeof(Arguments));
+    if (atlas->thumbnails == NULL) {
+        fprintf(stderr, "Could not allocate memory for an atlas of %lu x %lu thumbnails.\n", cols, rows);
+        return -1;
+    }
+    atlas->cols = cols;
+    atlas->rows = rows;
+    atlas->width = width;
+    atlas->height = height;
+
+    float re_step = (crealf(ATLAS_C_MAX) - crealf(ATLAS_C_MIN)) / cols;
+    float im_step = (cimagf(ATLAS_C_MAX) - cimagf(ATLAS_C_MIN)) / rows;
+    for (size_t row=0; row<rows; row++) {
+        for (size_t col=0; col<cols; col++) {
+            float complex c = (crealf(ATLAS_C_MIN) + (col + 0.5f) * re_step)
+                                    + (cimagf(ATLAS_C_MIN) + (row + 0.5f) * im_step) * I;
+            Arguments* args = &atlas->thumbnails[row * cols + col];
+            init_args(args, c, start, res, n);
+            //same radius as init_family where the bailout is valid for c
+            if (bailout != 0.0f && bailout * bailout >= args->radius_sqr) {
+                args->bailout = bailout;
+                args->radius_sqr = bailout * bailout;
+            }
+        }
+    }
+    return 0;
+}
+
+void atlas_destroy(Atlas* atlas) {
+    free(atlas->thumbnails);
+    atlas->thumbnails = NULL;
+}
+
+void atlas_queue_init(AtlasQueue* queue, const Atlas* atlas) {
+    atomic_init(&queue->next, 0);
+    queue->total = atlas->cols * atlas->rows * atlas->width * atlas->height;
+}
+
+/**
+ * @brief take the next job, a chunk of ATLAS_CHUNK jobs is taken from the queue if the cursor is empty.
+ * Position of the job is left in cursor->thumbnail, cursor->x and cursor->y until the next call.
+ *
+ * @return false if the queue is empty
+ */
+static bool take_job(job_cursor* cursor, const Atlas* atlas) {
+    if (cursor->next == cursor->end) {
+        size_t first = atomic_fetch_add(&cursor->queue->next, ATLAS_CHUNK);
+        if (first >= cursor->queue->total) {
+            return false;
+        }
+        size_t pixels = atlas->width * atlas->height;
+        cursor->next = first;
+        cursor->end = (first + ATLAS_CHUNK < cursor->queue->total) ? first + ATLAS_CHUNK : cursor->queue->total;
+        cursor->thumbnail = first / pixels;
+        cursor->x = (first % pixels) % atlas->width;
+        cursor->y = (first % pixels) / atlas->width;
+    } else if (++cursor->x == atlas->width) {
+        cursor->x = 0;
+        if (++cursor->y == atlas->height) {
+            cursor->y = 0;
+            cursor->thumbnail++;
+        }
+    }
+    cursor->next++;
+    return true;
+}
+
+/**
+ * @return all bits set in the lanes of mask
+ */
+static inline __m128 lane_mask(int mask) {
+    __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(mask), bits), bits));
+}
+
+/**
+ * @brief write the results of the finished lanes into their thumbnails of the mosaic (same mapping as
+ * julia_render) and load the starting point, c and escape radius of the next jobs into them.
+ * Lanes are parked if there are no jobs left.
+ *
+ * @param finished bit mask of the lanes to refill
+ */
+static void refill(lane_group* group, int finished, const Atlas* atlas, job_cursor* cursor, Image* mosaic, unsigned n) {
+    unsigned iterations[4];
+    _mm_storeu_si128((__m128i*) iterations, group->iterations);
+    //fresh values of refilled lanes, the other lanes are taken from the group
+    float reals[4] = {0}, imags[4] = {0}, cre[4] = {0}, cim[4] = {0}, radius_sqr[4] = {0};
+
+    for (int lane=0; lane<4; lane++) {
+        if (!(finished & (1 << lane))) {
+            continue;
+        }
+        if (group->lanes & (1 << lane)) {
+            unsigned value = iterations[lane];
+            if (value == n) {
+                value = BLACK;
+            } else if (value == 0) {
+                value = 1;
+            }
+            color_pixel(mosaic, group->y[lane], group->x[lane], value);
+        }
+        if (!take_job(cursor, atlas)) {
+            //parked lanes never count as finished, their values are not used
+            group->lanes &= ~(1 << lane);
+            continue;
+        }
+        const Arguments* args = &atlas->thumbnails[cursor->thumbnail];
+        //same coordinates as julia_render
+        reals[lane] = crealf(args->start) + cursor->x * args->res;
+        imags[lane] = cimagf(args->start) + cursor->y * args->res;
+        cre[lane] = crealf(args->c);
+        cim[lane] = cimagf(args->c);
+        radius_sqr[lane] = args->radius_sqr;
+        group->x[lane] = (cursor->thumbnail % atlas->cols) * atlas->width + cursor->x;
+        group->y[lane] = (cursor->thumbnail / atlas->cols) * atlas->height + cursor->y;
+        group->lanes |= 1 << lane;
+    }
+    __m128 keep = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_setzero_si128(), _mm_setzero_si128()));
+    keep = _mm_andnot_ps(lane_mask(finished), keep);
+    group->reals = _mm_or_ps(_mm_and_ps(keep, group->reals), _mm_andnot_ps(keep, _mm_loadu_ps(reals)));
+    group->imags = _mm_or_ps(_mm_and_ps(keep, group->imags), _mm_andnot_ps(keep, _mm_loadu_ps(imags)));
+    group->cre = _mm_or_ps(_mm_and_ps(keep, group->cre), _mm_andnot_ps(keep, _mm_loadu_ps(cre)));
+    group->cim = _mm_or_ps(_mm_and_ps(keep, group->cim), _mm_andnot_ps(keep, _mm_loadu_ps(cim)));
+    group->radius_sqr = _mm_or_ps(_mm_and_ps(keep, group->radius_sqr), _mm_andnot_ps(keep, _mm_loadu_ps(radius_sqr)));
+    group->iterations = _mm_and_si128((__m128i) keep, group->iterations);
+    group->running = lane_mask(group->lanes);
+}
+
+/**
+ * @brief one iteration of a group, same operations as the main iterations loop of julia_render.
+ * Lanes which escape or stay inside for n steps stop counting, their iteration numbers are kept
+ * until the lane is refilled.
+ *
+ * @return bit mask of the lanes which are still running
+ */
+static inline int iterate_group(lane_group* group, __m128 twos, __m128i ones, __m128i ns) {
+    __m128 _re = _mm_mul_ps(group->reals, group->reals);
+    __m128 _im = _mm_mul_ps(group->imags, group->imags);
+    __m128 inside = _mm_and_ps(_mm_cmple_ps(_mm_add_ps(_re, _im), group->radius_sqr), group->running);
+    group->iterations = _mm_add_epi32(group->iterations, _mm_and_si128(ones, (__m128i) inside));
+    __m128 full = _mm_castsi128_ps(_mm_cmpeq_epi32(group->iterations, ns));
+    group->running = _mm_andnot_ps(full, inside);
+
+    __m128 imags = _mm_mul_ps(group->reals, group->imags);
+    imags = _mm_mul_ps(imags, twos);
+    group->imags = _mm_add_ps(imags, group->cim);
+    group->reals = _mm_add_ps(_mm_sub_ps(_re, _im), group->cre);
+    return _mm_movemask_ps(group->running);
+}
+
+void julia_atlas_render(const Atlas* atlas, Image* mosaic, AtlasQueue* queue) {
+    unsigned n = atlas->thumbnails[0].n;
+    job_cursor cursor = {queue, 0, 0, 0, 0, 0};
+    __m128 twos = _mm_set1_ps(2.0f);
+    __m128i ones = _mm_set1_epi32(1);
+    __m128i ns = _mm_set1_epi32(n);
+
+    lane_group groups[ATLAS_GROUPS];
+    for (int g=0; g<ATLAS_GROUPS; g++) {
+        groups[g].lanes = 0;
+        refill(&groups[g], 15, atlas, &cursor, mosaic, n);
+    }
+
+    //groups do not depend on each other, so their multiplications overlap (see julia_interleaved_render)
+    bool running = true;
+    while (running) {
+        running = false;
+        for (int g=0; g<ATLAS_GROUPS; g++) {
+            lane_group* group = &groups[g];
+            if (group->lanes == 0) {
+                continue;
+            }
+            running = true;
+            int finished = group->lanes & ~iterate_group(group, twos, ones, ns);
+            if (finished != 0) {
+                refill(group, finished, atlas, &cursor, mosaic, n);
+            }
+        }
+    }
+}
+
+//one thread rendering from the shared queue
+typedef struct {
+    const Atlas* atlas;
+    Image* mosaic;
+    AtlasQueue* queue;
+} atlas_worker;
+
+static void* atlas_worker_run(void* arg) {
+    atlas_worker* worker = arg;
+    julia_atlas_render(worker->atlas, worker->mosaic, worker->queue);
+    return NULL;
+}
+
+int render_atlas(const Atlas* atlas, Image* mosaic, int threads) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    if (ids == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d atlas workers.\n", threads);
+        return -1;
+    }
+    AtlasQueue queue;
+    atlas_queue_init(&queue, atlas);
+    atlas_worker worker = {atlas, mosaic, &queue};
+
+    //the calling thread renders as well, jobs of threads which could not be created are taken by the others
+    int started = 0;
+    for (int t=1; t<threads; t++) {
+        if (pthread_create(&ids[t], NULL, atlas_worker_run, &worker) != 0) {
+            break;
+        }
+        started++;
+    }
+    atlas_worker_run(&worker);
+    for (int t=1; t<=started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    free(ids);
+    return 0;
+}
+
+int write_atlas_files(const Atlas* atlas, const unsigned char* mosaic, const char* path) {
+    size_t base = strlen(path) - strlen(".bmp");
+    size_t name_size = base + 64;
+    char* name = malloc(name_size);
+    unsigned char* thumbnail = malloc(atlas->width * atlas->height * 3);
+    if (name == NULL || thumbnail == NULL) {
+        fprintf(stderr, "Could not allocate memory for thumbnails sized %lu x %lu.\n", atlas->width, atlas->height);
+        free(name);
+        free(thumbnail);
+        return -1;
+    }
+    size_t row_bytes = atlas->width * 3;
+    size_t mosaic_row_bytes = atlas->cols * row_bytes;
+    for (size_t row=0; row<atlas->rows; row++) {
+        for (size_t col=0; col<atlas->cols; col++) {
+            for (size_t y=0; y<atlas->height; y++) {
+                memcpy(thumbnail + y * row_bytes, mosaic + (row * atlas->height + y) * mosaic_row_bytes + col * row_bytes,
+                                                                                                        row_bytes);
+            }
+            snprintf(name, name_size, "%.*s_%lu_%lu.bmp", (int) base, path, col, row);
+            if (generateBitmapImage(thumbnail, atlas->height, atlas->width, name) != 0) {
+                free(name);
+                free(thumbnail);
+                return -1;
+            }
+        }
+    }
+    free(name);
+    free(thumbnail);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef MY_ATLAS
+#define MY_ATLAS
+
+#include <stdatomic.h>
+
+#include "util.h"
+
+//c values of an atlas cover this rectangle of the mandelbrot set, thumbnail (0, 0) has the smallest c
+#define ATLAS_C_MIN (-2.0f - 1.25f * I)
+#define ATLAS_C_MAX (0.5f + 1.25f * I)
+//jobs (pixels) a worker takes from the shared queue at once
+#define ATLAS_CHUNK 1024
+//independent groups of 4 lanes iterated in the same loop
+#define ATLAS_GROUPS 3
+
+//thumbnails of julia sets for a grid of c values, rendered together into one mosaic
+typedef struct {
+    Arguments* thumbnails; //arguments of every thumbnail, same start, res and n, own c and escape radius
+    size_t cols; //thumbnails per row of the mosaic
+    size_t rows;
+    size_t width; //size of one thumbnail
+    size_t height;
+} Atlas;
+
+//queue of (thumbnail, pixel) jobs shared by all workers, job j is pixel j % (width * height)
+//of thumbnail j / (width * height)
+typedef struct {
+    atomic_size_t next;
+    size_t total;
+} AtlasQueue;
+
+/**
+ * @brief create the arguments of a cols x rows atlas. The c value of a thumbnail is the centre of its
+ * cell in [ATLAS_C_MIN, ATLAS_C_MAX], thumbnail (col, row) is at (col, row) in the mosaic.
+ *
+ * @param atlas atlas to fill
+ * @param cols thumbnails per row
+ * @param rows thumbnails per column
+ * @param width width of one thumbnail
+ * @param height height of one thumbnail
+ * @param start starting point of every thumbnail
+ * @param res step size of every thumbnail
+ * @param n maximum number of iterations
+ * @param bailout escape radius, 0 or thumbnails with |c| > bailout use max{|c|, 2}
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int atlas_create(Atlas* atlas, size_t cols, size_t rows, size_t width, size_t height, float complex start,
+                                                                    float res, unsigned n, float bailout);
+
+/**
+ * @brief free the thumbnail arguments of atlas
+ */
+void atlas_destroy(Atlas* atlas);
+
+/**
+ * @brief initialise a queue holding every pixel of every thumbnail of atlas
+ */
+void atlas_queue_init(AtlasQueue* queue, const Atlas* atlas);
+
+/**
+ * @brief render jobs of the queue until it is empty. Every sse lane carries its own pixel, c and
+ * escape radius, so pixels of different thumbnails share one register. A lane whose pixel escaped
+ * (or reached n) writes its result and is refilled with the next job at once, while the other lanes
+ * keep iterating. ATLAS_GROUPS independent groups of 4 lanes are iterated in the same loop, so
+ * their multiplications overlap as in julia_interleaved_render. Every pixel is computed with the same operations as julia_render with the c of its
+ * thumbnail, results are bit-exact with it.
+ * Several threads can render from the same queue at the same time.
+ *
+ * @param atlas atlas to render
+ * @param mosaic image of (cols * width) x (rows * height) pixels, written with color_pixel
+ * @param queue jobs to render
+ */
+void julia_atlas_render(const Atlas* atlas, Image* mosaic, AtlasQueue* queue);
+
+/**
+ * @brief render the whole atlas with several threads taking jobs from one queue
+ *
+ * @param atlas atlas to render
+ * @param mosaic image of (cols * width) x (rows * height) pixels
+ * @param threads number of threads including the calling thread
+ * @return 0 on success, -1 if memory for workers could not be allocated
+ */
+int render_atlas(const Atlas* atlas, Image* mosaic, int threads);
+
+/**
+ * @brief write every thumbnail of a rendered mosaic into its own file named
+ * <path without .bmp>_<col>_<row>.bmp
+ *
+ * @param atlas rendered atlas
+ * @param mosaic rgb buffer of the mosaic
+ * @param path file name of the mosaic
+ * @return 0 on success, -1 if memory could not be allocated or a file could not be written
+ */
+int write_atlas_files(const Atlas* atlas, const unsigned char* mosaic, const char* path);
+
+#endif
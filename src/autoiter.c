@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "util.h"
+#include "sample.h"
+#include "autoiter.h"
+
+int choose_iterations(Arguments* args, size_t width, size_t height, AutoIterations* result) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    size_t count = sample_count(width, height, SAMPLE_STRIDE);
+    unsigned* values = malloc(count * sizeof(unsigned));
+    //number of samples escaping after k steps
+    size_t* histogram = calloc(AUTO_N_CAP, sizeof(size_t));
+    if (values == NULL || histogram == NULL) {
+        fprintf(stderr, "Could not allocate memory for the pre-pass of -n auto.\n");
+        free(values);
+        free(histogram);
+        return -1;
+    }
+    Arguments capped = *args;
+    capped.n = AUTO_N_CAP;
+    if (sample_grid(&capped, width, height, SAMPLE_STRIDE, values) == 0) {
+        free(values);
+        free(histogram);
+        return -1;
+    }
+
+    size_t escaped = 0;
+    for (size_t i=0; i<count; i++) {
+        if (values[i] != BLACK) {
+            histogram[values[i]]++;
+            escaped++;
+        }
+    }
+    //with limit n, samples which need k >= n steps are drawn black. Lower n as long as few enough of them are.
+    size_t allowed = (size_t) (AUTO_N_AMBIGUOUS * count);
+    unsigned n = AUTO_N_CAP;
+    size_t ambiguous = 0;
+    while (n > AUTO_N_MIN && ambiguous + histogram[n - 1] <= allowed) {
+        ambiguous += histogram[n - 1];
+        n--;
+    }
+    free(values);
+    free(histogram);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->n = n;
+    result->samples = count;
+    result->escaped = escaped;
+    result->ambiguous = ambiguous;
+    result->seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    return 0;
+}
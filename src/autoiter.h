@@ -0,0 +1,38 @@
+#ifndef MY_AUTOITER
+#define MY_AUTOITER
+
+#include "util.h"
+
+//iteration cap of the pre-pass of -n auto, the chosen n is never larger
+#define AUTO_N_CAP 16384
+//smallest n chosen
+#define AUTO_N_MIN 32
+//largest share of samples which may escape after more than n steps (drawn black although outside)
+#define AUTO_N_AMBIGUOUS 0.002
+
+//result of choose_iterations
+typedef struct {
+    unsigned n; //chosen maximum number of iterations
+    size_t samples; //pixels iterated by the pre-pass
+    size_t escaped; //samples which escaped within AUTO_N_CAP steps
+    size_t ambiguous; //samples which escape after more than n steps, drawn as part of the set with n
+    double seconds; //time of the pre-pass
+} AutoIterations;
+
+/**
+ * @brief choose the maximum number of iterations of a render from a sparse pre-pass.
+ * Every SAMPLE_STRIDE-th pixel in x and y is iterated with a cap of AUTO_N_CAP steps. With a limit
+ * of n, samples escaping after more than n steps are ambiguous: they are outside of the julia set,
+ * but drawn like the set. n is the smallest value (at least AUTO_N_MIN) for which at most
+ * AUTO_N_AMBIGUOUS of all samples are ambiguous. Samples which do not escape within the cap are
+ * counted as part of the set, a larger n would not change them.
+ *
+ * @param args julia arguments of the render, args->n is ignored
+ * @param width width of the image
+ * @param height height of the image
+ * @param result chosen n and statistics of the pre-pass
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int choose_iterations(Arguments* args, size_t width, size_t height, AutoIterations* result);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <complex.h>
+#include <time.h>
+
+#include "util.h"
+#include "plan.h"
+#include "render.h"
+#include "performanz.h"
+#include "autotune.h"
+
+//classes of a profile: limits and the typical size and n of the workload of every class
+static const size_t size_limits[TUNE_SIZE_CLASSES] = {320 * 320, 800 * 800, 0};
+static const size_t tune_sides[TUNE_SIZE_CLASSES] = {192, 512, 1024};
+static const unsigned n_limits[TUNE_N_CLASSES] = {250, 1000, 0};
+static const unsigned tune_n[TUNE_N_CLASSES] = {100, 500, 2000};
+//indices into c_values[] of the workloads, from cheap to expensive
+static const int tune_c[] = {0, 3, 6, 9};
+static const size_t band_heights[] = {4, 16, 64};
+
+#define TUNE_C_COUNT ((int) (sizeof(tune_c) / sizeof(tune_c[0])))
+#define BAND_HEIGHT_COUNT ((int) (sizeof(band_heights) / sizeof(band_heights[0])))
+
+/**
+ * @brief time the workload of a class with one configuration. Stops as soon as the time exceeds limit.
+ *
+ * @return seconds of the workload (more than limit if stopped early), -1 on failure
+ */
+static double time_workload(size_t side, unsigned n, unsigned char* buffer, int implementation, int threads,
+                                                                        size_t band_height, double limit) {
+    float complex start = -1.5 + -1.5 * I;
+    double total = 0.0;
+    for (int i=0; i<TUNE_C_COUNT; i++) {
+        Arguments args;
+        init_args(&args, c_values[tune_c[i]], start, 3.0f/side, n);
+        JuliaParams params;
+        plan_params(&params, implementation, &args, side, side);
+        JuliaPlan* plan = julia_plan_create(&params);
+        if (plan == NULL) {
+            return -1.0;
+        }
+        //the first render also warms up caches and threads
+        double fastest = DBL_MAX;
+        for (int r=0; r<TUNE_REPETITIONS; r++) {
+            struct timespec render_start;
+            struct timespec render_end;
+            clock_gettime(CLOCK_MONOTONIC, &render_start);
+            if (render_parallel(plan, buffer, NULL, NULL, threads, band_height) != 0) {
+                julia_plan_destroy(plan);
+                return -1.0;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &render_end);
+            double t = render_end.tv_sec - render_start.tv_sec + 1e-9 * (render_end.tv_nsec - render_start.tv_nsec);
+            fastest = (t < fastest) ? t : fastest;
+        }
+        julia_plan_destroy(plan);
+        total += fastest;
+        if (total > limit) {
+            break;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief time one candidate configuration and keep it in best if it is faster
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int try_candidate(TuneEntry* best, size_t side, unsigned n, unsigned char* buffer, int implementation,
+                                                                        int threads, size_t band_height) {
+    double limit = best->seconds * (1.0 - TUNE_MIN_GAIN);
+    double t = time_workload(side, n, buffer, implementation, threads, band_height, limit);
+    if (t < 0.0) {
+        return -1;
+    }
+    bool faster = t < limit;
+    fprintf(stderr, "Autotune %lu x %lu, n %u: %s, %d threads, bands of %lu rows: ", side, side, n,
+                                                            names[implementation], threads, band_height);
+    if (faster) {
+        fprintf(stderr, "%f s\n", t);
+        best->implementation = implementation;
+        best->threads = threads;
+        best->band_height = band_height;
+        best->seconds = t;
+    } else {
+        fprintf(stderr, "dropped\n");
+    }
+    return 0;
+}
+
+void profile_clear(Profile* profile) {
+    profile->count = 0;
+    for (int i=0; i<PROFILE_RATES; i++) {
+        profile->rates[i] = (JuliaRate) {0.0, 0.0, 0.0};
+    }
+}
+
+int autotune(Profile* profile, int max_threads) {
+    size_t largest = tune_sides[TUNE_SIZE_CLASSES - 1];
+    unsigned char* buffer = malloc(largest * largest * 3);
+    if (buffer == NULL) {
+        fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", largest, largest);
+        return -1;
+    }
+
+    profile_clear(profile);
+    int status = 0;
+    for (int s=0; s<TUNE_SIZE_CLASSES && status == 0; s++) {
+        for (int k=0; k<TUNE_N_CLASSES && status == 0; k++) {
+            TuneEntry* best = &profile->entries[profile->count++];
+            best->max_pixels = size_limits[s];
+            best->max_n = n_limits[k];
+            best->implementation = INTRIN_V0;
+            best->threads = 1;
+            best->band_height = DEFAULT_BAND_HEIGHT;
+            best->seconds = DBL_MAX;
+            size_t side = tune_sides[s];
+            unsigned n = tune_n[k];
+
+            //kernel first, threads and bands of the fastest kernel after it.
+            //fma kernels are not bit-exact with the others, a profile must not change the pixels of a render
+            for (int i=0; i<kernel_count && status == 0; i++) {
+                if (julia_implementation_supported(i) && !implementation_uses_fma(i)) {
+                    status = try_candidate(best, side, n, buffer, i, 1, DEFAULT_BAND_HEIGHT);
+                }
+            }
+            int implementation = best->implementation;
+            for (int t=2; t<max_threads && status == 0; t*=2) {
+                status = try_candidate(best, side, n, buffer, implementation, t, DEFAULT_BAND_HEIGHT);
+            }
+            if (max_threads > 1 && status == 0) {
+                status = try_candidate(best, side, n, buffer, implementation, max_threads, DEFAULT_BAND_HEIGHT);
+            }
+            int threads = best->threads;
+            for (int b=0; b<BAND_HEIGHT_COUNT && status == 0; b++) {
+                if (band_heights[b] != DEFAULT_BAND_HEIGHT) {
+                    status = try_candidate(best, side, n, buffer, implementation, threads, band_heights[b]);
+                }
+            }
+        }
+    }
+    free(buffer);
+
+    //rates for --estimate, which renders with the implementation of the profile or the default
+    for (int i=0; i<=profile->count && status == 0; i++) {
+        int implementation = (i < profile->count) ? profile->entries[i].implementation : INTRIN_V0;
+        if (profile->rates[implementation].giter_per_s == 0.0) {
+            fprintf(stderr, "Autotune: calibrating the rate of %s\n", names[implementation]);
+            status = julia_calibrate(implementation, &profile->rates[implementation]);
+        }
+    }
+    return status;
+}
+
+int profile_write(const Profile* profile, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not create file %s.\n", path);
+        return -1;
+    }
+    //one entry per line, so that profile_read does not need a complete json parser
+    fprintf(file, "{\"profile\": [\n");
+    for (int i=0; i<profile->count; i++) {
+        const TuneEntry* e = &profile->entries[i];
+        fprintf(file, "  {\"max_pixels\": %lu, \"max_n\": %u, \"implementation\": %d, \"kernel\": \"%s\", "
+                      "\"band_height\": %lu, \"threads\": %d, \"seconds\": %.9f}%s\n", e->max_pixels, e->max_n,
+                        e->implementation, names[e->implementation], e->band_height, e->threads, e->seconds,
+                        (i == profile->count - 1) ? "" : ",");
+    }
+    fprintf(file, "], \"rates\": [\n");
+    bool first = true;
+    for (int i=0; i<PROFILE_RATES && i<kernel_count; i++) {
+        const JuliaRate* r = &profile->rates[i];
+        if (r->giter_per_s > 0.0) {
+            fprintf(file, "%s  {\"implementation\": %d, \"kernel\": \"%s\", \"giter_per_s\": %.6f, "
+                          "\"ns_per_pixel\": %.6f, \"error\": %.6f}", first ? "" : ",\n", i, names[i],
+                            r->giter_per_s, r->ns_per_pixel, r->error);
+            first = false;
+        }
+    }
+    fprintf(file, "%s]}\n", first ? "" : "\n");
+    fclose(file);
+    return 0;
+}
+
+int profile_read(Profile* profile, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open profile %s.\n", path);
+        return -1;
+    }
+
+    char line[256];
+    profile_clear(profile);
+    bool rates = false;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char* giter = strstr(line, "\"giter_per_s\": ");
+        if (giter != NULL) {
+            //line of a rate
+            int i;
+            JuliaRate r;
+            char* implementation = strstr(line, "\"implementation\": ");
+            char* ns = strstr(line, "\"ns_per_pixel\": ");
+            char* error = strstr(line, "\"error\": ");
+            if (implementation != NULL && ns != NULL && error != NULL &&
+                sscanf(implementation, "\"implementation\": %d", &i) == 1 &&
+                sscanf(giter, "\"giter_per_s\": %lf", &r.giter_per_s) == 1 &&
+                sscanf(ns, "\"ns_per_pixel\": %lf", &r.ns_per_pixel) == 1 &&
+                sscanf(error, "\"error\": %lf", &r.error) == 1 &&
+                i >= 0 && i < PROFILE_RATES && i < kernel_count && r.giter_per_s > 0.0 && r.ns_per_pixel >= 0.0 &&
+                r.error >= 0.0) {
+                profile->rates[i] = r;
+                rates = true;
+            }
+            continue;
+        }
+        if (profile->count == TUNE_CLASSES) {
+            continue;
+        }
+        char* pixels = strstr(line, "\"max_pixels\": ");
+        char* n = strstr(line, "\"max_n\": ");
+        char* implementation = strstr(line, "\"implementation\": ");
+        char* band_height = strstr(line, "\"band_height\": ");
+        char* threads = strstr(line, "\"threads\": ");
+        char* seconds = strstr(line, "\"seconds\": ");
+        if (pixels == NULL || n == NULL || implementation == NULL || band_height == NULL || threads == NULL
+                                                                                        || seconds == NULL) {
+            continue;
+        }
+        TuneEntry* e = &profile->entries[profile->count];
+        if (sscanf(pixels, "\"max_pixels\": %lu", &e->max_pixels) == 1 &&
+            sscanf(n, "\"max_n\": %u", &e->max_n) == 1 &&
+            sscanf(implementation, "\"implementation\": %d", &e->implementation) == 1 &&
+            sscanf(band_height, "\"band_height\": %lu", &e->band_height) == 1 &&
+            sscanf(threads, "\"threads\": %d", &e->threads) == 1 &&
+            sscanf(seconds, "\"seconds\": %lf", &e->seconds) == 1 &&
+            e->implementation >= 0 && e->implementation < kernel_count &&
+            julia_implementation_supported(e->implementation) && !implementation_uses_fma(e->implementation) &&
+            e->band_height > 0 && e->threads > 0) {
+            profile->count++;
+        }
+    }
+    fclose(file);
+
+    if (profile->count == 0 && !rates) {
+        fprintf(stderr, "Error: Profile %s has no usable entries.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+const TuneEntry* profile_lookup(const Profile* profile, size_t pixels, unsigned n) {
+    for (int i=0; i<profile->count; i++) {
+        const TuneEntry* e = &profile->entries[i];
+        if ((e->max_pixels == 0 || pixels <= e->max_pixels) && (e->max_n == 0 || n <= e->max_n)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+char* profile_default_path(char* path, size_t size) {
+    const char* home = getenv("HOME");
+    if (home == NULL) {
+        return NULL;
+    }
+    int length = snprintf(path, size, "%s/%s", home, PROFILE_FILE);
+    return (length > 0 && (size_t) length < size) ? path : NULL;
+}
+
+void profile_print(const Profile* profile, FILE* out) {
+    fprintf(out, "%-14s %-8s %-20s %-8s %s\n", "pixels", "n", "kernel", "threads", "band height");
+    for (int i=0; i<profile->count; i++) {
+        const TuneEntry* e = &profile->entries[i];
+        char pixels[32];
+        char n[32];
+        if (e->max_pixels == 0) {
+            strcpy(pixels, "any");
+        } else {
+            snprintf(pixels, sizeof(pixels), "<= %lu", e->max_pixels);
+        }
+        if (e->max_n == 0) {
+            strcpy(n, "any");
+        } else {
+            snprintf(n, sizeof(n), "<= %u", e->max_n);
+        }
+        fprintf(out, "%-14s %-8s %-20s %-8d %lu\n", pixels, n, names[e->implementation], e->threads, e->band_height);
+    }
+    fprintf(out, "\n%-20s %-10s %-12s %s\n", "kernel", "Giter/s", "ns/pixel", "error");
+    for (int i=0; i<PROFILE_RATES && i<kernel_count; i++) {
+        const JuliaRate* r = &profile->rates[i];
+        if (r->giter_per_s > 0.0) {
+            fprintf(out, "%-20s %-10.4f %-12.2f %.1f%%\n", names[i], r->giter_per_s, r->ns_per_pixel, 100 * r->error);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef MY_AUTOTUNE
+#define MY_AUTOTUNE
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "julia.h"
+
+//file of the machine profile in the home directory, loaded by default
+#define PROFILE_FILE ".julia_profile"
+//image size classes and iteration limit classes of a profile, one configuration per pair
+#define TUNE_SIZE_CLASSES 3
+#define TUNE_N_CLASSES 3
+#define TUNE_CLASSES (TUNE_SIZE_CLASSES * TUNE_N_CLASSES)
+//timed renders per c value and candidate, the fastest one counts
+#define TUNE_REPETITIONS 2
+//a candidate replaces the best configuration so far only if it is faster by this share, so that
+//timing noise does not move away from the defaults, which are tried first
+#define TUNE_MIN_GAIN 0.02
+//implementations with a calibrated rate in a profile, INTRIN_V0 to INTRIN_MORTON
+#define PROFILE_RATES (INTRIN_MORTON + 1)
+
+//best configuration of one class of renders
+typedef struct {
+    size_t max_pixels; //largest image of the class in pixels, 0: no limit
+    unsigned max_n; //largest iteration limit of the class, 0: no limit
+    int implementation;
+    size_t band_height; //rows per band of the parallel renderer
+    int threads;
+    double seconds; //time of the workload of the class with this configuration
+} TuneEntry;
+
+//machine profile written by --autotune
+typedef struct {
+    TuneEntry entries[TUNE_CLASSES];
+    int count;
+    //rate of every implementation for julia_estimate, giter_per_s 0 if it was not calibrated
+    JuliaRate rates[PROFILE_RATES];
+} Profile;
+
+/**
+ * @brief empty profile without entries and rates
+ */
+void profile_clear(Profile* profile);
+
+/**
+ * @brief find the fastest configuration of this machine for every class of image size and
+ * iteration limit. Every class has a workload of four c values of c_values[] with a typical size
+ * and n of the class, whole views as in benchmark_suite. The search is staged: all supported
+ * implementations which are bit-exact with INTRIN_V0 (no fma kernels) are timed with one thread and bands of DEFAULT_BAND_HEIGHT rows, then the
+ * fastest one with 1, 2, 4 ... max_threads threads, then with several band heights. A candidate
+ * is dropped as soon as its time exceeds the best time so far, so slow kernels cost little.
+ * At last the rates of INTRIN_V0 and of the chosen implementations are calibrated for --estimate.
+ * Takes about a minute.
+ * Progress is printed to stderr.
+ *
+ * @param profile best configurations are written here
+ * @param max_threads largest number of threads tried
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int autotune(Profile* profile, int max_threads);
+
+/**
+ * @brief write a profile as json file, one entry or rate per line
+ *
+ * @return 0 on success, -1 if the file could not be written
+ */
+int profile_write(const Profile* profile, const char* path);
+
+/**
+ * @brief read a profile written by profile_write. Entries with implementations which are not
+ * supported by this processor are skipped, so that a profile of another machine does no harm.
+ * Entries with fma implementations (written by older versions) are skipped as well, their pixels differ.
+ * A profile may only hold rates, written by --estimate.
+ *
+ * @return 0 on success, -1 if the file could not be read or has neither entries nor rates
+ */
+int profile_read(Profile* profile, const char* path);
+
+/**
+ * @brief the configuration of the class of an image with the given pixels and iteration limit
+ *
+ * @return entry of the first class containing the render, NULL if there is none
+ */
+const TuneEntry* profile_lookup(const Profile* profile, size_t pixels, unsigned n);
+
+/**
+ * @brief path of the default profile, PROFILE_FILE in the home directory
+ *
+ * @param path the path is written here
+ * @param size size of path
+ * @return path, NULL if HOME is not set or the path does not fit
+ */
+char* profile_default_path(char* path, size_t size);
+
+/**
+ * @brief print the configurations and rates of a profile as tables
+ */
+void profile_print(const Profile* profile, FILE* out);
+
+#endif
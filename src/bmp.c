@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
  
 //Adapted from Minhas Kamal's contribution in the following discussion:
 //https://stackoverflow.com/questions/2654480/writing-bmp-image-in-pure-c-c-without-other-libraries
@@ -9,10 +10,10 @@ const int BYTES_PER_PIXEL = 3; /// red, green, & blue
 const int FILE_HEADER_SIZE = 14;
 const int INFO_HEADER_SIZE = 40;
 
-unsigned char* createBitmapFileHeader(int height, int stride);
-unsigned char* createBitmapInfoHeader(int height, int width);
+void createBitmapFileHeader(unsigned char* fileHeader, int height, int stride);
+void createBitmapInfoHeader(unsigned char* infoHeader, int height, int width);
  
-void generateBitmapImage (unsigned char* image, int height, int width, char* imageFileName) {
+int generateBitmapImage (unsigned char* image, int height, int width, char* imageFileName) {
     int widthInBytes = width * BYTES_PER_PIXEL;
 
     unsigned char padding[3] = {0, 0, 0};
@@ -24,13 +25,16 @@ void generateBitmapImage (unsigned char* image, int height, int width, char* ima
 
     if (imageFile == NULL) {
         fprintf(stderr, "Error: Could not create file %s.\n", imageFileName);
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
-    unsigned char* fileHeader = createBitmapFileHeader(height, stride);
+    //headers are kept on the stack, so that several images can be written at the same time
+    unsigned char fileHeader[14];
+    createBitmapFileHeader(fileHeader, height, stride);
     fwrite(fileHeader, 1, FILE_HEADER_SIZE, imageFile);
 
-    unsigned char* infoHeader = createBitmapInfoHeader(height, width);
+    unsigned char infoHeader[40];
+    createBitmapInfoHeader(infoHeader, height, width);
     fwrite(infoHeader, 1, INFO_HEADER_SIZE, imageFile);
 
     int i;
@@ -39,18 +43,18 @@ void generateBitmapImage (unsigned char* image, int height, int width, char* ima
         fwrite(padding, 1, paddingSize, imageFile);
     }
 
-    fclose(imageFile);
+    if (fclose(imageFile) != 0) {
+        fprintf(stderr, "Error: Could not write file %s.\n", imageFileName);
+        return -1;
+    }
+    return 0;
 }
  
-unsigned char* createBitmapFileHeader (int height, int stride) {
+void createBitmapFileHeader (unsigned char* fileHeader, int height, int stride) {
     int fileSize = FILE_HEADER_SIZE + INFO_HEADER_SIZE + (stride * height);
 
-    static unsigned char fileHeader[] = {
-        0,0,     /// signature
-        0,0,0,0, /// image file size in bytes
-        0,0,0,0, /// reserved
-        0,0,0,0, /// start of pixel array
-    };
+    /// signature, image file size in bytes, reserved, start of pixel array
+    memset(fileHeader, 0, FILE_HEADER_SIZE);
 
     fileHeader[ 0] = (unsigned char)('B');
     fileHeader[ 1] = (unsigned char)('M');
@@ -60,24 +64,13 @@ unsigned char* createBitmapFileHeader (int height, int stride) {
     fileHeader[ 4] = (unsigned char)(fileSize >> 16);
     fileHeader[ 5] = (unsigned char)(fileSize >> 24);
     fileHeader[10] = (unsigned char)(FILE_HEADER_SIZE + INFO_HEADER_SIZE);
-
-    return fileHeader;
 }
  
-unsigned char* createBitmapInfoHeader (int height, int width) {
-    static unsigned char infoHeader[] = {
-        0,0,0,0, /// header size
-        0,0,0,0, /// image width
-        0,0,0,0, /// image height
-        0,0,     /// number of color planes
-        0,0,     /// bits per pixel
-        0,0,0,0, /// compression
-        0,0,0,0, /// image size
-        0,0,0,0, /// horizontal resolution
-        0,0,0,0, /// vertical resolution
-        0,0,0,0, /// colors in color table
-        0,0,0,0, /// important color count
-    };
+void createBitmapInfoHeader (unsigned char* infoHeader, int height, int width) {
+    /// header size, image width, image height, number of color planes, bits per pixel,
+    /// compression, image size, horizontal resolution, vertical resolution,
+    /// colors in color table, important color count
+    memset(infoHeader, 0, INFO_HEADER_SIZE);
 
     infoHeader[ 0] = (unsigned char)(INFO_HEADER_SIZE);
     infoHeader[ 4] = (unsigned char)(width      );
@@ -90,6 +83,4 @@ unsigned char* createBitmapInfoHeader (int height, int width) {
     infoHeader[11] = (unsigned char)(height >> 24);
     infoHeader[12] = (unsigned char)(1);
     infoHeader[14] = (unsigned char)(BYTES_PER_PIXEL*8);
-
-    return infoHeader;
 }
@@ -5,5 +5,6 @@
  * @param height height of image
  * @param width  width of image
  * @param imageFileName name of image file ending with .bmp
+ * @return 0 on success, -1 if the file could not be written
  */
-void generateBitmapImage (unsigned char* image, int height, int width, char* imageFileName);
+int generateBitmapImage (unsigned char* image, int height, int width, char* imageFileName);
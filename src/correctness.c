@@ -1,9 +1,45 @@
 #include <complex.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <limits.h>
 #include "util.h"
 #include "intrin_v0.h"
 #include "intrin_v1.h"
 #include "naive.h"
+#include "julia.h"
+#include "plan.h"
+#include "performanz.h"
+#include "correctness.h"
+#include "distance.h"
+#include "atlas.h"
+#include "render.h"
+#include "placement.h"
+
+//parameters of the multithreaded stress test
+#define STRESS_THREADS 8
+#define STRESS_ROUNDS 4
+#define STRESS_WIDTH 250 //not divisible by 4, so that remaining columns are computed as well
+#define STRESS_HEIGHT 150
+#define STRESS_N 200
+#define STRESS_C_VALUES 10 //c values per implementation and family
+#define STRESS_MAX_JOBS ((INTRIN_MORTON + 1 + 2) * STRESS_C_VALUES)
+
+//filled pixels of the distance check have to escape in this many times n iterations
+#define DE_CHECK_FACTOR 8
+#define DE_CHECK_MIN_N 10000
+
+//atlas check: thumbnails per row and column, largest thumbnail size
+#define ATLAS_CHECK_COLS 3
+#define ATLAS_CHECK_ROWS 2
+#define ATLAS_CHECK_SIZE 61 //not divisible by 4, so lanes are refilled in the middle of rows
+
+//placement check: workers on simulated nodes with band heights not dividing the image height
+#define PLACEMENT_CHECK_CASES 3
 
 
 /**
@@ -43,179 +79,1006 @@ unsigned iterate_reference(float x, float y, Arguments* args) {
         return k; //case r > M, choose color k
 }
 
-void test(Arguments* args, size_t width, size_t height) {
-    printf("Correctness test:\n");
-    printf("    Arguments: {c = %.3f + %.3f i, start = %.3f + %.3f i,\n"
-           "                res = %.6f, n = %u, width = %lu, height = %lu}\n",
-                        crealf(args->c), cimagf(args->c), crealf(args->start), cimagf(args->start), args->res,
-                        args->n, width, height);
+unsigned iterate_reference_fma(float x, float y, Arguments* args) {
+    float p = crealf(args->c); //c = p + qi
+    float q = cimagf(args->c);
 
-    //make color_pixel function work in correctness test mode
-    CORRECTNESS_TEST = true;
+    unsigned k = 0; //iteration
+    unsigned K = args->n; //max_iteration
+
+    do {
+        float xtemp = x;
+        float y2 = y*y;
+        x = fmaf(x, x, -y2) + p;  //x(k)^2 - y(k)^2 rounded once, then + p
+        y = fmaf(2*xtemp, y, q);  //2 * x(k) * y(k) + q rounded once
+        k++;
+    } while (fmaf(x, x, y*y) <= args->radius_sqr && k < K);
 
-    unsigned* iterations0 = malloc(height * width * sizeof(unsigned));
-    unsigned* iterations1 = malloc(height * width * sizeof(unsigned));
-    unsigned* iterations2 = malloc(height * width * sizeof(unsigned));
+    if (k == K)
+        return BLACK;
+    else
+        return k;
+}
 
-    if (iterations0 == NULL || iterations1 == NULL || iterations2 == NULL) {
-        fprintf(stderr, "Could not allocate memory for a buffer sized %lu x %lu.\n", width, height);
-        exit(EXIT_FAILURE);
+unsigned iterate_reference_multibrot(float x, float y, Arguments* args) {
+    float p = crealf(args->c); //c = p + qi
+    float q = cimagf(args->c);
+
+    unsigned k = 0; //iteration
+    unsigned K = args->n; //max_iteration
+
+    do {
+        //w := z^d, multiplied up in the same order as the family kernel
+        float u = x;
+        float v = y;
+        for (unsigned d=1; d<args->degree; d++) {
+            float utemp = u;
+            u = u*x - v*y;
+            v = utemp*y + v*x;
+        }
+        x = u + p;
+        y = v + q;
+        k++;
+    } while (x*x + y*y <= args->radius_sqr && k < K);
+
+    if (k == K)
+        return BLACK;
+    else
+        return k;
+}
+
+unsigned iterate_reference_burning_ship(float x, float y, Arguments* args) {
+    float p = crealf(args->c); //c = p + qi
+    float q = cimagf(args->c);
+
+    unsigned k = 0; //iteration
+    unsigned K = args->n; //max_iteration
+
+    do {
+        float xtemp = fabsf(x);
+        y = fabsf(y);
+        x = xtemp*xtemp - y*y + p; //x(k+1) := |x(k)|^2 - |y(k)|^2 + p
+        y = (xtemp*y)*2 + q;       //y(k+1) := 2 * |x(k)| * |y(k)| + q
+        k++;
+    } while (x*x + y*y <= args->radius_sqr && k < K);
+
+    if (k == K)
+        return BLACK;
+    else
+        return k;
+}
+
+//scalar reference of one iteration family
+typedef unsigned (*reference_function)(float x, float y, Arguments* args);
+
+/**
+ * @return reference implementation of the iteration family selected in args
+ */
+static reference_function reference_of(Arguments* args) {
+    switch (args->family) {
+        case FAMILY_MULTIBROT:
+            return iterate_reference_multibrot;
+        case FAMILY_BURNING_SHIP:
+            return iterate_reference_burning_ship;
     }
+    return iterate_reference;
+}
+
+/**
+ * @return name of the iteration family selected in args, as accepted by the -f option
+ */
+static const char* family_name(Arguments* args, char* buffer, size_t size) {
+    switch (args->family) {
+        case FAMILY_MULTIBROT:
+            snprintf(buffer, size, "multibrot%u", args->degree);
+            return buffer;
+        case FAMILY_BURNING_SHIP:
+            return "burning-ship";
+    }
+    return "quadratic";
+}
 
-    CORRECTNESS_BUFFER = iterations0;
-    //run optimized implementation
-    //image buffer will not be used anyway since we are in CORRECTNESS_TEST mode, just give null
-    julia(args->c, args->start, width, height, args->res, args->n, 0);
+//state shared by all workers of one differential check
+typedef struct {
+    Arguments* args;
+    JuliaPlan** plans; //one plan per checked kernel, only read by workers
+    bool* fma; //compare kernel with iterate_reference_fma instead of iterate_reference
+    bool any_fma; //fma reference has to be computed
+    bool field16; //n fits into 16-bit fields, every other tile is rendered into one
+    int kernel_count;
+    size_t width;
+    size_t height;
+    size_t tiles_x;
+    size_t tiles;
+    atomic_size_t next_tile; //next tile which is not taken by a worker yet
+} diff_job;
 
+//state of one worker of a differential check
+typedef struct {
+    diff_job* job;
+    KernelScratch scratch;
+    unsigned* expected; //reference iteration numbers of the current tile
+    unsigned* expected_fma; //iteration numbers of the current tile computed by the fma reference
+    unsigned* actual; //iteration numbers of the current tile computed by a kernel
+    uint16_t* actual16; //same memory as actual, used for tiles rendered into a 16-bit field
+    DiffResult* results; //mismatches found by this worker, one entry per kernel
+} diff_worker;
 
-    CORRECTNESS_BUFFER = iterations1;
-    //run less optimized implementation
-    julia_V1(args->c, args->start, width, height, args->res, args->n, 0);
+/**
+ * @return number of iterations of a pixel, convergent pixels (BLACK) needed all n iterations
+ */
+static unsigned iterations_of(unsigned value, unsigned n) {
+    return (value == BLACK) ? n : value;
+}
 
-    CORRECTNESS_BUFFER = iterations2;
-    //run naive implementation
-    julia_V2(args->c, args->start, width, height, args->res, args->n, 0);
+/**
+ * @brief keep a mismatch if it is one of the first DIFF_LOCATIONS mismatches in row-major order.
+ * Tiles are checked in any order by several threads, sorting keeps the report deterministic.
+ */
+static void add_location(DiffResult* result, const DiffLocation* location) {
+    int i = result->locations;
+    while (i > 0 && (result->location[i - 1].y > location->y ||
+                    (result->location[i - 1].y == location->y && result->location[i - 1].x > location->x))) {
+        if (i < DIFF_LOCATIONS) {
+            result->location[i] = result->location[i - 1];
+        }
+        i--;
+    }
+    if (i < DIFF_LOCATIONS) {
+        result->location[i] = *location;
+        if (result->locations < DIFF_LOCATIONS) {
+            result->locations++;
+        }
+    }
+}
 
-    //at this point iteration numbers computed by naive and both optimized implementations are written into
-    //corresponding iterations0, iterations1, iterations2 arrays.
+/**
+ * @brief add mismatches found by one worker to the result of the whole check
+ */
+static void merge_result(DiffResult* result, const DiffResult* part) {
+    result->pixels += part->pixels;
+    result->mismatches += part->mismatches;
+    if (part->max_delta > result->max_delta) {
+        result->max_delta = part->max_delta;
+    }
+    for (int i=0; i<part->locations; i++) {
+        add_location(result, &part->location[i]);
+    }
+}
 
+/**
+ * @brief take tiles until all tiles of the image are checked. For every tile the reference
+ * iteration numbers are computed once and compared with the result of every kernel.
+ */
+static void* diff_worker_run(void* arg) {
+    diff_worker* worker = arg;
+    diff_job* job = worker->job;
+    Arguments* args = job->args;
     float start_x = crealf(args->start);
-    float start_y = cimagf(args->start);    
+    float start_y = cimagf(args->start);
+    reference_function reference = reference_of(args);
+
+    while (true) {
+        size_t tile = atomic_fetch_add(&job->next_tile, 1);
+        if (tile >= job->tiles) {
+            break;
+        }
+        size_t tx = tile % job->tiles_x;
+        size_t ty = tile / job->tiles_x;
+        Region region = {tx * DIFF_TILE, ty * DIFF_TILE, (tx + 1) * DIFF_TILE, (ty + 1) * DIFF_TILE};
+        if (region.x1 > job->width) {
+            region.x1 = job->width;
+        }
+        if (region.y1 > job->height) {
+            region.y1 = job->height;
+        }
+        size_t tile_width = region.x1 - region.x0;
+
+        //run reference implementation for each pixel of the tile
+        for (size_t y=region.y0; y<region.y1; y++) {
+            float im = start_y  + y * args->res;  // imaginary value
+            for (size_t x=region.x0; x<region.x1; x++) {
+                float re = start_x + x * args->res;  //real value
+                size_t o = (y - region.y0) * tile_width + x - region.x0;
+                worker->expected[o] = reference(re, im, args);
+                if (job->any_fma) {
+                    worker->expected_fma[o] = iterate_reference_fma(re, im, args);
+                }
+            }
+        }
+
+        //16-bit and 32-bit stores of the kernels are both checked, on alternating tiles
+        bool narrow = job->field16 && tile % 2 == 0;
+        for (int k=0; k<job->kernel_count; k++) {
+            //kernel writes iteration numbers of the tile only, into a buffer of the tile's size
+            Image img = job->plans[k]->img;
+            img.buffer = NULL;
+            img.field = narrow ? NULL : worker->actual;
+            img.field16 = narrow ? worker->actual16 : NULL;
+            img.window = region;
+            plan_render_region(job->plans[k], &img, &region, &worker->scratch);
+
+            const unsigned* reference = job->fma[k] ? worker->expected_fma : worker->expected;
+            DiffResult* result = &worker->results[k];
+            result->pixels += tile_width * (region.y1 - region.y0);
+            for (size_t y=region.y0; y<region.y1; y++) {
+                for (size_t x=region.x0; x<region.x1; x++) {
+                    size_t o = (y - region.y0) * tile_width + x - region.x0;
+                    unsigned value = narrow ? worker->actual16[o] : worker->actual[o];
+                    //both sides are compared as number of iterations. For n > 1 this is the same as
+                    //comparing the values, for n = 1 the reference reports every pixel as convergent
+                    //(BLACK) while the SIMD kernels report pixels outside of the escape radius at the
+                    //start as 1, both mean that the pixel stayed for its only iteration.
+                    unsigned expected = iterations_of(reference[o], args->n);
+                    unsigned actual = iterations_of(value, args->n);
+                    if (expected == actual) {
+                        continue;
+                    }
+                    unsigned delta = (expected > actual) ? expected - actual : actual - expected;
+                    if (delta > result->max_delta) {
+                        result->max_delta = delta;
+                    }
+                    result->mismatches++;
+                    DiffLocation location = {x, y, reference[o], value};
+                    add_location(result, &location);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+long long diff_check(Arguments* args, size_t width, size_t height, const int* kernels, int kernel_count,
+                                                        bool fma_reference, int threads, DiffResult* results) {
+    memset(results, 0, sizeof(DiffResult) * kernel_count);
+    diff_job job;
+    job.args = args;
+    job.kernel_count = kernel_count;
+    job.width = width;
+    job.height = height;
+    job.tiles_x = (width + DIFF_TILE - 1) / DIFF_TILE;
+    job.tiles = job.tiles_x * ((height + DIFF_TILE - 1) / DIFF_TILE);
+    atomic_init(&job.next_tile, 0);
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    //workers hold sse registers in their scratch, so they need 16-byte aligned memory
+    size_t size = (sizeof(diff_worker) * threads + 15) & ~(size_t)0x0F;
+    diff_worker* workers = aligned_alloc(16, size);
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    job.plans = calloc(kernel_count, sizeof(JuliaPlan*));
+    job.fma = calloc(kernel_count, sizeof(bool));
+    //tile buffers and results of all workers in one block
+    size_t tile_pixels = DIFF_TILE * DIFF_TILE;
+    unsigned* tiles = malloc(sizeof(unsigned) * tile_pixels * 3 * threads);
+    DiffResult* parts = calloc((size_t) kernel_count * threads, sizeof(DiffResult));
+    if (workers == NULL || ids == NULL || job.plans == NULL || job.fma == NULL || tiles == NULL || parts == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d threads.\n", threads);
+        free(workers);
+        free(ids);
+        free(job.plans);
+        free(job.fma);
+        free(tiles);
+        free(parts);
+        return -1;
+    }
+
+    long long status = 0;
+    job.any_fma = false;
+    job.field16 = field16_fits(args->n);
+    for (int k=0; k<kernel_count; k++) {
+        job.fma[k] = fma_reference && implementation_uses_fma(kernels[k]);
+        job.any_fma |= job.fma[k];
+        JuliaParams params;
+        plan_params(&params, kernels[k], args, width, height);
+        job.plans[k] = julia_plan_create(&params);
+        if (job.plans[k] == NULL) {
+            status = -1;
+        }
+    }
+
+    if (status == 0) {
+        for (int t=0; t<threads; t++) {
+            workers[t].job = &job;
+            workers[t].expected = tiles + 3 * t * tile_pixels;
+            workers[t].expected_fma = workers[t].expected + tile_pixels;
+            workers[t].actual = workers[t].expected_fma + tile_pixels;
+            workers[t].actual16 = (uint16_t*) workers[t].actual;
+            workers[t].results = parts + (size_t) t * kernel_count;
+        }
+        //calling thread is worker 0, remaining workers take the tiles of a thread which could not be created
+        int started = 0;
+        for (int t=1; t<threads; t++) {
+            if (pthread_create(&ids[t], NULL, diff_worker_run, &workers[t]) != 0) {
+                fprintf(stderr, "Could not create thread %d, continuing with %d threads.\n", t, t);
+                break;
+            }
+            started++;
+        }
+        diff_worker_run(&workers[0]);
+        for (int t=1; t<=started; t++) {
+            pthread_join(ids[t], NULL);
+        }
+
+        for (int k=0; k<kernel_count; k++) {
+            for (int t=0; t<threads; t++) {
+                merge_result(&results[k], &workers[t].results[k]);
+            }
+            status += results[k].mismatches;
+        }
+    }
+
+    for (int k=0; k<kernel_count; k++) {
+        if (job.plans[k] != NULL) {
+            julia_plan_destroy(job.plans[k]);
+        }
+    }
+    free(workers);
+    free(ids);
+    free(job.plans);
+    free(job.fma);
+    free(tiles);
+    free(parts);
+    return status;
+}
+
+/**
+ * @brief check if a kernel passed. Kernels compared with their own reference have to be bit-exact,
+ * fma kernels compared with iterate_reference may differ in tolerance percent of all pixels.
+ */
+static bool kernel_passed(int implementation, const DiffResult* r, double tolerance) {
+    if (tolerance < 0.0 || !implementation_uses_fma(implementation)) {
+        return r->mismatches == 0;
+    }
+    return r->mismatches * 100.0 <= tolerance * r->pixels;
+}
+
+/**
+ * @brief print mismatch counts, maximum iteration delta and first mismatch locations of every
+ * kernel which differs from the reference
+ */
+static void print_diff(const int* kernels, int kernel_count, const DiffResult* results, double tolerance) {
+    for (int k=0; k<kernel_count; k++) {
+        const DiffResult* r = &results[k];
+        if (r->mismatches == 0) {
+            continue;
+        }
+        printf("    %s: %llu of %llu pixels differ (%.4f%%), max iteration delta %u%s\n",
+                        names[kernels[k]], r->mismatches, r->pixels, r->mismatches * 100.0 / r->pixels, r->max_delta,
+                        kernel_passed(kernels[k], r, tolerance) ? ", within tolerance" : "");
+        for (int i=0; i<r->locations; i++) {
+            printf("        (x, y) = (%lu, %lu): reference %u, computed %u\n",
+                                r->location[i].x, r->location[i].y, r->location[i].expected, r->location[i].actual);
+        }
+    }
+}
+
+/**
+ * @brief run differential check of all kernels supported by this processor and exit if it could not be run.
+ * Without tolerance (tolerance < 0) fma kernels are compared with the fma reference, with tolerance
+ * with the reference implementation like all other kernels.
+ * 
+ * @return number of kernels which did not pass
+ */
+static int check_all(Arguments* args, size_t width, size_t height, double tolerance, int threads) {
+    int kernels[kernel_count];
+    int count = 0;
+    for (int k=0; k<kernel_count; k++) {
+        if (julia_implementation_supported(k) && implementation_supports_family(k, args->family)) {
+            kernels[count++] = k;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+    DiffResult results[kernel_count];
+    long long mismatches = diff_check(args, width, height, kernels, count, tolerance < 0.0, threads, results);
+    if (mismatches < 0) {
+        exit(EXIT_FAILURE);
+    }
+    int failed = 0;
+    for (int k=0; k<count; k++) {
+        if (!kernel_passed(kernels[k], &results[k], tolerance)) {
+            failed++;
+        }
+    }
+    if (mismatches > 0) {
+        print_diff(kernels, count, results, tolerance);
+    }
+    return failed;
+}
+
+/**
+ * @brief check distance estimation: the sse kernel must be bit-exact with iterate_distance and
+ * disk filling must not fill any pixel which belongs to the julia set by the reference implementation.
+ * Disks are exterior of the true julia set, so they may contain points which escape after more than
+ * n iterations. Filled pixels are checked with DE_CHECK_FACTOR * n, at least DE_CHECK_MIN_N iterations.
+ * 
+ * @return number of wrong pixels, -1 if memory could not be allocated
+ */
+static long long check_distance(Arguments* iteration_args, size_t width, size_t height) {
+    //same escape radius as the distance render
+    Arguments de_args = *iteration_args;
+    distance_radius(&de_args);
+    Arguments* args = &de_args;
+
+    float* computed = malloc(width * height * sizeof(float));
+    float* filled = malloc(width * height * sizeof(float));
+    if (computed == NULL || filled == NULL) {
+        fprintf(stderr, "Could not allocate memory for distance check.\n");
+        free(computed);
+        free(filled);
+        return -1;
+    }
+    xmm_helpers helpers;
+    init_xmm_helpers(&helpers, args);
+    Region region = {0, 0, width, height};
+    julia_distance_render(args, &helpers, computed, width, &region, false);
+    unsigned long long iterated = julia_distance_render(args, &helpers, filled, width, &region, true);
 
-    //run reference implementation and compare results
-    //for each pixel in image, run reference implementation and get 
-    //iteration number for that particular pixel.
+    long long wrong = 0;
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    Arguments longer = *args;
+    longer.n = (args->n < UINT_MAX / DE_CHECK_FACTOR) ? args->n * DE_CHECK_FACTOR : UINT_MAX;
+    if (longer.n < DE_CHECK_MIN_N) {
+        longer.n = DE_CHECK_MIN_N;
+    }
     for (size_t y=0; y<height; y++) {
         float im = start_y  + y * args->res;  // imaginary value
-        for (size_t x=0; x<width; x++) { 
+        for (size_t x=0; x<width; x++) {
             float re = start_x + x * args->res;  //real value
-            
-            unsigned iter = iterate_reference(re, im, args);
-            unsigned offset = y * width + x;
-
-            //compare iteration number you get from reference implementation with values computed by our implementations.
-            if (iterations0[offset] != iter) {
-                printf("--> Failed: Optimized implementation did not compute iteration number correctly.\n");
-                exit(0);
+            size_t o = y * width + x;
+            bool exact = computed[o] == iterate_distance(re, im, args);
+            //filled pixels are not recomputed, they have to be outside of the julia set
+            bool outside = filled[o] == computed[o] || iterate_reference(re, im, &longer) != BLACK;
+            if (!exact || !outside) {
+                if (wrong < DIFF_LOCATIONS) {
+                    printf("        (x, y) = (%lu, %lu): distance %g, scalar %g, filled %g\n",
+                                            x, y, computed[o], iterate_distance(re, im, args), filled[o]);
+                }
+                wrong++;
             }
-            if (iterations1[offset] != iter) {
-                printf("--> Failed: Less optimized implementation did not compute iteration number correctly.\n");
-                exit(0);
+        }
+    }
+    printf("    Distance estimation: %s, disk filling iterated %.1f%% of all pixels\n",
+                        wrong == 0 ? "passed" : "failed", iterated * 100.0 / (width * height));
+    free(computed);
+    free(filled);
+    return wrong;
+}
+
+/**
+ * @brief check the point list kernel used by supersampling against the reference. Every pixel is
+ * moved by a different fraction of a pixel, so the points are not on the grid of the other kernels.
+ * 
+ * @return number of wrong points, -1 if memory could not be allocated
+ */
+static long long check_points(Arguments* args, size_t width, size_t height) {
+    size_t count = width * height;
+    float* reals = malloc(count * sizeof(float));
+    float* imags = malloc(count * sizeof(float));
+    unsigned* values = malloc(count * sizeof(unsigned));
+    if (reals == NULL || imags == NULL || values == NULL) {
+        fprintf(stderr, "Could not allocate memory for point list check.\n");
+        free(reals);
+        free(imags);
+        free(values);
+        return -1;
+    }
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    for (size_t o=0; o<count; o++) {
+        float dx = (o % 7) / 7.0f;
+        float dy = (o % 5) / 5.0f;
+        reals[o] = start_x + (o % width + dx) * args->res;
+        imags[o] = start_y + (o / width + dy) * args->res;
+    }
+    xmm_helpers helpers;
+    init_xmm_helpers(&helpers, args);
+    julia_points(args, &helpers, reals, imags, count, values);
+
+    long long wrong = 0;
+    for (size_t o=0; o<count; o++) {
+        unsigned expected = iterate_reference(reals[o], imags[o], args);
+        //compared as number of iterations like in diff_check, BLACK and 1 are the same for n = 1
+        if (iterations_of(values[o], args->n) != iterations_of(expected, args->n)) {
+            if (wrong < DIFF_LOCATIONS) {
+                printf("        point %lu (%g, %g): %u, reference %u\n", o, reals[o], imags[o], values[o], expected);
             }
-            if (iterations2[offset] != iter) {
-                printf("--> Failed: Naive implementation did not compute iteration number correctly.\n");
-                exit(0); 
+            wrong++;
+        }
+    }
+    printf("    Point list kernel: %s\n", wrong == 0 ? "passed" : "failed");
+    free(reals);
+    free(imags);
+    free(values);
+    return wrong;
+}
+
+/**
+ * @brief check the atlas kernel: every thumbnail of a small atlas has to be bit-exact with julia_render
+ * of its c. Thumbnails show the view of args scaled down to at most ATLAS_CHECK_SIZE pixels.
+ * 
+ * @return number of wrong pixels, -1 if memory could not be allocated
+ */
+static long long check_atlas(Arguments* args, size_t width, size_t height) {
+    size_t w = (width < ATLAS_CHECK_SIZE) ? width : ATLAS_CHECK_SIZE;
+    size_t h = (height < ATLAS_CHECK_SIZE) ? height : ATLAS_CHECK_SIZE;
+    float res = args->res * ((width > height) ? (float) width / w : (float) height / h);
+    Atlas atlas;
+    if (atlas_create(&atlas, ATLAS_CHECK_COLS, ATLAS_CHECK_ROWS, w, h, args->start, res, args->n, args->bailout) != 0) {
+        return -1;
+    }
+    size_t mosaic_width = ATLAS_CHECK_COLS * w;
+    unsigned* mosaic = malloc(ATLAS_CHECK_COLS * ATLAS_CHECK_ROWS * w * h * sizeof(unsigned));
+    unsigned* expected = malloc(w * h * sizeof(unsigned));
+    if (mosaic == NULL || expected == NULL) {
+        fprintf(stderr, "Could not allocate memory for atlas check.\n");
+        atlas_destroy(&atlas);
+        free(mosaic);
+        free(expected);
+        return -1;
+    }
+    Image img;
+    init_img(&img, mosaic_width, ATLAS_CHECK_ROWS * h, NULL, args->n);
+    img.field = mosaic;
+    AtlasQueue queue;
+    atlas_queue_init(&queue, &atlas);
+    julia_atlas_render(&atlas, &img, &queue);
+
+    long long wrong = 0;
+    for (size_t t=0; t<ATLAS_CHECK_COLS * ATLAS_CHECK_ROWS; t++) {
+        Arguments* thumbnail = &atlas.thumbnails[t];
+        Image single;
+        init_img(&single, w, h, NULL, args->n);
+        single.field = expected;
+        xmm_helpers helpers;
+        init_xmm_helpers(&helpers, thumbnail);
+        Region region = {0, 0, w, h};
+        julia_render(thumbnail, &single, &helpers, &region);
+
+        size_t x0 = (t % ATLAS_CHECK_COLS) * w;
+        size_t y0 = (t / ATLAS_CHECK_COLS) * h;
+        for (size_t y=0; y<h; y++) {
+            for (size_t x=0; x<w; x++) {
+                unsigned actual = mosaic[(y0 + y) * mosaic_width + x0 + x];
+                //SIMD lanes and remaining columns differ in BLACK and 1 for n = 1, see diff_check
+                if (iterations_of(actual, args->n) != iterations_of(expected[y * w + x], args->n)) {
+                    if (wrong < DIFF_LOCATIONS) {
+                        printf("        thumbnail %lu, (x, y) = (%lu, %lu): %u, julia_render %u\n",
+                                                                t, x, y, actual, expected[y * w + x]);
+                    }
+                    wrong++;
+                }
             }
         }
     }
-    printf("--> Passed. All implementations computed each iteration count correctly.\n\n");
-    free(iterations0);
-    free(iterations1);
-    free(iterations2);
-    CORRECTNESS_TEST = false;
+    printf("    Atlas kernel: %s\n", wrong == 0 ? "passed" : "failed");
+    atlas_destroy(&atlas);
+    free(mosaic);
+    free(expected);
+    return wrong;
 }
 
-void test_correctness() {
-    printf("Starting detailed correctness test..\n");
-    printf("Implementations are tested against reference implementation with\n"
-           "10 different c values and image sizes varying from 500x500 to 3000x3000.\n"
-           "After each function call, iteration numbers computed for each pixel by all three\n"
-           "implementations are compared to reference.\n\n"
-           "Test passes if iteration numbers computed by all four functions\n"
-           "(optimized, less optimized, naive, reference) are exactly the same.\n\n");
-    
-    printf("Do you want to run correctness test? [y/n] ");
+/**
+ * @brief check render_parallel_placed on simulated nodes with several affinities, with and without
+ * node-local bands, against a single-threaded render of the same plan
+ *
+ * @return number of wrong pixels, -1 if memory could not be allocated
+ */
+static long long check_placement(Arguments* args, size_t width, size_t height) {
+    //nodes, affinity, local, threads, band height
+    static const int cases[PLACEMENT_CHECK_CASES][5] = {
+        {3, AFFINITY_SCATTER, 1, 4, 5},
+        {2, AFFINITY_COMPACT, 1, 3, 16},
+        {2, AFFINITY_NONE, 0, 2, 7},
+    };
+    JuliaParams params;
+    plan_params(&params, INTRIN_V0, args, width, height);
+    JuliaPlan* plan = julia_plan_create(&params);
+    unsigned* expected = malloc(width * height * sizeof(unsigned));
+    unsigned* field = malloc(width * height * sizeof(unsigned));
+    Placement* placement = malloc(sizeof(Placement));
+    if (plan == NULL || expected == NULL || field == NULL || placement == NULL) {
+        fprintf(stderr, "Could not allocate memory for placement check.\n");
+        julia_plan_destroy(plan);
+        free(expected);
+        free(field);
+        free(placement);
+        return -1;
+    }
+    julia_plan_execute_field(plan, expected);
+
+    long long wrong = 0;
+    for (int i=0; i<PLACEMENT_CHECK_CASES && wrong == 0; i++) {
+        if (topology_read(&placement->topology) != 0) {
+            wrong = -1;
+            break;
+        }
+        topology_simulate(&placement->topology, cases[i][0]);
+        placement->affinity = cases[i][1];
+        placement->local = cases[i][2];
+        memset(field, 0xFF, width * height * sizeof(unsigned));
+        if (render_parallel_placed(plan, NULL, field, NULL, cases[i][3], cases[i][4], placement, NULL) != 0) {
+            wrong = -1;
+            break;
+        }
+        for (size_t o=0; o<width * height; o++) {
+            if (field[o] != expected[o]) {
+                if (wrong < DIFF_LOCATIONS) {
+                    printf("        case %d, (x, y) = (%lu, %lu): %u, single-threaded %u\n", i, o % width, o / width,
+                                                                                        field[o], expected[o]);
+                }
+                wrong++;
+            }
+        }
+    }
+    printf("    Placed parallel render: %s\n", wrong == 0 ? "passed" : "failed");
+    julia_plan_destroy(plan);
+    free(expected);
+    free(field);
+    free(placement);
+    return wrong;
+}
 
-    char response = getchar();
-    if (response != 'y' && response != 'Y') {
-        printf("Abort.\n");
-        return;
+/**
+ * @brief print how fma kernels are checked
+ */
+static void print_policy(double tolerance) {
+    if (tolerance < 0.0) {
+        printf("FMA implementations are compared with the FMA reference, all results must be bit-exact.\n");
+    } else {
+        printf("FMA implementations are compared with the reference implementation and may differ\n"
+               "in %.4f%% of all pixels, all other results must be bit-exact.\n", tolerance);
     }
+}
 
-    //make color_pixel function work in correctness test mode
-    CORRECTNESS_TEST = true;
+int test(Arguments* args, size_t width, size_t height, double tolerance, int threads) {
+    char family[16];
+    printf("Correctness test:\n");
+    printf("    Arguments: {c = %.3f + %.3f i, start = %.3f + %.3f i,\n"
+           "                res = %.6f, n = %u, width = %lu, height = %lu,\n"
+           "                family = %s, escape radius = %.3f}\n",
+                        crealf(args->c), cimagf(args->c), crealf(args->start), cimagf(args->start), args->res,
+                        args->n, width, height, family_name(args, family, sizeof(family)), sqrtf(args->radius_sqr));
+    print_policy(tolerance);
+
+    if (check_all(args, width, height, tolerance, threads) != 0) {
+        printf("--> Failed: Not all implementations computed each iteration count correctly.\n\n");
+        return 1;
+    }
+    if (args->family == FAMILY_QUADRATIC && check_distance(args, width, height) != 0) {
+        printf("--> Failed: Distance estimation is wrong.\n\n");
+        return 1;
+    }
+    if (args->family == FAMILY_QUADRATIC && check_points(args, width, height) != 0) {
+        printf("--> Failed: Point list kernel is wrong.\n\n");
+        return 1;
+    }
+    if (args->family == FAMILY_QUADRATIC && check_atlas(args, width, height) != 0) {
+        printf("--> Failed: Atlas kernel is wrong.\n\n");
+        return 1;
+    }
+    if (check_placement(args, width, height) != 0) {
+        printf("--> Failed: Placed parallel render is wrong.\n\n");
+        return 1;
+    }
+    printf("--> Passed. All implementations computed each iteration count correctly.\n\n");
+    return 0;
+}
 
-    //we will save the iteration numbers computed by our implementations in these buffers
-    unsigned* iterations0;
-    unsigned* iterations1;
-    unsigned* iterations2;
+int test_correctness(double tolerance, int threads) {
+    printf("Starting detailed correctness test..\n");
+    printf("Every implementation supported by this processor is tested against the reference\n"
+           "implementation with 10 different c values of the quadratic family and image sizes\n"
+           "varying from 500x500 to 3000x3000. After each render, iteration numbers computed\n"
+           "for each pixel are compared to reference in tiles of %dx%d pixels by %d threads.\n"
+           "Other iteration families are checked by -x with -f and by --fuzz.\n\n"
+           "Implementations:", DIFF_TILE, DIFF_TILE, threads);
+    const char* separator = " ";
+    for (int k=0; k<kernel_count; k++) {
+        if (julia_implementation_supported(k)) {
+            printf("%s%s", separator, names[k]);
+            separator = ", ";
+        }
+    }
+    printf("\nTest passes if all of them compute the same iteration numbers as the reference.\n");
+    print_policy(tolerance);
+    printf("\n");
 
     //these parameters do not change during entire test
-    float start = -1.5 + -1.5 * I;
+    float complex start = -1.5 + -1.5 * I;
     unsigned n = 200;
 
-    Arguments* args;
-
+    int failed = 0;
     for (int s=0; s<6; s++) {
         size_t size = image_sizes[s];
         printf("================================================================================\n");
         printf("Image size: %lu x %lu\n", size, size);
-        fflush(stdout);
-
-        iterations0 = malloc(sizeof(unsigned) * size * size);
-        iterations1 = malloc(sizeof(unsigned) * size * size);
-        iterations2 = malloc(sizeof(unsigned) * size * size);
-
-        if (iterations0 == NULL || iterations1 == NULL || iterations2 == NULL) {
-            fprintf(stderr, "Could not allocate memory for a buffer sized %lu x %lu.\n", size, size);
-            exit(EXIT_FAILURE);
-        }
-
-        printf("Testing with c value:\n");                
+        printf("Testing with c value:\n");
         for (int j=0; j<10; j++) {
             float complex c = c_values[j];
-            args = get_args(c, start, 3.0/size, n);
+            Arguments args;
+            init_args(&args, c, start, 3.0/size, n);
 
             printf("    %.3f + %.3fi --->", crealf(c), cimagf(c));
             fflush(stdout);
 
-            //iteration numbers will be written by color_pixel function into iterations0 array 
-            CORRECTNESS_BUFFER = iterations0;
+            if (check_all(&args, size, size, tolerance, threads) != 0) {
+                printf("    Failed\n");
+                failed++;
+            }
+            else {
+                printf(" Passed\n");
+            }
+        }
+    }
+    if (failed != 0) {
+        printf("\nFinished. %d of 60 tests failed.\n", failed);
+        return 1;
+    }
+    printf("\nFinished. All tests passed.\n");
+    return 0;
+}
 
-            //run optimized implementation
-            julia(args->c, args->start, size, size, 3.0f/size, args->n, 0);
+/**
+ * @return random float in [min, max]
+ */
+static float random_float(unsigned* seed, float min, float max) {
+    return min + (max - min) * ((float) rand_r(seed) / RAND_MAX);
+}
 
-            //run less optimized implementation
-            CORRECTNESS_BUFFER = iterations1;
-            julia_V1(args->c, args->start, size, size, 3.0/size, args->n, 0);
+/**
+ * @return random float in [min, max], every order of magnitude is equally likely
+ */
+static float random_log(unsigned* seed, float min, float max) {
+    return expf(random_float(seed, logf(min), logf(max)));
+}
 
-            //run naive implementation
-            CORRECTNESS_BUFFER = iterations2;
-            julia_V2(args->c, args->start, size, size, 3.0/size, args->n, 0);
+int test_fuzz(double seconds, double tolerance, int threads) {
+    unsigned seed = (unsigned) time(NULL);
+    printf("Starting randomised correctness test (seed %u)..\n", seed);
+    printf("All implementations are compared with the reference implementation for random\n"
+           "c, start, resolution, n, image size, iteration family and escape radius for %.0f seconds.\n", seconds);
+    print_policy(tolerance);
+    printf("\n");
 
-            float start_x = crealf(args->start);
-            float start_y = cimagf(args->start);  
+    struct timespec begin;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
 
-            //run reference implementation and compare results
-            for (size_t y=0; y<size; y++) {
-                float im = start_y  + y * args->res;  // imaginary value
-                for (size_t x=0; x<size; x++) { 
-                    float re = start_x + x * args->res;  //real value
+    long cases = 0;
+    long failed = 0;
+    unsigned long long pixels = 0;
+    do {
+        //half of the cases near the interesting c values, the rest anywhere around the mandelbrot set
+        float complex c;
+        if (rand_r(&seed) % 2 == 0) {
+            c = c_values[rand_r(&seed) % 10] + random_float(&seed, -0.05f, 0.05f) + random_float(&seed, -0.05f, 0.05f) * I;
+        }
+        else {
+            c = random_float(&seed, -2.0f, 0.6f) + random_float(&seed, -1.2f, 1.2f) * I;
+        }
+        //small sizes and widths not divisible by 4 hit the remaining columns of the SIMD kernels
+        size_t width = 1 + rand_r(&seed) % 300;
+        size_t height = 1 + rand_r(&seed) % 200;
+        float res = random_log(&seed, 1e-5f, 2e-2f);
+        //n = 1 is included, the check compares iteration numbers as number of iterations
+        unsigned n = (unsigned) random_log(&seed, 1.0f, 2000.0f);
+        //center of the image somewhere in the escape radius
+        float complex start = random_float(&seed, -1.5f, 1.5f) - width * res / 2
+                            + (random_float(&seed, -1.5f, 1.5f) - height * res / 2) * I;
 
-                    unsigned iter = iterate_reference(re, im, args);
-                    unsigned offset = y * size + x;
+        Arguments args;
+        init_args(&args, c, start, res, n);
+        //half of the cases z^2 + c, the rest split between the other families
+        int family = FAMILY_QUADRATIC;
+        unsigned degree = 2;
+        if (rand_r(&seed) % 2 == 0) {
+            family = (rand_r(&seed) % 2 == 0) ? FAMILY_MULTIBROT : FAMILY_BURNING_SHIP;
+            degree = MULTIBROT_MIN_DEGREE + rand_r(&seed) % (MULTIBROT_MAX_DEGREE - MULTIBROT_MIN_DEGREE + 1);
+        }
+        //every fourth case with an escape radius above the default
+        float bailout = 0.0f;
+        if (rand_r(&seed) % 4 == 0) {
+            bailout = sqrtf(args.radius_sqr) * random_float(&seed, 1.0f, 10.0f);
+        }
+        if (init_family(&args, family, degree, bailout) != 0) {
+            exit(EXIT_FAILURE);
+        }
 
-                    if (iterations0[offset] != iter) {
-                        printf(" Failed\nOptimized implementation did not compute iteration number correctly.\n");
-                        exit(0);
-                    }
-                    if (iterations1[offset] != iter) {
-                        printf(" Failed\nLess optimized implementation did not compute iteration number correctly.\n");
-                        exit(0);
-                    }
-                    if (iterations2[offset] != iter) {
-                        printf(" Failed\nNaive implementation did not compute iteration number correctly.\n");
-                        exit(0);                       
-                    }
+        if (check_all(&args, width, height, tolerance, threads) != 0) {
+            char name[16];
+            printf("--> Failed, rerun with: -x -c %.9g,%.9g -s %.9g,%.9g -r %.9g -n %u -d %lu,%lu -f %s",
+                            crealf(c), cimagf(c), crealf(start), cimagf(start), res, n, width, height,
+                            family_name(&args, name, sizeof(name)));
+            if (bailout != 0.0f) {
+                printf(" --bailout=%.9g", bailout);
+            }
+            printf("\n\n");
+            failed++;
+        }
+        cases++;
+        pixels += width * height;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (now.tv_sec - begin.tv_sec + 1e-9 * (now.tv_nsec - begin.tv_nsec) < seconds);
+
+    if (failed != 0) {
+        printf("Finished. %ld of %ld random cases (%llu pixels) failed.\n", failed, cases, pixels);
+        return 1;
+    }
+    printf("Finished. All %ld random cases (%llu pixels) passed.\n", cases, pixels);
+    return 0;
+}
+
+//expected results of one stress test job, computed single-threaded
+typedef struct {
+    JuliaParams params;
+    unsigned* field;
+    uint16_t* field16;
+    unsigned char* rgb;
+} stress_job;
+
+//jobs shared by all threads (read only), the renders done and mismatches found by one thread
+typedef struct {
+    const stress_job* jobs;
+    int job_count;
+    int id;
+    long renders;
+    long mismatches;
+} stress_worker;
+
+/**
+ * @brief run all jobs of the stress test STRESS_ROUNDS times, starting with a different
+ * job in every thread. Results of the plan api (32-bit and 16-bit fields and rgb) and of the
+ * one-shot functions of the first three implementations are compared with the single-threaded results.
+ */
+static void* stress_thread(void* arg) {
+    stress_worker* worker = arg;
+    size_t pixels = STRESS_WIDTH * STRESS_HEIGHT;
+
+    unsigned* field = malloc(pixels * sizeof(unsigned));
+    uint16_t* field16 = malloc(pixels * sizeof(uint16_t));
+    unsigned char* rgb = malloc(pixels * 3);
+    if (field == NULL || field16 == NULL || rgb == NULL) {
+        fprintf(stderr, "Could not allocate memory for a buffer sized %d x %d.\n", STRESS_WIDTH, STRESS_HEIGHT);
+        exit(EXIT_FAILURE);
+    }
+    void (*one_shot[3])(float complex, float complex, size_t, size_t, float, unsigned, unsigned char*) = {julia, julia_V1, julia_V2};
+
+    for (int round=0; round<STRESS_ROUNDS; round++) {
+        for (int j=0; j<worker->job_count; j++) {
+            const stress_job* job = &worker->jobs[(j + worker->id) % worker->job_count];
+            const JuliaParams* p = &job->params;
+
+            JuliaPlan* plan = julia_plan_create(p);
+            if (plan == NULL) {
+                exit(EXIT_FAILURE);
+            }
+            julia_plan_execute_field(plan, field);
+            if (memcmp(field, job->field, pixels * sizeof(unsigned)) != 0) {
+                worker->mismatches++;
+            }
+            if (julia_plan_execute_field16(plan, field16) != 0
+                        || memcmp(field16, job->field16, pixels * sizeof(uint16_t)) != 0) {
+                worker->mismatches++;
+            }
+            julia_plan_execute(plan, rgb);
+            if (memcmp(rgb, job->rgb, pixels * 3) != 0) {
+                worker->mismatches++;
+            }
+            julia_plan_destroy(plan);
+            worker->renders += 3;
+
+            //one-shot functions only exist for the quadratic family of the first three implementations
+            if (p->implementation <= NAIVE && p->family == FAMILY_QUADRATIC) {
+                memset(rgb, 0, pixels * 3);
+                one_shot[p->implementation](p->c, p->start, p->width, p->height, p->res, p->n, rgb);
+                if (memcmp(rgb, job->rgb, pixels * 3) != 0) {
+                    worker->mismatches++;
                 }
+                worker->renders++;
             }
-            fprintf(stderr, " Passed\n");
-            free(args); 
         }
-        free(iterations0);
-        free(iterations1);
-        free(iterations2);
-    } 
-    printf("\nFinished. All tests passed.\n");
-    CORRECTNESS_TEST = false;
+    }
+    free(field);
+    free(field16);
+    free(rgb);
+    return NULL;
+}
+
+void test_threads() {
+    printf("Starting multithreaded stress test..\n");
+    printf("Every supported implementation with the quadratic family and the optimized implementation\n"
+           "with multibrot3 and burning-ship are run with %d different c values by %d threads at the\n"
+           "same time, %d rounds each. Every result (32-bit and 16-bit iteration numbers and colors)\n"
+           "is compared with the result of a single-threaded run.\n\n",
+           STRESS_C_VALUES, STRESS_THREADS, STRESS_ROUNDS);
+
+    //implementation, family and degree of the jobs, every one with every c value
+    int variants[STRESS_MAX_JOBS / STRESS_C_VALUES][3];
+    int variant_count = 0;
+    for (int impl=0; impl<=INTRIN_MORTON; impl++) {
+        if (julia_implementation_supported(impl)) {
+            variants[variant_count][0] = impl;
+            variants[variant_count][1] = FAMILY_QUADRATIC;
+            variants[variant_count][2] = 2;
+            variant_count++;
+        }
+    }
+    variants[variant_count][0] = INTRIN_V0;
+    variants[variant_count][1] = FAMILY_MULTIBROT;
+    variants[variant_count][2] = 3;
+    variant_count++;
+    variants[variant_count][0] = INTRIN_V0;
+    variants[variant_count][1] = FAMILY_BURNING_SHIP;
+    variants[variant_count][2] = 2;
+    variant_count++;
+
+    //compute expected results single-threaded
+    int job_count = variant_count * STRESS_C_VALUES;
+    stress_job jobs[STRESS_MAX_JOBS];
+    size_t pixels = STRESS_WIDTH * STRESS_HEIGHT;
+    float complex start = -1.5 + -1.5 * I;
+
+    for (int j=0; j<job_count; j++) {
+        const int* variant = variants[j % variant_count];
+        JuliaParams params = {variant[0], c_values[j / variant_count], start, STRESS_WIDTH, STRESS_HEIGHT,
+                                            3.0f/STRESS_WIDTH, STRESS_N, variant[1], variant[2], 0.0f};
+        jobs[j].params = params;
+        jobs[j].field = malloc(pixels * sizeof(unsigned));
+        jobs[j].field16 = malloc(pixels * sizeof(uint16_t));
+        jobs[j].rgb = malloc(pixels * 3);
+        if (jobs[j].field == NULL || jobs[j].field16 == NULL || jobs[j].rgb == NULL) {
+            fprintf(stderr, "Could not allocate memory for a buffer sized %d x %d.\n", STRESS_WIDTH, STRESS_HEIGHT);
+            exit(EXIT_FAILURE);
+        }
+        JuliaPlan* plan = julia_plan_create(&params);
+        if (plan == NULL) {
+            exit(EXIT_FAILURE);
+        }
+        julia_plan_execute_field(plan, jobs[j].field);
+        if (julia_plan_execute_field16(plan, jobs[j].field16) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        julia_plan_execute(plan, jobs[j].rgb);
+        julia_plan_destroy(plan);
+    }
+
+    pthread_t threads[STRESS_THREADS];
+    stress_worker workers[STRESS_THREADS];
+
+    for (int t=0; t<STRESS_THREADS; t++) {
+        workers[t].jobs = jobs;
+        workers[t].job_count = job_count;
+        workers[t].id = t;
+        workers[t].renders = 0;
+        workers[t].mismatches = 0;
+        if (pthread_create(&threads[t], NULL, stress_thread, &workers[t]) != 0) {
+            fprintf(stderr, "Could not create thread %d.\n", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    long renders = 0;
+    long mismatches = 0;
+    for (int t=0; t<STRESS_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        renders += workers[t].renders;
+        mismatches += workers[t].mismatches;
+    }
+
+    for (int j=0; j<job_count; j++) {
+        free(jobs[j].field);
+        free(jobs[j].field16);
+        free(jobs[j].rgb);
+    }
+
+    if (mismatches != 0) {
+        printf("--> Failed: %ld of %ld concurrent renders differ from single-threaded result.\n", mismatches, renders);
+        exit(EXIT_FAILURE);
+    }
+    printf("--> Passed. All %ld concurrent renders match the single-threaded result.\n", renders);
 }
\ No newline at end of file
@@ -1,3 +1,88 @@
+//edge length of the tiles compared by the differential check
+#define DIFF_TILE 64
+//number of mismatch locations reported per kernel
+#define DIFF_LOCATIONS 5
+//time budget of the randomised correctness test in seconds
+#define DEFAULT_FUZZ_SECONDS 10
+
+//a pixel where a kernel computed another iteration number than the reference
+typedef struct {
+    size_t x;
+    size_t y;
+    unsigned expected; //iteration number of the reference implementation
+    unsigned actual; //iteration number of the kernel
+} DiffLocation;
+
+//result of the differential check of one kernel
+typedef struct {
+    unsigned long long pixels; //compared pixels
+    unsigned long long mismatches;
+    unsigned max_delta; //largest difference of iteration numbers, convergent pixels count as n
+    int locations; //valid entries in location
+    DiffLocation location[DIFF_LOCATIONS]; //first mismatches in row-major order
+} DiffResult;
+
+/**
+ * @brief reference implementation of iteration function.
+ * 
+ * @param x real part of complex num
+ * @param y imaginary part of complex num
+ * @param args julia arguments
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_reference(float x, float y, Arguments* args);
+
+/**
+ * @brief reference implementation with fused multiply-add, in the same order as the fma kernels:
+ * x^2 - y^2 and 2xy + q are rounded once, |z|^2 is computed as fma(x, x, y*y).
+ * 
+ * @param x real part of complex num
+ * @param y imaginary part of complex num
+ * @param args julia arguments
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_reference_fma(float x, float y, Arguments* args);
+
+/**
+ * @brief reference implementation of the multibrot family z -> z^d + c with d = args->degree.
+ * z^d is computed by d-1 complex multiplications in the same order as the family kernel.
+ * 
+ * @param x real part of complex num
+ * @param y imaginary part of complex num
+ * @param args julia arguments
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_reference_multibrot(float x, float y, Arguments* args);
+
+/**
+ * @brief reference implementation of the burning ship family z -> (|re z| + i |im z|)^2 + c.
+ * 
+ * @param x real part of complex num
+ * @param y imaginary part of complex num
+ * @param args julia arguments
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_reference_burning_ship(float x, float y, Arguments* args);
+
+/**
+ * @brief differential check of kernels against the reference implementation of the iteration family in args.
+ * The image is split into tiles of DIFF_TILE x DIFF_TILE pixels which are checked by several
+ * threads. Every thread only holds the iteration numbers of its current tile, so memory does
+ * not grow with the image size. All mismatches are counted, the check does not stop at the first one.
+ * 
+ * @param args julia arguments
+ * @param width width of image
+ * @param height height of image
+ * @param kernels implementations to check
+ * @param kernel_count number of entries in kernels
+ * @param fma_reference compare fma kernels with iterate_reference_fma instead of iterate_reference
+ * @param threads number of threads including the calling thread
+ * @param results one entry per kernel
+ * @return total number of mismatching pixels of all kernels, -1 if the check could not be run
+ */
+long long diff_check(Arguments* args, size_t width, size_t height, const int* kernels, int kernel_count,
+                                                        bool fma_reference, int threads, DiffResult* results);
+
 /**
  * @brief test correctness of all three implementations with parameters given by user.
  * Correctness test is based on computed iteration numbers for each pixel in the image.
@@ -6,13 +91,46 @@
  * @param args julia arguments
  * @param width width of image
  * @param height height of image
+ * @param tolerance negative: all implementations must be bit-exact with their reference (fma
+ * implementations with the fma reference). otherwise percent of pixels in which fma implementations
+ * may differ from the reference implementation
+ * @param threads number of threads running the test
+ * @return 0 if all implementations passed, 1 otherwise
  */
-void test(Arguments* args, size_t width, size_t height);
+int test(Arguments* args, size_t width, size_t height, double tolerance, int threads);
 
 /**
  * @brief detailed correctness test with fixed parameters
  * This function will test if computed iteration numbers for each pixel are correct.
  * All three implementations are run and computed iteration numbers are compared
  * with the reference implementation.
+ * 
+ * @param tolerance negative: all implementations must be bit-exact with their reference (fma
+ * implementations with the fma reference). otherwise percent of pixels in which fma implementations
+ * may differ from the reference implementation
+ * @param threads number of threads running the test
+ * @return 0 if all tests passed, 1 otherwise
+ */
+int test_correctness(double tolerance, int threads);
+
+/**
+ * @brief randomised correctness test.
+ * Compares all implementations with the reference implementation for random c, start,
+ * resolution, n and image size until the time budget is used up. Arguments of every failing
+ * case are printed, so that it can be reproduced with -x.
+ * 
+ * @param seconds time budget
+ * @param tolerance negative: all implementations must be bit-exact with their reference (fma
+ * implementations with the fma reference). otherwise percent of pixels in which fma implementations
+ * may differ from the reference implementation
+ * @param threads number of threads running the test
+ * @return 0 if all cases passed, 1 otherwise
+ */
+int test_fuzz(double seconds, double tolerance, int threads);
+
+/**
+ * @brief multithreaded stress test.
+ * Runs many renders from several threads at the same time and checks that every
+ * result is identical to the result of the same render run single-threaded.
  */
-void test_correctness();
\ No newline at end of file
+void test_threads();
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "counters.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char* counter_names[COUNTER_EVENTS] = {"cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"};
+
+#ifdef __linux__
+/**
+ * @brief open one counting event for the calling thread, user space only
+ * @return file descriptor or -1
+ */
+static int open_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1; //allowed with perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+bool counters_open(Counters* counters) {
+    counters->available = false;
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        counters->fds[i] = -1;
+    }
+#ifdef __linux__
+    uint64_t l1d = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    counters->fds[COUNTER_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[COUNTER_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[COUNTER_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    counters->fds[COUNTER_L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, l1d);
+    counters->fds[COUNTER_LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        if (counters->fds[i] != -1) {
+            counters->available = true;
+        }
+    }
+#endif
+    if (!counters->available) {
+        fprintf(stderr, "Hardware counters are not available (perf_event_open failed), measuring time only.\n");
+    }
+    return counters->available;
+}
+
+void counters_close(Counters* counters) {
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        if (counters->fds[i] != -1) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+    counters->available = false;
+}
+
+void counters_reset(CounterSample* sample) {
+    memset(sample->values, 0, sizeof(sample->values));
+    sample->seconds = 0.0;
+    sample->calls = 0;
+}
+
+void counters_start(Counters* counters, CounterSample* sample) {
+#ifdef __linux__
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        if (counters->fds[i] != -1) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void) counters;
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &sample->begin);
+}
+
+void counters_stop(Counters* counters, CounterSample* sample) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef __linux__
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        if (counters->fds[i] != -1) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value;
+            if (read(counters->fds[i], &value, sizeof(value)) == sizeof(value)) {
+                sample->values[i] += value;
+            }
+        }
+    }
+#else
+    (void) counters;
+#endif
+    sample->seconds += end.tv_sec - sample->begin.tv_sec + 1e-9 * (end.tv_nsec - sample->begin.tv_nsec);
+    sample->calls++;
+}
+
+void counters_print(Counters* counters, const char* phase, CounterSample* sample, size_t pixels) {
+    long calls = (sample->calls > 0) ? sample->calls : 1;
+
+    printf("    %-8s time: %f s/call, %.3f ns/pixel\n", phase, sample->seconds / calls,
+                                                        sample->seconds / calls / pixels * 1e9);
+    if (!counters->available) {
+        return;
+    }
+    for (int i=0; i<COUNTER_EVENTS; i++) {
+        if (counters->fds[i] == -1) {
+            printf("             %-13s n/a\n", counter_names[i]);
+            continue;
+        }
+        double per_call = (double) sample->values[i] / calls;
+        printf("             %-13s %16.0f /call %10.3f /pixel\n", counter_names[i], per_call, per_call / pixels);
+    }
+    if (counters->fds[COUNTER_CYCLES] != -1 && counters->fds[COUNTER_INSTRUCTIONS] != -1
+                                              && sample->values[COUNTER_CYCLES] != 0) {
+        printf("             %-13s %16.3f\n", "IPC",
+               (double) sample->values[COUNTER_INSTRUCTIONS] / sample->values[COUNTER_CYCLES]);
+    }
+}
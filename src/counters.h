@@ -0,0 +1,70 @@
+#ifndef MY_COUNTERS
+#define MY_COUNTERS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+//hardware events counted around kernels and render phases
+#define COUNTER_CYCLES 0
+#define COUNTER_INSTRUCTIONS 1
+#define COUNTER_BRANCH_MISSES 2
+#define COUNTER_L1D_MISSES 3
+#define COUNTER_LLC_MISSES 4
+#define COUNTER_EVENTS 5
+
+//file descriptors of opened perf events. fd is -1 if an event is not available.
+typedef struct {
+    int fds[COUNTER_EVENTS];
+    bool available; //at least one event could be opened
+} Counters;
+
+//accumulated counter values and wall time of one phase
+typedef struct {
+    unsigned long long values[COUNTER_EVENTS];
+    double seconds;
+    long calls; //number of start/stop pairs accumulated
+    struct timespec begin; //set by counters_start
+} CounterSample;
+
+/**
+ * @brief open hardware counters of the calling thread with perf_event_open.
+ * If counters are not available (no permission, no PMU, not linux), only wall time is measured later.
+ * 
+ * @param counters events are opened here
+ * @return true if at least one counter could be opened
+ */
+bool counters_open(Counters* counters);
+
+/**
+ * @brief close all opened counters
+ */
+void counters_close(Counters* counters);
+
+/**
+ * @brief set all values of sample to zero
+ */
+void counters_reset(CounterSample* sample);
+
+/**
+ * @brief start counting a phase
+ */
+void counters_start(Counters* counters, CounterSample* sample);
+
+/**
+ * @brief stop counting a phase and add counted values and elapsed time to sample
+ */
+void counters_stop(Counters* counters, CounterSample* sample);
+
+/**
+ * @brief print counted values of a phase: per call, per pixel and IPC.
+ * Events which are not available are printed as n/a.
+ * 
+ * @param counters opened counters
+ * @param phase name of the phase
+ * @param sample accumulated values
+ * @param pixels pixels processed per call
+ */
+void counters_print(Counters* counters, const char* phase, CounterSample* sample, size_t pixels);
+
+#endif
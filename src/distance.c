@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <complex.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "plan.h"
+#include "render.h"
+#include "distance.h"
+
+/**
+ * @brief distance estimate from z and the derivative z' at the escape step
+ */
+static float distance_of(float re, float im, float dre, float dim) {
+    float z = sqrtf(re*re + im*im);
+    float dz = sqrtf(dre*dre + dim*dim);
+    float d = 0.5f * z * logf(z) / dz;
+    //derivative overflowed, the point is as close to the set as a float can tell
+    if (!(d > 0.0f) || isinf(d)) {
+        return 0.0f;
+    }
+    return d;
+}
+
+void distance_radius(Arguments* args) {
+    if (args->bailout == 0.0f && DE_RADIUS * DE_RADIUS > args->radius_sqr) {
+        args->bailout = DE_RADIUS;
+        args->radius_sqr = DE_RADIUS * DE_RADIUS;
+    }
+}
+
+float iterate_distance(float re, float im, Arguments* args) {
+    float cre = crealf(args->c);
+    float cim = cimagf(args->c);
+    float dre = 1.0f;
+    float dim = 0.0f;
+
+    for (unsigned i=0; i<args->n; i++) {
+        float _re = re*re;
+        float _im = im*im;
+        //same compare as the sse kernel, NaN counts as escaped
+        if (!(_re + _im <= args->radius_sqr)) {
+            return distance_of(re, im, dre, dim);
+        }
+        //z' -> 2 z z', computed from z before it is updated
+        float next_dre = (re*dre - im*dim) * 2;
+        dim = (re*dim + im*dre) * 2;
+        dre = next_dre;
+        im = (re*im) * 2 + cim;
+        re = (_re - _im) + cre;
+    }
+    return 0.0f;
+}
+
+/**
+ * @brief iterate 4 points and write their distance estimates into out
+ */
+static void iterate_points(__m128 _reals, __m128 _imags, xmm_helpers* helpers, unsigned n, float* out) {
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+
+    __m128 _dre = _mm_set1_ps(1.0f);
+    __m128 _dim = _mm_setzero_ps();
+    //lanes which did not escape yet, escaped lanes keep z and z' of their escape step
+    __m128 live = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    int mask = 15;
+
+    for (unsigned i=0; i<n; i++) {
+        __m128 _re = _mm_mul_ps(_reals, _reals); //re^2
+        __m128 _im = _mm_mul_ps(_imags, _imags); //im^2
+        __m128 abs = _mm_cmple_ps(_mm_add_ps(_re, _im), rds);
+        live = _mm_and_ps(live, abs);
+        mask = mask & _mm_movemask_ps(abs);
+        if (mask == 0) {
+            break;
+        }
+
+        //z' -> 2 z z'
+        __m128 dre = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_reals, _dre), _mm_mul_ps(_imags, _dim)), twos);
+        __m128 dim = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_reals, _dim), _mm_mul_ps(_imags, _dre)), twos);
+        //z -> z^2 + c
+        __m128 imags = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_reals, _imags), twos), cim);
+        __m128 reals = _mm_add_ps(_mm_sub_ps(_re, _im), cre);
+
+        _dre = _mm_or_ps(_mm_and_ps(live, dre), _mm_andnot_ps(live, _dre));
+        _dim = _mm_or_ps(_mm_and_ps(live, dim), _mm_andnot_ps(live, _dim));
+        _imags = _mm_or_ps(_mm_and_ps(live, imags), _mm_andnot_ps(live, _imags));
+        _reals = _mm_or_ps(_mm_and_ps(live, reals), _mm_andnot_ps(live, _reals));
+    }
+
+    float re[4], im[4], dre[4], dim[4];
+    _mm_storeu_ps(re, _reals);
+    _mm_storeu_ps(im, _imags);
+    _mm_storeu_ps(dre, _dre);
+    _mm_storeu_ps(dim, _dim);
+    int still_in = _mm_movemask_ps(live);
+    for (int l=0; l<4; l++) {
+        //points which stayed in for all n steps belong to the julia set
+        out[l] = (still_in & (1 << l)) ? 0.0f : distance_of(re[l], im[l], dre[l], dim[l]);
+    }
+}
+
+/**
+ * @brief fill the unknown pixels of the region in a disk around the exterior pixel (px, py).
+ * A pixel at distance r (in the complex plane) from the center is at least d - r away from the
+ * julia set, only pixels which stay further away than the boundary width are filled.
+ * Rows above py are already done, so only the rest of row py and the rows below are visited.
+ */
+static void fill_disk(float* distance, size_t width, const Region* region, size_t px, size_t py, float d,
+                                                                                                float res) {
+    float radius = d / res - DE_BOUNDARY; //in pixels
+    if (radius < 1.0f) {
+        return;
+    }
+    if (radius > DE_MAX_FILL) {
+        radius = DE_MAX_FILL;
+    }
+    size_t r = (size_t) radius;
+    size_t x0 = (px - region->x0 > r) ? px - r : region->x0;
+    size_t x1 = (px + r + 1 < region->x1) ? px + r + 1 : region->x1;
+    size_t y1 = (py + r + 1 < region->y1) ? py + r + 1 : region->y1;
+
+    for (size_t y=py; y<y1; y++) {
+        float dy = (float) (y - py);
+        for (size_t x=(y == py) ? px + 1 : x0; x<x1; x++) {
+            float dx = (float) x - (float) px;
+            float offset = sqrtf(dx*dx + dy*dy);
+            if (offset <= radius && distance[y * width + x] < 0.0f) {
+                distance[y * width + x] = d - offset * res;
+            }
+        }
+    }
+}
+
+/**
+ * @brief compute the distance of one pixel with iterate_distance and fill its disk
+ */
+static void compute_point(Arguments* args, float* distance, size_t width, const Region* region, size_t x,
+                                                                                        size_t y, bool fill) {
+    float re = crealf(args->start) + x * args->res;
+    float im = cimagf(args->start) + y * args->res;
+    float d = iterate_distance(re, im, args);
+    distance[y * width + x] = d;
+    if (fill) {
+        fill_disk(distance, width, region, x, y, d, args->res);
+    }
+}
+
+unsigned long long julia_distance_render(Arguments* args, xmm_helpers* helpers, float* distance, size_t width,
+                                                                            const Region* region, bool fill) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t columns_end = region->x1 - ((region->x1 - region->x0) % 4);
+    unsigned long long iterated = 0;
+
+    if (fill) {
+        for (size_t y=region->y0; y<region->y1; y++) {
+            for (size_t x=region->x0; x<region->x1; x++) {
+                distance[y * width + x] = DE_UNKNOWN;
+            }
+        }
+    }
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+        float* row = &distance[y * width];
+
+        for (size_t x=region->x0; x<columns_end; x+=4) {
+            //all 4 pixels are filled already
+            if (fill && row[x] >= 0.0f && row[x+1] >= 0.0f && row[x+2] >= 0.0f && row[x+3] >= 0.0f) {
+                continue;
+            }
+            //same coordinates as julia_render
+            __m128 _reals = _mm_setr_ps(start_x + x * args->res, start_x + (x + 1) * args->res,
+                                        start_x + (x + 2) * args->res, start_x + (x + 3) * args->res);
+            iterate_points(_reals, _mm_set1_ps(im), helpers, args->n, &row[x]);
+            iterated += 4;
+
+            if (fill) {
+                for (int l=0; l<4; l++) {
+                    fill_disk(distance, width, region, x + l, y, row[x + l], args->res);
+                }
+            }
+        }
+        //remaining columns (less than 4) with the scalar function
+        for (size_t x=columns_end; x<region->x1; x++) {
+            if (!fill || row[x] < 0.0f) {
+                compute_point(args, distance, width, region, x, y, fill);
+                iterated++;
+            }
+        }
+    }
+    return iterated;
+}
+
+//state of a distance render shared by all bands
+typedef struct {
+    float* distance;
+    bool fill;
+    atomic_ullong iterated;
+} distance_job;
+
+/**
+ * @brief band function of render_distance
+ */
+static void distance_band(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch, void* context) {
+    (void) scratch;
+    distance_job* job = context;
+    unsigned long long iterated = julia_distance_render(&plan->args, &plan->helpers, job->distance, img->width,
+                                                                                            region, job->fill);
+    atomic_fetch_add(&job->iterated, iterated);
+}
+
+int render_distance(JuliaPlan* plan, float* distance, bool fill, int threads, unsigned long long* iterated) {
+    if (plan->args.family != FAMILY_QUADRATIC) {
+        fprintf(stderr, "Distance estimation is only supported for the quadratic family.\n");
+        return -1;
+    }
+    distance_job job;
+    job.distance = distance;
+    job.fill = fill;
+    atomic_init(&job.iterated, 0);
+    if (render_bands(plan, &plan->img, threads, DEFAULT_BAND_HEIGHT, distance_band, &job) != 0) {
+        return -1;
+    }
+    *iterated = atomic_load(&job.iterated);
+    return 0;
+}
+
+void color_distance(Image* img, const float* distance, float res) {
+    for (size_t y=0; y<img->height; y++) {
+        for (size_t x=0; x<img->width; x++) {
+            //distance in pixels
+            float d = distance[y * img->width + x] / res;
+            unsigned char color = 0;
+            if (d >= DE_BOUNDARY) {
+                color = (unsigned char) (255.0f * d / (d + DE_FALLOFF));
+            }
+            unsigned o = offset(img, y, x);
+
+            //black - lila coloring, same as color_pixel
+            img->buffer[o+2] = color >> 1; //red
+            img->buffer[o+1] = color >> 2;  //green
+            img->buffer[o]   = color;  //blue
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef MY_DISTANCE
+#define MY_DISTANCE
+
+#include "util.h"
+#include "plan.h"
+
+//pixels closer than DE_BOUNDARY pixels to the julia set are drawn as boundary
+#define DE_BOUNDARY 0.5f
+//distance in pixels at which the exterior reaches half brightness
+#define DE_FALLOFF 8.0f
+//largest radius in pixels of a disk filled without iterating
+#define DE_MAX_FILL 64
+//distance of pixels which are neither computed nor filled yet
+#define DE_UNKNOWN -1.0f
+//escape radius of distance estimation if no bailout is given. The estimate from the escape step
+//is only accurate for |z| much larger than 2, with r = 2 disks reach into the julia set near
+//parabolic c values
+#define DE_RADIUS 100.0f
+
+/**
+ * @brief set the escape radius of args to DE_RADIUS if no bailout is given and |c| is smaller
+ * 
+ * @param args julia arguments initialised by init_args and init_family
+ */
+void distance_radius(Arguments* args);
+
+/**
+ * @brief scalar distance estimation with the same operations as julia_distance_render.
+ * Iterates z -> z^2 + c together with the derivative z' -> 2 z z' (z'_0 = 1). For an escaping
+ * point the distance to the julia set is estimated as |z| ln|z| / (2 |z'|) at the escape step.
+ * 
+ * @param re real part of starting point
+ * @param im imaginary part of starting point
+ * @param args julia arguments
+ * @return estimated distance in the complex plane, 0 for points which did not escape in n steps
+ */
+float iterate_distance(float re, float im, Arguments* args);
+
+/**
+ * @brief distance estimation of a region with the loop of julia_render, 4 pixels per sse register.
+ * The derivative is carried in two more registers, lanes which escaped keep their values
+ * so the estimate is computed from the escape step.
+ * With fill, pixels within the estimated distance of an exterior pixel cannot belong to the julia set:
+ * all unknown pixels of the region inside the disk (minus the boundary width) get the lower bound
+ * of their distance without iterating. Groups of 4 pixels which are all known are skipped.
+ * 
+ * @param args julia arguments
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param distance distance of every pixel of the image, width entries per row
+ * @param width width of the image
+ * @param region pixels to compute
+ * @param fill fill disks around exterior pixels instead of iterating them
+ * @return number of pixels which were iterated
+ */
+unsigned long long julia_distance_render(Arguments* args, xmm_helpers* helpers, float* distance, size_t width,
+                                                                            const Region* region, bool fill);
+
+/**
+ * @brief distance estimation of the whole planned image with several threads, in bands of
+ * DEFAULT_BAND_HEIGHT rows. Disks are only filled inside the band of the exterior pixel.
+ * Only the quadratic family is supported.
+ * 
+ * @param plan plan of the render
+ * @param distance distance of every pixel, width * height entries, row-major
+ * @param fill fill disks around exterior pixels instead of iterating them
+ * @param threads number of threads including the calling thread
+ * @param iterated number of iterated pixels is written here
+ * @return 0 on success, -1 if the family is not supported or workers could not be created
+ */
+int render_distance(JuliaPlan* plan, float* distance, bool fill, int threads, unsigned long long* iterated);
+
+/**
+ * @brief color an image from estimated distances. Boundary pixels (closer than DE_BOUNDARY pixels)
+ * and the interior are black, the exterior gets brighter with the distance from the set.
+ * 
+ * @param img image data, rgb values are written into img->buffer
+ * @param distance distance of every pixel, width * height entries, row-major
+ * @param res distance of neighbouring pixels in the complex plane
+ */
+void color_distance(Image* img, const float* distance, float res);
+
+#endif
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <complex.h>
+
+#include "julia.h"
+#include "util.h"
+#include "plan.h"
+#include "sample.h"
+#include "estimate.h"
+
+/**
+ * @return stride of the sample grid, SAMPLE_STRIDE or larger so that there are at most ESTIMATE_MAX_SAMPLES samples
+ */
+static size_t estimate_stride(size_t width, size_t height) {
+    size_t stride = SAMPLE_STRIDE;
+    while (sample_count(width, height, stride) > ESTIMATE_MAX_SAMPLES) {
+        stride *= 2;
+    }
+    return stride;
+}
+
+/**
+ * @return seconds of a render with the given number of pixels and lane iterations
+ */
+static double seconds_of(const JuliaRate* rate, double pixels, double lane_iterations) {
+    return pixels * rate->ns_per_pixel * 1e-9 + lane_iterations / (rate->giter_per_s * 1e9);
+}
+
+//sums over the sampled groups of one predicted quantity, for its mean and sampling error
+typedef struct {
+    double sum;
+    double low;
+    double high;
+    double squares;
+} Tally;
+
+static void tally_add(Tally* tally, double value, double low, double high) {
+    tally->sum += value;
+    tally->low += low;
+    tally->high += high;
+    tally->squares += value * value;
+}
+
+/**
+ * @brief extrapolate a tally over count samples of lanes pixels each to an image of the given pixels
+ */
+static void tally_extrapolate(const Tally* tally, size_t count, size_t lanes, double pixels, double* value,
+                                                                                double* low, double* high) {
+    double mean = tally->sum / count;
+    double variance = (count > 1) ? (tally->squares - count * mean * mean) / (count - 1) : 0.0;
+    double error = ESTIMATE_Z * sqrt((variance > 0.0) ? variance / count : 0.0);
+    double scale = pixels / lanes;
+    *value = mean * scale;
+    *low = (tally->low / count - error) * scale;
+    if (*low < pixels) {
+        //every pixel needs at least one iteration
+        *low = pixels;
+    }
+    *high = (tally->high / count + error) * scale;
+}
+
+int julia_estimate(const JuliaParams* params, const JuliaRate* rate, JuliaEstimate* estimate) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (params->width == 0 || params->height == 0 || !(rate->giter_per_s > 0.0) || rate->ns_per_pixel < 0.0
+                                                                                        || rate->error < 0.0) {
+        fprintf(stderr, "Invalid argument. Estimate needs an image size and a positive rate.\n");
+        return -1;
+    }
+    Arguments args;
+    init_args(&args, params->c, params->start, params->res, params->n);
+    if (init_family(&args, params->family, params->degree, params->bailout) != 0) {
+        return -1;
+    }
+    unsigned n = params->n;
+    unsigned cap = (n < ESTIMATE_CAP) ? n : ESTIMATE_CAP;
+    args.n = cap;
+
+    size_t stride = estimate_stride(params->width, params->height);
+    size_t count = sample_count(params->width, params->height, stride);
+    unsigned* values = malloc(4 * count * sizeof(unsigned));
+    if (values == NULL) {
+        fprintf(stderr, "Could not allocate memory for %lu samples.\n", count);
+        return -1;
+    }
+    if (sample_groups(&args, params->width, params->height, stride, values) == 0) {
+        free(values);
+        return -1;
+    }
+    //narrow images have groups with repeated pixels, only the first lanes of a group are real
+    size_t lanes = (params->width < 4) ? params->width : 4;
+
+    //escaped pixels cost exactly their iteration number. Pixels still inside at the cap (censored)
+    //cost n if they belong to the set. Pixels escaping just below the cap show how many censored
+    //pixels still escape: with a density falling like 1/k^2, as many escape in [cap, 2 cap) and later
+    //as in [cap/2, cap).
+    size_t censored = 0;
+    size_t tail = 0;
+    for (size_t i=0; i<count; i++) {
+        for (size_t l=0; l<lanes; l++) {
+            unsigned k = values[4 * i + l];
+            censored += (k == BLACK);
+            tail += (k != BLACK && k >= cap / 2);
+        }
+    }
+    double late = 0.0; //fraction of censored pixels escaping before n, at about 2 cap
+    double late_max = 0.0;
+    if (cap < n && censored > 0) {
+        late = (double) ((tail < censored) ? tail : censored) / censored;
+        late_max = (double) ((2 * tail < censored) ? 2 * tail : censored) / censored;
+    }
+    double late_cost = (2.0 * cap < n) ? 2.0 * cap : n;
+
+    //a group costs lanes times its slowest pixel. It only finishes early if all its censored pixels escape late.
+    Tally iterations = {0.0, 0.0, 0.0, 0.0};
+    Tally lane_iterations = {0.0, 0.0, 0.0, 0.0};
+    for (size_t i=0; i<count; i++) {
+        double exact = 0.0;
+        unsigned longest = 0;
+        unsigned inside = 0;
+        for (size_t l=0; l<lanes; l++) {
+            unsigned k = values[4 * i + l];
+            if (k == BLACK) {
+                inside++;
+            } else {
+                exact += k;
+                longest = (k > longest) ? k : longest;
+            }
+        }
+        tally_add(&iterations, exact + inside * (late * late_cost + (1.0 - late) * n),
+                                exact + inside * (late_max * cap + (1.0 - late_max) * n), exact + inside * (double) n);
+        if (inside == 0) {
+            tally_add(&lane_iterations, lanes * (double) longest, lanes * (double) longest, lanes * (double) longest);
+            continue;
+        }
+        double all_late = pow(late, inside);
+        double all_late_max = pow(late_max, inside);
+        double point = all_late * ((longest > late_cost) ? longest : late_cost) + (1.0 - all_late) * n;
+        double low = all_late_max * ((longest > cap) ? longest : cap) + (1.0 - all_late_max) * n;
+        tally_add(&lane_iterations, lanes * point, lanes * low, lanes * (double) n);
+    }
+    free(values);
+
+    double pixels = (double) params->width * params->height;
+    tally_extrapolate(&iterations, count, lanes, pixels, &estimate->iterations, &estimate->iterations_low,
+                                                                                &estimate->iterations_high);
+    double lane_low;
+    double lane_high;
+    tally_extrapolate(&lane_iterations, count, lanes, pixels, &estimate->lane_iterations, &lane_low, &lane_high);
+    estimate->seconds = seconds_of(rate, pixels, estimate->lane_iterations);
+    double spread = ESTIMATE_Z * rate->error;
+    estimate->seconds_low = seconds_of(rate, pixels, lane_low) * ((spread < 1.0) ? 1.0 - spread : 0.0);
+    estimate->seconds_high = seconds_of(rate, pixels, lane_high) * (1.0 + spread);
+    estimate->samples = count;
+    estimate->cap = cap;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    estimate->sample_seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    return 0;
+}
+
+/**
+ * @return lane iterations of a field: every group of 4 pixels of a row costs 4 times its largest
+ * iteration number, pixels of an incomplete group at the end of a row cost their own
+ */
+static double lane_iterations_of(const unsigned* field, size_t width, size_t height, unsigned n) {
+    double total = 0.0;
+    for (size_t y=0; y<height; y++) {
+        const unsigned* row = field + y * width;
+        size_t groups = width / 4 * 4;
+        for (size_t x=0; x<groups; x+=4) {
+            unsigned longest = 0;
+            for (size_t l=0; l<4; l++) {
+                unsigned k = (row[x + l] == BLACK) ? n : row[x + l];
+                longest = (k > longest) ? k : longest;
+            }
+            total += 4.0 * longest;
+        }
+        for (size_t x=groups; x<width; x++) {
+            total += (row[x] == BLACK) ? n : row[x];
+        }
+    }
+    return total;
+}
+
+/**
+ * @return median seconds of CALIBRATION_REPETITIONS executions of plan after one untimed execution
+ */
+static double median_seconds(JuliaPlan* plan, unsigned char* buffer) {
+    double times[CALIBRATION_REPETITIONS];
+    julia_plan_execute(plan, buffer);
+    for (int r=0; r<CALIBRATION_REPETITIONS; r++) {
+        struct timespec start;
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        julia_plan_execute(plan, buffer);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double t = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+        //insertion sort, there are only a few times
+        int i = r;
+        for (; i>0 && times[i - 1] > t; i--) {
+            times[i] = times[i - 1];
+        }
+        times[i] = t;
+    }
+    return times[CALIBRATION_REPETITIONS / 2];
+}
+
+int julia_calibrate(int implementation, JuliaRate* rate) {
+    if (!julia_implementation_supported(implementation)) {
+        fprintf(stderr, "Implementation %d is not supported by this processor.\n", implementation);
+        return -1;
+    }
+    float complex start = -1.5 + -1.5 * I;
+    size_t size = CALIBRATION_SIZE;
+    unsigned char* buffer = malloc(size * size * 3);
+    unsigned* field = malloc(size * size * sizeof(unsigned));
+    if (buffer == NULL || field == NULL) {
+        fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", size, size);
+        free(buffer);
+        free(field);
+        return -1;
+    }
+
+    //every c value with a low and a high limit, the cheap renders pin down the cost per pixel
+    unsigned limits[] = {CALIBRATION_N_LOW, CALIBRATION_N};
+    double lanes[20];
+    double seconds[20];
+    int status = 0;
+    for (int i=0; i<20 && status == 0; i++) {
+        //same views as benchmark_suite
+        Arguments args;
+        init_args(&args, c_values[i / 2], start, 3.0f/size, limits[i % 2]);
+        JuliaParams params;
+        plan_params(&params, INTRIN_V0, &args, size, size);
+        JuliaPlan* reference = julia_plan_create(&params);
+        plan_params(&params, implementation, &args, size, size);
+        JuliaPlan* plan = julia_plan_create(&params);
+        if (reference == NULL || plan == NULL) {
+            status = -1;
+        } else {
+            //iteration numbers of the bit-exact kernel, fma kernels differ in a few pixels only
+            julia_plan_execute_field(reference, field);
+            lanes[i] = lane_iterations_of(field, size, size, args.n);
+            seconds[i] = median_seconds(plan, buffer);
+        }
+        julia_plan_destroy(reference);
+        julia_plan_destroy(plan);
+    }
+    free(buffer);
+    free(field);
+    if (status != 0) {
+        return -1;
+    }
+
+    double mean_lanes = 0.0;
+    double mean_seconds = 0.0;
+    for (int i=0; i<20; i++) {
+        mean_lanes += lanes[i] / 20;
+        mean_seconds += seconds[i] / 20;
+    }
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (int i=0; i<20; i++) {
+        covariance += (lanes[i] - mean_lanes) * (seconds[i] - mean_seconds);
+        variance += (lanes[i] - mean_lanes) * (lanes[i] - mean_lanes);
+    }
+    double slope = (variance > 0.0) ? covariance / variance : 0.0;
+    double intercept = mean_seconds - slope * mean_lanes;
+    if (slope <= 0.0 || intercept < 0.0) {
+        //timing noise, fall back to lane iterations only
+        slope = mean_seconds / mean_lanes;
+        intercept = 0.0;
+    }
+    //the scatter of the renders around the line is the error of a prediction, timing noise included
+    double residuals = 0.0;
+    for (int i=0; i<20; i++) {
+        double relative = (seconds[i] - (intercept + slope * lanes[i])) / seconds[i];
+        residuals += relative * relative;
+    }
+    rate->giter_per_s = 1e-9 / slope;
+    rate->ns_per_pixel = intercept / (size * size) * 1e9;
+    rate->error = sqrt(residuals / (20 - 2));
+    if (rate->error < CALIBRATION_MIN_ERROR) {
+        //the machine is not as quiet later as during calibration
+        rate->error = CALIBRATION_MIN_ERROR;
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef MY_ESTIMATE
+#define MY_ESTIMATE
+
+#include "julia.h"
+
+//iteration cap of the samples of julia_estimate, the cost of a sample is at most this
+#define ESTIMATE_CAP 256
+//largest number of samples, the stride grows with the image so the estimate takes constant time
+#define ESTIMATE_MAX_SAMPLES 16384
+//z value of the interval (95%)
+#define ESTIMATE_Z 1.96
+
+//image size, iteration limits and timed executions of julia_calibrate
+#define CALIBRATION_SIZE 400
+#define CALIBRATION_N 500
+#define CALIBRATION_N_LOW 16
+#define CALIBRATION_REPETITIONS 3
+//smallest relative error of a calibrated rate
+#define CALIBRATION_MIN_ERROR 0.05
+
+#endif
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "util.h"
+#include "sample.h"
+#include "distance.h"
+#include "frame.h"
+
+/**
+ * @brief mark the points of the grid which belong to the set with the escape time: the points needing
+ * at least half as many iterations as the slowest point
+ *
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+static int near_by_iterations(Arguments* grid, unsigned* values, bool* near) {
+    if (sample_grid(grid, FRAME_GRID, FRAME_GRID, 1, values) == 0) {
+        return -1;
+    }
+    unsigned longest = 0;
+    for (size_t i=0; i<FRAME_GRID * FRAME_GRID; i++) {
+        values[i] = (values[i] == BLACK) ? grid->n : values[i];
+        longest = (values[i] > longest) ? values[i] : longest;
+    }
+    for (size_t i=0; i<FRAME_GRID * FRAME_GRID; i++) {
+        near[i] = (2 * values[i] >= longest);
+    }
+    return 0;
+}
+
+/**
+ * @brief mark the points of the grid closer than FRAME_DISTANCE cells to the julia set by distance
+ * estimation, which also finds thin parts (dendrites, tips on the real axis) escaping fast
+ */
+static void near_by_distance(Arguments* grid, bool* near) {
+    Arguments estimate = *grid;
+    distance_radius(&estimate);
+    float start_x = crealf(grid->start);
+    float start_y = cimagf(grid->start);
+    for (size_t y=0; y<FRAME_GRID; y++) {
+        for (size_t x=0; x<FRAME_GRID; x++) {
+            float d = iterate_distance(start_x + x * grid->res, start_y + y * grid->res, &estimate);
+            near[y * FRAME_GRID + x] = (d < FRAME_DISTANCE * grid->res);
+        }
+    }
+}
+
+/**
+ * @brief iterate a FRAME_GRID x FRAME_GRID grid of square cells centred in the box low, high and
+ * replace the box by the bounding box of the samples belonging to the set
+ *
+ * @return size of a cell of the grid, 0 if memory could not be allocated
+ */
+static float frame_pass(Arguments* args, unsigned* values, bool* near, float complex* low, float complex* high) {
+    float extent = fmaxf(crealf(*high - *low), cimagf(*high - *low));
+    Arguments grid = *args;
+    grid.res = extent / (FRAME_GRID - 1);
+    grid.start = (*low + *high) / 2 - (FRAME_GRID - 1) / 2.0f * grid.res * (1 + I);
+    grid.n = (args->n < FRAME_CAP) ? args->n : FRAME_CAP;
+    if (grid.family == FAMILY_QUADRATIC) {
+        near_by_distance(&grid, near);
+    } else if (near_by_iterations(&grid, values, near) != 0) {
+        return 0.0f;
+    }
+
+    size_t min_x = FRAME_GRID;
+    size_t min_y = FRAME_GRID;
+    size_t max_x = 0;
+    size_t max_y = 0;
+    for (size_t y=0; y<FRAME_GRID; y++) {
+        for (size_t x=0; x<FRAME_GRID; x++) {
+            if (!near[y * FRAME_GRID + x]) {
+                continue;
+            }
+            min_x = (x < min_x) ? x : min_x;
+            max_x = (x > max_x) ? x : max_x;
+            min_y = (y < min_y) ? y : min_y;
+            max_y = (y > max_y) ? y : max_y;
+        }
+    }
+    if (min_x > max_x) {
+        //no sample close enough, keep the box
+        return grid.res;
+    }
+    *low = grid.start + (min_x + I * min_y) * grid.res;
+    *high = grid.start + (max_x + I * max_y) * grid.res;
+    return grid.res;
+}
+
+int frame_julia(Arguments* args, size_t width, size_t height, float margin, Frame* frame) {
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (!(margin >= 0.0f && margin <= 0.45f) || width == 0 || height == 0) {
+        fprintf(stderr, "Invalid argument. The margin of a frame must be between 0 and 0.45.\n");
+        return -1;
+    }
+    unsigned* values = malloc(FRAME_GRID * FRAME_GRID * sizeof(unsigned));
+    bool* near = malloc(FRAME_GRID * FRAME_GRID * sizeof(bool));
+    if (values == NULL || near == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d samples.\n", FRAME_GRID * FRAME_GRID);
+        free(values);
+        free(near);
+        return -1;
+    }
+    //every point of the filled julia set stays inside the escape radius
+    float radius = sqrtf(args->radius_sqr);
+    float complex low = -radius * (1 + I);
+    float complex high = radius * (1 + I);
+    float cell = frame_pass(args, values, near, &low, &high);
+    if (cell == 0.0f) {
+        free(values);
+        free(near);
+        return -1;
+    }
+    //samples next to the box may have missed thin parts of the set
+    low -= cell * (1 + I);
+    high += cell * (1 + I);
+    cell = frame_pass(args, values, near, &low, &high);
+    free(values);
+    free(near);
+    if (cell == 0.0f) {
+        return -1;
+    }
+    low -= cell * (1 + I);
+    high += cell * (1 + I);
+
+    //the larger of both extents fills its side of the image up to the margin
+    float usable = 1.0f - 2.0f * margin;
+    float res_x = crealf(high - low) / (usable * width);
+    float res_y = cimagf(high - low) / (usable * height);
+    frame->res = (res_x > res_y) ? res_x : res_y;
+    //pixel x, y lies at start + (x + y i) * res, the box is centred in the image
+    frame->start = (low + high) / 2 - ((width - 1) / 2.0f + I * ((height - 1) / 2.0f)) * frame->res;
+    frame->low = low;
+    frame->high = high;
+    frame->samples = 2 * FRAME_GRID * FRAME_GRID;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    frame->seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef MY_FRAME
+#define MY_FRAME
+
+#include <complex.h>
+
+#include "util.h"
+
+//samples per side of the grids of frame_julia
+#define FRAME_GRID 128
+//iteration cap of the samples, pixels still inside then belong to the filled julia set
+#define FRAME_CAP 64
+//samples closer than this many grid cells to the julia set (by distance estimation) belong to the set
+#define FRAME_DISTANCE 1.0f
+//default empty border around the set, as share of the image width and height on every side
+#define FRAME_DEFAULT_MARGIN 0.05f
+
+//view chosen by frame_julia
+typedef struct {
+    float complex start; //start of the image, as for -s
+    float res; //step size of the image, as for -r
+    float complex low; //bounding box of the filled julia set, lower left corner
+    float complex high; //upper right corner
+    size_t samples; //points iterated
+    double seconds; //time spent
+} Frame;
+
+/**
+ * @brief choose start and step size of a width x height image so that the filled julia set of args
+ * fills it up to a margin. The set lies in the disk of the escape radius, a FRAME_GRID x FRAME_GRID
+ * grid over that disk is iterated with a cap of FRAME_CAP and a second grid of the same size over
+ * the box found by the first one refines it. For the quadratic family the box holds all samples within
+ * FRAME_DISTANCE cells of the julia set by distance estimation, which also finds dendrites, dust and
+ * thin tips. Other families take the samples needing at least half as many iterations as the slowest
+ * sample. The box grows by one cell of the second grid, so that parts between samples are not cut
+ * off. Takes a few milliseconds.
+ *
+ * @param args julia arguments, c, family and escape radius are used
+ * @param width width of the image
+ * @param height height of the image
+ * @param margin empty border on every side as share of width and height, 0 to 0.45
+ * @param frame chosen view and bounding box
+ * @return 0 on success, -1 if the margin is invalid or memory could not be allocated
+ */
+int frame_julia(Arguments* args, size_t width, size_t height, float margin, Frame* frame);
+
+#endif
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "trace.h"
+#include "histcolor.h"
+
+//state shared by all workers of one coloring
+typedef struct {
+    Image* img;
+    const unsigned* field;
+    const uint16_t* field16;
+    size_t pixels;
+    size_t bins; //largest iteration number in the field + 1
+    int threads;
+    bool avx2; //map pixels with avx2 gathers
+    unsigned* maxima; //largest iteration number in the part of every worker
+    uint32_t* histograms; //HIST_LANES histograms of every worker, bins entries each
+    unsigned long long* merged; //histogram of the whole image
+    uint32_t* lut; //color of every iteration number, blue | green << 8 | red << 16
+} hist_job;
+
+//state of one worker, every worker has a fixed part of pixels and bins
+typedef struct {
+    hist_job* job;
+    int id;
+} hist_worker;
+
+/**
+ * @return iteration number at index i of a 16-bit or 32-bit field.
+ * Called with a constant narrow, the compiler generates one loop for each field type.
+ */
+__attribute__((always_inline))
+static inline unsigned field_value(const hist_job* job, bool narrow, size_t i) {
+    return narrow ? job->field16[i] : job->field[i];
+}
+
+/**
+ * @brief first and last + 1 entry of count entries taken by worker id
+ */
+static void worker_range(const hist_worker* worker, size_t count, size_t* begin, size_t* end) {
+    int threads = worker->job->threads;
+    *begin = count * worker->id / threads;
+    *end = count * (worker->id + 1) / threads;
+}
+
+__attribute__((always_inline))
+static inline unsigned max_value(const hist_job* job, bool narrow, size_t begin, size_t end) {
+    unsigned max = 0;
+    for (size_t i=begin; i<end; i++) {
+        unsigned value = field_value(job, narrow, i);
+        max = value > max ? value : max;
+    }
+    return max;
+}
+
+/**
+ * @brief pass 0: largest iteration number of the pixels of the worker, sizes the histograms
+ */
+static void* max_run(void* arg) {
+    hist_worker* worker = arg;
+    hist_job* job = worker->job;
+    uint64_t start = trace_now();
+    size_t begin;
+    size_t end;
+    worker_range(worker, job->pixels, &begin, &end);
+
+    if (job->field != NULL) {
+        job->maxima[worker->id] = max_value(job, false, begin, end);
+    } else {
+        job->maxima[worker->id] = max_value(job, true, begin, end);
+    }
+    trace_event("max", start);
+    return NULL;
+}
+
+__attribute__((always_inline))
+static inline void count_pixels(hist_job* job, bool narrow, uint32_t* lanes, size_t begin, size_t end) {
+    size_t bins = job->bins;
+    //neighbouring pixels mostly have the same iteration number, interleaved histograms do not wait
+    //for the previous increment of the same bin
+    size_t i = begin;
+    for (; i + HIST_LANES <= end; i += HIST_LANES) {
+        for (int l=0; l<HIST_LANES; l++) {
+            lanes[l * bins + field_value(job, narrow, i + l)]++;
+        }
+    }
+    for (; i < end; i++) {
+        lanes[field_value(job, narrow, i)]++;
+    }
+}
+
+/**
+ * @brief pass 1: count the pixels of the worker into its own histograms
+ */
+static void* count_run(void* arg) {
+    hist_worker* worker = arg;
+    hist_job* job = worker->job;
+    uint64_t start = trace_now();
+    size_t begin;
+    size_t end;
+    worker_range(worker, job->pixels, &begin, &end);
+
+    uint32_t* lanes = job->histograms + (size_t) worker->id * HIST_LANES * job->bins;
+    if (job->field != NULL) {
+        count_pixels(job, false, lanes, begin, end);
+    } else {
+        count_pixels(job, true, lanes, begin, end);
+    }
+    trace_event("histogram", start);
+    return NULL;
+}
+
+/**
+ * @brief pass 2: sum the histograms of all workers for the bins of the worker
+ */
+static void* merge_run(void* arg) {
+    hist_worker* worker = arg;
+    hist_job* job = worker->job;
+    uint64_t start = trace_now();
+    size_t begin;
+    size_t end;
+    worker_range(worker, job->bins, &begin, &end);
+
+    for (size_t b=begin; b<end; b++) {
+        job->merged[b] = 0;
+    }
+    for (size_t h=0; h<(size_t) job->threads * HIST_LANES; h++) {
+        const uint32_t* histogram = job->histograms + h * job->bins;
+        for (size_t b=begin; b<end; b++) {
+            job->merged[b] += histogram[b];
+        }
+    }
+    trace_event("merge", start);
+    return NULL;
+}
+
+/**
+ * @brief pass 3: prefix sum of the escaping pixels and lookup table, over n entries in one thread
+ */
+static void build_lut(hist_job* job) {
+    uint64_t start = trace_now();
+    unsigned long long escaped = 0;
+    for (size_t b=1; b<job->bins; b++) {
+        escaped += job->merged[b];
+    }
+
+    job->lut[BLACK] = 0;
+    //pixels with fewer iterations than the current bin
+    unsigned long long below = 0;
+    for (size_t b=1; b<job->bins; b++) {
+        //below < escaped, so escaping pixels never become black
+        unsigned char color = 255 - (unsigned char) (255 * below / (escaped > 0 ? escaped : 1));
+        //black - lila coloring, same as color_pixel
+        job->lut[b] = color | (uint32_t) (color >> 2) << 8 | (uint32_t) (color >> 1) << 16;
+        below += job->merged[b];
+    }
+    trace_event("cdf", start);
+}
+
+/**
+ * @brief map 8 pixels at once with a gather from the lookup table. The 4 byte colors are
+ * compressed to 3 byte rgb values and written with two overlapping 16 byte stores.
+ * The second store writes 4 bytes past the 8 pixels, so 2 more pixels of the worker must follow.
+ * Only called if the cpu supports avx2.
+ * 
+ * @return first pixel which is not mapped yet
+ */
+__attribute__((target("avx2")))
+static size_t map_pixels_avx2(hist_job* job, bool narrow, size_t begin, size_t end) {
+    unsigned char* buffer = job->img->buffer;
+    //bytes 0-2 of every color, the last 4 bytes of each 128-bit lane are not used
+    const __m256i compress = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                              0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = begin;
+    for (; i + 10 <= end; i += 8) {
+        __m256i index = narrow ? _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (job->field16 + i)))
+                               : _mm256_loadu_si256((const __m256i*) (job->field + i));
+        __m256i colors = _mm256_i32gather_epi32((const int*) job->lut, index, 4);
+        colors = _mm256_shuffle_epi8(colors, compress);
+        _mm_storeu_si128((__m128i*) (buffer + 3 * i), _mm256_castsi256_si128(colors));
+        _mm_storeu_si128((__m128i*) (buffer + 3 * i + 12), _mm256_extracti128_si256(colors, 1));
+    }
+    return i;
+}
+
+__attribute__((always_inline))
+static inline void map_pixels(hist_job* job, bool narrow, size_t begin, size_t end) {
+    unsigned char* buffer = job->img->buffer;
+    size_t i = begin;
+    if (job->avx2) {
+        i = map_pixels_avx2(job, narrow, begin, end);
+    }
+    for (; i < end; i++) {
+        uint32_t color = job->lut[field_value(job, narrow, i)];
+        buffer[3 * i] = color; //blue
+        buffer[3 * i + 1] = color >> 8; //green
+        buffer[3 * i + 2] = color >> 16; //red
+    }
+}
+
+/**
+ * @brief pass 4: color the pixels of the worker with the lookup table
+ */
+static void* map_run(void* arg) {
+    hist_worker* worker = arg;
+    hist_job* job = worker->job;
+    uint64_t start = trace_now();
+    size_t begin;
+    size_t end;
+    worker_range(worker, job->pixels, &begin, &end);
+
+    if (job->field != NULL) {
+        map_pixels(job, false, begin, end);
+    } else {
+        map_pixels(job, true, begin, end);
+    }
+    trace_event("map", start);
+    return NULL;
+}
+
+/**
+ * @brief run one pass on all workers and wait until all of them are done.
+ * The calling thread is worker 0 and takes over the parts of threads which could not be created.
+ */
+static void run_pass(hist_worker* workers, pthread_t* ids, int threads, void* (*pass)(void*)) {
+    int started = 0;
+    for (int t=1; t<threads; t++) {
+        if (pthread_create(&ids[t], NULL, pass, &workers[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+    pass(&workers[0]);
+    for (int t=started+1; t<threads; t++) {
+        pass(&workers[t]);
+    }
+    for (int t=1; t<=started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+}
+
+int color_histogram(Image* img, const unsigned* field, const uint16_t* field16, unsigned n, int threads) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    hist_job job;
+    job.img = img;
+    job.field = field;
+    job.field16 = field16;
+    job.pixels = img->width * img->height;
+    job.threads = threads;
+    job.avx2 = __builtin_cpu_supports("avx2");
+    job.maxima = malloc(sizeof(unsigned) * threads);
+    hist_worker* workers = malloc(sizeof(hist_worker) * threads);
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    if (job.maxima == NULL || workers == NULL || ids == NULL) {
+        fprintf(stderr, "Could not allocate memory for histogram coloring with %d threads.\n", threads);
+        free(job.maxima);
+        free(workers);
+        free(ids);
+        return -1;
+    }
+    for (int t=0; t<threads; t++) {
+        workers[t].job = &job;
+        workers[t].id = t;
+    }
+
+    //bins only up to the largest iteration number which occurs, not up to n
+    run_pass(workers, ids, threads, max_run);
+    unsigned max = 0;
+    for (int t=0; t<threads; t++) {
+        max = job.maxima[t] > max ? job.maxima[t] : max;
+    }
+    job.bins = (size_t) (max < n ? max : n) + 1;
+    job.histograms = calloc((size_t) threads * HIST_LANES * job.bins, sizeof(uint32_t));
+    job.merged = malloc(job.bins * sizeof(unsigned long long));
+    job.lut = malloc(job.bins * sizeof(uint32_t));
+    if (job.histograms == NULL || job.merged == NULL || job.lut == NULL) {
+        fprintf(stderr, "Could not allocate memory for histogram coloring with %d threads.\n", threads);
+        free(job.histograms);
+        free(job.merged);
+        free(job.lut);
+        free(job.maxima);
+        free(workers);
+        free(ids);
+        return -1;
+    }
+
+    run_pass(workers, ids, threads, count_run);
+    run_pass(workers, ids, threads, merge_run);
+    build_lut(&job);
+    run_pass(workers, ids, threads, map_run);
+
+    free(job.histograms);
+    free(job.merged);
+    free(job.lut);
+    free(job.maxima);
+    free(workers);
+    free(ids);
+    return 0;
+}
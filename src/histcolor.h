@@ -0,0 +1,32 @@
+#ifndef MY_HISTCOLOR
+#define MY_HISTCOLOR
+
+#include "util.h"
+
+//histograms per thread, neighbouring pixels count into different histograms
+#define HIST_LANES 4
+
+/**
+ * @brief color an image from its iteration numbers with histogram equalisation.
+ * An escaping pixel gets a color proportional to the share of escaping pixels which needed fewer
+ * iterations, so the color range is spread over the iteration numbers that actually occur instead
+ * of 0..n. Few iterations are bright and many are dark as with map_to_color, convergent pixels
+ * (BLACK) stay black.
+ * 
+ * Runs in five passes: every thread finds the largest iteration number of its part of the field,
+ * which sizes the histograms, counts its part into its own histograms, the histograms are merged
+ * by every thread for its own range of iteration numbers, the prefix sum (cdf) over the bins is
+ * turned into a lookup table of rgb values, and every thread maps its part of the field through
+ * the table (with avx2 gathers if the cpu supports avx2).
+ * Only the prefix sum over at most n entries is serial, all passes over pixels run in parallel.
+ * 
+ * @param img image data, rgb values are written into img->buffer
+ * @param field iteration numbers, width * height entries, row-major. NULL if field16 is given
+ * @param field16 16-bit iteration numbers, only used if field is NULL
+ * @param n maximum number of iterations of the render
+ * @param threads number of threads including the calling thread
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int color_histogram(Image* img, const unsigned* field, const uint16_t* field16, unsigned n, int threads);
+
+#endif
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <complex.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "naive.h"
+#include "intrin_deferred.h"
+
+/**
+ * @brief iterate 4 points until all escaped or n iterations are done.
+ *
+ * @param reals real parts of the points
+ * @param imags imaginary parts
+ * @param helpers broadcast constants
+ * @param n maximum number of iterations
+ * @return number of iterations every point stayed in escape radius
+ */
+static __m128i iterate_points(__m128 reals, __m128 imags, xmm_helpers* helpers, unsigned n) {
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+    __m128i ones = helpers->ones;
+    __m128i blocks = _mm_set1_epi32(BAILOUT_BLOCK);
+
+    __m128i iterations = _mm_setzero_si128();
+    __m128 inside = (__m128) _mm_set1_epi32(-1); //all bits set for points which did not escape yet
+    int mask = 15;
+
+    unsigned done = 0;
+    while (done < n) {
+        unsigned block = (n - done < BAILOUT_BLOCK) ? n - done : BAILOUT_BLOCK;
+
+        if (block == BAILOUT_BLOCK) {
+            __m128 saved_reals = reals;
+            __m128 saved_imags = imags;
+
+            //unchecked iterations, same operations as julia_render.
+            //escaped points may overflow to inf or nan, both compare as outside below.
+            for (int i=0; i<BAILOUT_BLOCK; i++) {
+                __m128 _re = _mm_mul_ps(reals, reals);
+                __m128 _im = _mm_mul_ps(imags, imags);
+                imags = _mm_mul_ps(reals, imags);
+                imags = _mm_mul_ps(imags, twos);
+                imags = _mm_add_ps(imags, cim);
+                reals = _mm_sub_ps(_re, _im);
+                reals = _mm_add_ps(reals, cre);
+            }
+            __m128 abs = _mm_add_ps(_mm_mul_ps(reals, reals), _mm_mul_ps(imags, imags));
+            //no point escaped in this block: all points still inside were inside in every iteration
+            if ((_mm_movemask_ps(_mm_cmple_ps(abs, rds)) & mask) == mask) {
+                iterations = _mm_add_epi32(iterations, _mm_and_si128(blocks, (__m128i) inside));
+                done += BAILOUT_BLOCK;
+                continue;
+            }
+            //replay the block with a check after every iteration
+            reals = saved_reals;
+            imags = saved_imags;
+        }
+
+        for (unsigned i=0; i<block; i++) {
+            __m128 _re = _mm_mul_ps(reals, reals); //re^2
+            __m128 _im = _mm_mul_ps(imags, imags); //im^2
+            inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(_re, _im), rds));
+            mask = _mm_movemask_ps(inside);
+            iterations = _mm_add_epi32(iterations, _mm_and_si128(ones, (__m128i) inside));
+            if (mask == 0) {
+                return iterations;
+            }
+            imags = _mm_mul_ps(reals, imags); //re * im
+            imags = _mm_mul_ps(imags, twos); //2 * re * im
+            imags = _mm_add_ps(imags, cim); //2*re*im + cim
+            reals = _mm_sub_ps(_re, _im); //re^2 - im^2
+            reals = _mm_add_ps(reals, cre); //re^2 - im^2 + cre
+        }
+        done += block;
+    }
+    return iterations;
+}
+
+/**
+ * @brief iterates all groups of 4 points of the region and writes the iteration numbers with store_lanes
+ */
+static void enumerate(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    __m128 _reals;
+
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=region->x0; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            _reals[(x - region->x0) % 4] = re;
+
+            //begin computation after every 4th iteration (when _reals is filled with 4 new numbers)
+            if ((x - region->x0) % 4 == 3) {
+                __m128i iterations = iterate_points(_reals, _mm_set1_ps(im), helpers, args->n);
+                store_lanes(img, y, x-3, iterations, helpers);
+            }
+        }
+    }
+}
+
+/**
+ * @brief compute remaining columns (less than 4) of every row with the naive approach
+ */
+static void compute_last_points(Arguments* args, Image* img, const Region* region) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t column = region->x1 - ((region->x1 - region->x0) % 4);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+        for (size_t x=column; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            color_pixel(img, y, x, iterate_naive(re, im, args));
+        }
+    }
+}
+
+void julia_deferred_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    enumerate(args, img, helpers, region);
+    if ((region->x1 - region->x0) % 4 != 0) {
+        compute_last_points(args, img, region);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef MY_INTRIN_DEFERRED
+#define MY_INTRIN_DEFERRED
+
+#include "util.h"
+
+//iterations run without escape check
+#define BAILOUT_BLOCK 8
+
+/**
+ * @brief render the given region like julia_render, but check the escape radius only once every
+ * BAILOUT_BLOCK iterations. z is saved at the start of a block. If a pixel escaped during
+ * the block, the block is replayed from the saved z with a check after every iteration,
+ * so the escape iteration is exact and results are bit-exact with julia_render.
+ * Since the escape radius is max{|c|, 2}, a point never comes back into the radius,
+ * so a point inside at the end of a block was inside during the whole block.
+ *
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_deferred_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+#endif
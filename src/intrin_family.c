@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include "julia.h"
+#include "util.h"
+#include "intrin_family.h"
+
+//kernel rendering the pixels of a region which fill whole sse registers
+typedef void (*family_kernel)(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+/**
+ * @brief one step z -> z^d + c (multibrot) or z -> (|re z| + i |im z|)^2 + c (burning ship) of a scalar.
+ * z^d is computed by d-1 complex multiplications w := w * z, exactly like the sse kernels.
+ */
+static inline void step_family(float* re, float* im, float cre, float cim, int family, unsigned degree) {
+    float a = *re;
+    float b = *im;
+    if (family == FAMILY_BURNING_SHIP) {
+        a = fabsf(a);
+        b = fabsf(b);
+        *re = (a*a - b*b) + cre;
+        *im = (a*b)*2 + cim;
+        return;
+    }
+    float wr = a;
+    float wi = b;
+    for (unsigned k=1; k<degree; k++) {
+        float t = wr*a - wi*b;
+        wi = wr*b + wi*a;
+        wr = t;
+    }
+    *re = wr + cre;
+    *im = wi + cim;
+}
+
+unsigned iterate_family(float a, float b, Arguments* args) {
+    float cre = crealf(args->c);
+    float cim = cimagf(args->c);
+
+    //the sse kernels count the starting point as well, a point outside of the radius gets 1
+    if (a*a + b*b > args->radius_sqr) {
+        return 1;
+    }
+    for (unsigned i=1; i<args->n; i++) {
+        step_family(&a, &b, cre, cim, args->family, args->degree);
+
+        //check if complex number is outside of escape radius in complex plane
+        if (a*a + b*b > args->radius_sqr) {
+            return i;
+        }
+    }
+    return BLACK; //choose color 0 -> black
+}
+
+/**
+ * @brief loop of enumerate() of the optimized implementation with the step of the given family.
+ * Called with constant family and degree only, the compiler generates one kernel for each of them.
+ */
+__attribute__((always_inline))
+static inline void enumerate_family(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region,
+                                                                        const int family, const unsigned degree) {
+    __m128 _reals;
+    __m128 _imags;
+
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+    //clears the sign bit
+    __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=region->x0; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            _reals[(x - region->x0) % 4] = re;
+
+            //begin computation after every 4th iteration (when _reals is filled with 4 new numbers)
+            if ((x - region->x0) % 4 == 3) {
+                _imags = _mm_set1_ps(im);
+                __m128i iterations = _mm_setzero_si128();
+                int mask = 15;
+
+                for (unsigned i=0; i<args->n; i++) {
+                    __m128 _re = _mm_mul_ps(_reals, _reals); //re^2
+                    __m128 _im = _mm_mul_ps(_imags, _imags); //im^2
+                    __m128 abs = _mm_cmple_ps(_mm_add_ps(_re, _im), rds);
+
+                    mask = mask & _mm_movemask_ps(abs);
+                    //increment iteration count of points which are still in radius (compare result is -1)
+                    iterations = _mm_sub_epi32(iterations, (__m128i) abs);
+
+                    if (mask == 0) {
+                        break;
+                    }
+                    if (family == FAMILY_BURNING_SHIP) {
+                        __m128 ab = _mm_mul_ps(_mm_and_ps(_reals, abs_mask), _mm_and_ps(_imags, abs_mask));
+                        _imags = _mm_add_ps(_mm_mul_ps(ab, twos), cim); //2*|re|*|im| + cim
+                        _reals = _mm_add_ps(_mm_sub_ps(_re, _im), cre); //re^2 - im^2 + cre
+                    }
+                    else {
+                        //w := z^degree by repeated complex multiplication w := w * z
+                        __m128 wr = _reals;
+                        __m128 wi = _imags;
+                        for (unsigned k=1; k<degree; k++) {
+                            __m128 t = _mm_sub_ps(_mm_mul_ps(wr, _reals), _mm_mul_ps(wi, _imags));
+                            wi = _mm_add_ps(_mm_mul_ps(wr, _imags), _mm_mul_ps(wi, _reals));
+                            wr = t;
+                        }
+                        _reals = _mm_add_ps(wr, cre);
+                        _imags = _mm_add_ps(wi, cim);
+                    }
+                }
+
+                store_lanes(img, y, x-3, iterations, helpers);
+            }
+        }
+    }
+}
+
+//one specialised kernel per family and degree
+#define MULTIBROT_KERNEL(d) \
+    static void enumerate_multibrot##d(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) { \
+        enumerate_family(args, img, helpers, region, FAMILY_MULTIBROT, d); \
+    }
+
+MULTIBROT_KERNEL(3)
+MULTIBROT_KERNEL(4)
+MULTIBROT_KERNEL(5)
+MULTIBROT_KERNEL(6)
+MULTIBROT_KERNEL(7)
+MULTIBROT_KERNEL(8)
+
+static void enumerate_burning_ship(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    enumerate_family(args, img, helpers, region, FAMILY_BURNING_SHIP, 2);
+}
+
+//multibrot kernels indexed by degree - MULTIBROT_MIN_DEGREE
+static const family_kernel multibrot_kernels[MULTIBROT_MAX_DEGREE - MULTIBROT_MIN_DEGREE + 1] = {
+    enumerate_multibrot3, enumerate_multibrot4, enumerate_multibrot5,
+    enumerate_multibrot6, enumerate_multibrot7, enumerate_multibrot8
+};
+
+/**
+ * @brief compute the remaining columns of every row (less than 4) with iterate_family
+ */
+static void compute_last_points(Arguments* args, Image* img, const Region* region) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t column = region->x1 - ((region->x1 - region->x0) % 4);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=column; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            color_pixel(img, y, x, iterate_family(re, im, args));
+        }
+    }
+}
+
+void julia_family_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    //family is chosen once per region, not per iteration
+    family_kernel kernel = (args->family == FAMILY_BURNING_SHIP) ? enumerate_burning_ship
+                                        : multibrot_kernels[args->degree - MULTIBROT_MIN_DEGREE];
+    kernel(args, img, helpers, region);
+    if ((region->x1 - region->x0) % 4 != 0) {
+        compute_last_points(args, img, region);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MY_INTRIN_FAMILY
+#define MY_INTRIN_FAMILY
+
+#include "util.h"
+
+/**
+ * @brief scalar iteration function of the family selected in args, same operations and same
+ * order as julia_family_render. Used for remaining columns of the family kernels.
+ *
+ * @param re real part of starting point
+ * @param im imaginary part of starting point
+ * @param args julia arguments with family FAMILY_MULTIBROT or FAMILY_BURNING_SHIP
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_family(float re, float im, Arguments* args);
+
+/**
+ * @brief render the given region with the loop of julia_render for the iteration family selected in args.
+ * Every family (and every multibrot degree) has its own kernel specialised at compile time,
+ * so the main iterations loop does not branch on the family.
+ * Results are bit-exact with the family references of the correctness tests.
+ *
+ * @param args julia arguments with family FAMILY_MULTIBROT or FAMILY_BURNING_SHIP
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_family_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <complex.h>
+#include <math.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "intrin_fma.h"
+
+unsigned iterate_fma(float a, float b, Arguments* args) {
+    float cre = crealf(args->c);
+    float cim = cimagf(args->c);
+    float b2 = b*b;
+
+    for (unsigned i=1; i<args->n; i++) {
+        //same operations as one step of the fma kernels
+        float a_next = fmaf(a, a, -b2) + cre; //a^2 - b^2 + cre, rounded once before adding cre
+        b = fmaf(a + a, b, cim); //2ab + cim
+        a = a_next;
+        b2 = b*b;
+
+        //check if complex number is outside of escape radius in complex plane
+        if (fmaf(a, a, b2) > args->radius_sqr) {
+            return i;
+        }
+    }
+    return BLACK; //choose color 0 -> black
+}
+
+/**
+ * @brief compute points of the remaining columns of a region (less than one register wide) with iterate_fma
+ */
+static void compute_last_points(Arguments* args, Image* img, const Region* region, size_t lanes) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t column = region->x1 - ((region->x1 - region->x0) % lanes);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=column; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            color_pixel(img, y, x, iterate_fma(re, im, args));
+        }
+    }
+}
+
+/**
+ * @brief same loop as enumerate() of the optimized implementation, complex multiplication
+ * and absolute value use fused multiply-add.
+ */
+__attribute__((target("fma")))
+static void enumerate_fma(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    __m128 _reals;
+    __m128 _imags;
+
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=region->x0; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            _reals[(x - region->x0) % 4] = re;
+
+            //begin computation after every 4th iteration (when _reals is filled with 4 new numbers)
+            if ((x - region->x0) % 4 == 3) {
+                _imags = _mm_set1_ps(im);
+                __m128i iterations = _mm_setzero_si128();
+                int mask = 15;
+
+                for (unsigned i=0; i<args->n; i++) {
+                    __m128 _im = _mm_mul_ps(_imags, _imags); //im^2
+                    __m128 abs = _mm_fmadd_ps(_reals, _reals, _im); //re^2 + im^2
+
+                    //returns zeros for points outside of escape radius
+                    abs = _mm_cmple_ps(abs, rds);
+                    mask = mask & _mm_movemask_ps(abs);
+                    //increment iteration count of points which are still in radius (compare result is -1)
+                    iterations = _mm_sub_epi32(iterations, (__m128i) abs);
+
+                    if (mask == 0) {
+                        break;
+                    }
+                    __m128 _doubled = _mm_add_ps(_reals, _reals); //2 * re
+                    _reals = _mm_add_ps(_mm_fmsub_ps(_reals, _reals, _im), cre); //re^2 - im^2 + cre
+                    _imags = _mm_fmadd_ps(_doubled, _imags, cim); //2*re*im + cim
+                }
+
+                store_lanes(img, y, x-3, iterations, helpers);
+            }
+        }
+    }
+}
+
+/**
+ * @brief same loop as enumerate_fma with 8 points in avx2 registers
+ */
+__attribute__((target("avx2,fma")))
+static void enumerate_avx2_fma(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    __m256 _reals = _mm256_setzero_ps();
+    __m256 _imags;
+
+    __m256 cre = _mm256_set1_ps(crealf(args->c));
+    __m256 cim = _mm256_set1_ps(cimagf(args->c));
+    __m256 rds = _mm256_set1_ps(args->radius_sqr);
+
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+
+        for (size_t x=region->x0; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            _reals[(x - region->x0) % 8] = re;
+
+            //begin computation after every 8th iteration (when _reals is filled with 8 new numbers)
+            if ((x - region->x0) % 8 == 7) {
+                _imags = _mm256_set1_ps(im);
+                __m256i iterations = _mm256_setzero_si256();
+                //0xff - all last 8 bits set
+                int mask = 255;
+
+                for (unsigned i=0; i<args->n; i++) {
+                    __m256 _im = _mm256_mul_ps(_imags, _imags); //im^2
+                    __m256 abs = _mm256_fmadd_ps(_reals, _reals, _im); //re^2 + im^2
+
+                    abs = _mm256_cmp_ps(abs, rds, _CMP_LE_OQ);
+                    mask = mask & _mm256_movemask_ps(abs);
+                    iterations = _mm256_sub_epi32(iterations, (__m256i) abs);
+
+                    if (mask == 0) {
+                        break;
+                    }
+                    __m256 _doubled = _mm256_add_ps(_reals, _reals); //2 * re
+                    _reals = _mm256_add_ps(_mm256_fmsub_ps(_reals, _reals, _im), cre); //re^2 - im^2 + cre
+                    _imags = _mm256_fmadd_ps(_doubled, _imags, cim); //2*re*im + cim
+                }
+
+                store_lanes(img, y, x-7, _mm256_castsi256_si128(iterations), helpers);
+                store_lanes(img, y, x-3, _mm256_extracti128_si256(iterations, 1), helpers);
+            }
+        }
+    }
+}
+
+void julia_fma_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    enumerate_fma(args, img, helpers, region);
+    if ((region->x1 - region->x0) % 4 != 0) {
+        compute_last_points(args, img, region, 4);
+    }
+}
+
+void julia_avx2_fma_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    enumerate_avx2_fma(args, img, helpers, region);
+    if ((region->x1 - region->x0) % 8 != 0) {
+        compute_last_points(args, img, region, 8);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef MY_INTRIN_FMA
+#define MY_INTRIN_FMA
+
+#include "util.h"
+
+/**
+ * @brief scalar iteration function with the same fused multiply-add operations and the same
+ * order as the fma kernels: |z|^2 = fma(re, re, im*im), re' = fma(re, re, -im*im) + cre and
+ * im' = fma(2*re, im, cim). Used for remaining columns of the fma kernels.
+ *
+ * @param re real part of starting point
+ * @param im imaginary part of starting point
+ * @param args julia arguments
+ * @return number of iteration steps, BLACK if the point did not escape in n steps
+ */
+unsigned iterate_fma(float re, float im, Arguments* args);
+
+/**
+ * @brief render the given region like julia_render, with fused multiply-add instructions on 4 pixels.
+ * Results are rounded differently, they are bit-exact with iterate_fma and not with the other kernels.
+ * Must only be called if the processor supports fma (see julia_implementation_supported).
+ *
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_fma_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+/**
+ * @brief render the given region with fused multiply-add instructions on 8 pixels in avx2 registers.
+ * Same operations as julia_fma_render. Must only be called if the processor supports avx2 and fma.
+ *
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_avx2_fma_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+#endif
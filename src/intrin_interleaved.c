@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <complex.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "naive.h"
+#include "intrin_interleaved.h"
+
+//4 pixels of one row iterated together
+typedef struct {
+    __m128 reals;
+    __m128 imags;
+    __m128i iterations; //iterations of every pixel while it is in escape radius
+    unsigned step; //iterations done since the group was filled
+    int mask; //pixels which did not escape yet
+    size_t x; //first pixel of the group
+    size_t y;
+    bool active;
+} lane_group;
+
+//next 4 pixels to be iterated, row-major inside the region
+typedef struct {
+    size_t x;
+    size_t y;
+    size_t columns_end; //first column which is not a multiple of 4 away from region->x0
+    const Region* region;
+} pixel_cursor;
+
+/**
+ * @brief fill a group with the next 4 pixels of the cursor.
+ *
+ * @return false if all pixels are taken, group is inactive then
+ */
+static bool refill(lane_group* group, pixel_cursor* cursor, Arguments* args) {
+    if (cursor->y >= cursor->region->y1 || cursor->columns_end == cursor->region->x0) {
+        group->active = false;
+        return false;
+    }
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t x = cursor->x;
+
+    group->x = x;
+    group->y = cursor->y;
+    //same coordinates as julia_render
+    group->reals = _mm_setr_ps(start_x + x * args->res, start_x + (x + 1) * args->res,
+                               start_x + (x + 2) * args->res, start_x + (x + 3) * args->res);
+    group->imags = _mm_set1_ps(start_y + cursor->y * args->res);
+    group->iterations = _mm_setzero_si128();
+    group->step = 0;
+    group->mask = 15;
+    group->active = true;
+
+    cursor->x += 4;
+    if (cursor->x >= cursor->columns_end) {
+        cursor->x = cursor->region->x0;
+        cursor->y++;
+    }
+    return true;
+}
+
+/**
+ * @brief write the iteration numbers of a finished group, same mapping as julia_render
+ */
+static void retire(lane_group* group, Image* img, xmm_helpers* helpers) {
+    store_lanes(img, group->y, group->x, group->iterations, helpers);
+}
+
+/**
+ * @brief one iteration of a group, same operations as the main iterations loop of julia_render
+ *
+ * @return true if the group is finished: all pixels escaped or n iterations are done
+ */
+static inline bool iterate_group(lane_group* group, __m128 cre, __m128 cim, __m128 rds, __m128 twos, unsigned n) {
+    __m128 _re = _mm_mul_ps(group->reals, group->reals); //re^2
+    __m128 _im = _mm_mul_ps(group->imags, group->imags); //im^2
+    __m128 abs = _mm_cmple_ps(_mm_add_ps(_re, _im), rds);
+
+    group->mask &= _mm_movemask_ps(abs);
+    //compare result is -1 for points in escape radius
+    group->iterations = _mm_sub_epi32(group->iterations, (__m128i) abs);
+    group->step++;
+
+    __m128 imags = _mm_mul_ps(group->reals, group->imags); //re * im
+    imags = _mm_mul_ps(imags, twos); //2 * re * im
+    group->imags = _mm_add_ps(imags, cim); //2*re*im + cim
+    group->reals = _mm_add_ps(_mm_sub_ps(_re, _im), cre); //re^2 - im^2 + cre
+
+    return group->mask == 0 || group->step == n;
+}
+
+/**
+ * @brief compute the remaining columns of every row (less than 4) with the naive approach
+ */
+static void compute_last_points(Arguments* args, Image* img, const Region* region, size_t column) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        float im = start_y  + y * args->res;  // imaginary value
+        for (size_t x=column; x<region->x1; x++) {
+            float re = start_x + x * args->res;  //real value
+            color_pixel(img, y, x, iterate_naive(re, im, args));
+        }
+    }
+}
+
+void julia_interleaved_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+
+    pixel_cursor cursor = {region->x0, region->y0, region->x1 - ((region->x1 - region->x0) % 4), region};
+    lane_group groups[INTERLEAVE_GROUPS];
+    int active = 0;
+    for (int g=0; g<INTERLEAVE_GROUPS; g++) {
+        active += refill(&groups[g], &cursor, args);
+    }
+
+    //iterate all groups one step in every pass, so the multiplications of different groups
+    //do not depend on each other. Finished groups are refilled immediately.
+    while (active > 0) {
+        for (int g=0; g<INTERLEAVE_GROUPS; g++) {
+            lane_group* group = &groups[g];
+            if (group->active && iterate_group(group, cre, cim, rds, twos, args->n)) {
+                retire(group, img, helpers);
+                if (!refill(group, &cursor, args)) {
+                    active--;
+                }
+            }
+        }
+    }
+
+    if (cursor.columns_end != region->x1) {
+        compute_last_points(args, img, region, cursor.columns_end);
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef MY_INTRIN_INTERLEAVED
+#define MY_INTRIN_INTERLEAVED
+
+#include "util.h"
+
+//number of independent groups of 4 pixels iterated in the same loop
+#define INTERLEAVE_GROUPS 3
+
+/**
+ * @brief render the given region with INTERLEAVE_GROUPS independent sse registers of 4 pixels each.
+ * Every group has its own escape mask and iteration counter. A group whose pixels all escaped
+ * (or reached n) writes its results and is refilled with the next 4 pixels at once, so the
+ * out-of-order core always has independent multiplications to overlap.
+ * Computes the same operations as julia_render, results are bit-exact with it.
+ *
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_interleaved_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+#endif
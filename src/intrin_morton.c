@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <complex.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "naive.h"
+#include "intrin_morton.h"
+
+/**
+ * @brief iterate 4 points, same main iterations loop as julia_render
+ *
+ * @return number of iterations every point stayed in escape radius
+ */
+static __m128i iterate_points(__m128 reals, __m128 imags, xmm_helpers* helpers, unsigned n) {
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+    __m128i ones = helpers->ones;
+    __m128i iterations = _mm_setzero_si128();
+    int mask = 15;
+
+    for (unsigned i=0; i<n; i++) {
+        __m128 _re = _mm_mul_ps(reals, reals); //re^2
+        __m128 _im = _mm_mul_ps(imags, imags); //im^2
+        __m128 abs = _mm_cmple_ps(_mm_add_ps(_re, _im), rds);
+
+        mask = mask & _mm_movemask_ps(abs);
+        iterations = _mm_add_epi32(iterations, _mm_and_si128(ones, (__m128i) abs));
+        if (mask == 0) {
+            break;
+        }
+        imags = _mm_mul_ps(reals, imags); //re * im
+        imags = _mm_mul_ps(imags, twos); //2 * re * im
+        imags = _mm_add_ps(imags, cim); //2*re*im + cim
+        reals = _mm_sub_ps(_re, _im); //re^2 - im^2
+        reals = _mm_add_ps(reals, cre); //re^2 - im^2 + cre
+    }
+    return iterations;
+}
+
+/**
+ * @brief compact the even bits of a morton index into the coordinate they encode
+ */
+static size_t morton_coordinate(size_t index) {
+    index &= 0x5555;
+    index = (index | (index >> 1)) & 0x3333;
+    index = (index | (index >> 2)) & 0x0F0F;
+    index = (index | (index >> 4)) & 0x00FF;
+    return index;
+}
+
+/**
+ * @brief compute the 2x2 blocks of one tile in morton order, pixels of incomplete blocks
+ * (odd width or height of the region) with the naive approach
+ */
+static void render_tile(Arguments* args, Image* img, xmm_helpers* helpers, const Region* tile) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    size_t blocks = (MORTON_TILE / 2) * (MORTON_TILE / 2);
+
+    for (size_t b=0; b<blocks; b++) {
+        size_t x = tile->x0 + 2 * morton_coordinate(b);
+        size_t y = tile->y0 + 2 * morton_coordinate(b >> 1);
+        if (x >= tile->x1 || y >= tile->y1) {
+            continue;
+        }
+
+        if (x + 1 < tile->x1 && y + 1 < tile->y1) {
+            //lanes: (x, y), (x+1, y), (x, y+1), (x+1, y+1). same coordinates as julia_render
+            float re0 = start_x + x * args->res;
+            float re1 = start_x + (x + 1) * args->res;
+            float im0 = start_y + y * args->res;
+            float im1 = start_y + (y + 1) * args->res;
+            __m128i iterations = iterate_points(_mm_setr_ps(re0, re1, re0, re1), _mm_setr_ps(im0, im0, im1, im1),
+                                                                                            helpers, args->n);
+            //lanes are a 2x2 block and not 4 pixels of a row, so they are written one by one
+            unsigned results[4];
+            _mm_storeu_si128((__m128i*) results, lane_values(iterations, helpers));
+            for (int i=0; i<4; i++) {
+                color_pixel(img, y + i / 2, x + i % 2, results[i]);
+            }
+            continue;
+        }
+
+        //block is cut by the border of the region
+        for (size_t py=y; py<y+2 && py<tile->y1; py++) {
+            float im = start_y + py * args->res;
+            for (size_t px=x; px<x+2 && px<tile->x1; px++) {
+                float re = start_x + px * args->res;
+                color_pixel(img, py, px, iterate_naive(re, im, args));
+            }
+        }
+    }
+}
+
+void julia_morton_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    for (size_t y=region->y0; y<region->y1; y+=MORTON_TILE) {
+        for (size_t x=region->x0; x<region->x1; x+=MORTON_TILE) {
+            Region tile = {x, y, x + MORTON_TILE, y + MORTON_TILE};
+            if (tile.x1 > region->x1) {
+                tile.x1 = region->x1;
+            }
+            if (tile.y1 > region->y1) {
+                tile.y1 = region->y1;
+            }
+            render_tile(args, img, helpers, &tile);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef MY_INTRIN_MORTON
+#define MY_INTRIN_MORTON
+
+#include "util.h"
+
+//edge length in pixels of the tiles whose 2x2 blocks are visited in morton order
+#define MORTON_TILE 16
+
+/**
+ * @brief render the given region with the 4 lanes of a register filled from a 2x2 block of pixels
+ * instead of 4 neighbouring pixels of a row. Pixels of a compact block more often escape in the
+ * same iteration, so fewer lanes idle while the slowest lane finishes.
+ * The region is split into tiles of MORTON_TILE x MORTON_TILE pixels, row by row, and the
+ * blocks of a tile are visited along a morton (z-order) curve.
+ * Computes the same operations as julia_render, results are bit-exact with it.
+ *
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_morton_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+#endif
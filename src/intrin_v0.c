@@ -7,42 +7,41 @@
 #include "bmp.h"
 #include "util.h"
 #include "naive.h"
+#include "intrin_v0.h"
 
 /**
  * @brief iterates through all the starting points in the complex plane,
- * computes iteration number and passes the iteration numbers into color_pixel.
+ * computes iteration number and writes the iteration numbers with store_lanes.
  * 
  * @param args julia arguments
  * @param img image data
+ * @param helpers broadcast constants (c, escape radius, 2)
+ * @param region pixels to compute
  */
-static void enumerate(Arguments* args, Image* img) {
+static void enumerate(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
     //4 complex numbers are kept in these two registers.
     __m128 _reals;
     __m128 _imags;
 
-    //load and broadcast real and imaginary parts of c into seperate registers.
-    __m128 cre = _mm_set1_ps(crealf(args->c));
-    __m128 cim = _mm_set1_ps(cimagf(args->c));
-
-    //broadcast escape radius to a register.
-    __m128 rds = _mm_set1_ps(args->radius_sqr);
-
-    //broadcast 2 constants into a register. needed for complex multiplication.
-    __m128 twos = _mm_set1_ps(2.0f);
+    //constants are broadcast once per plan, just load them into registers.
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
 
     float start_x = crealf(args->start);
     float start_y = cimagf(args->start); 
 
-    //iterate all the points in the complex plane
-    for (size_t y=0; y<img->height; y++) {
+    //iterate all the points of the region in the complex plane
+    for (size_t y=region->y0; y<region->y1; y++) {
         float im = start_y  + y * args->res;  // imaginary value
 
-        for (size_t x=0; x<img->width; x++) {
+        for (size_t x=region->x0; x<region->x1; x++) {
             float re = start_x + x * args->res;  //real value
-            _reals[x % 4] = re;
+            _reals[(x - region->x0) % 4] = re;
 
             //begin computation after every 4th iteration (when _reals is filled with 4 new numbers)
-            if (x % 4 == 3) {
+            if ((x - region->x0) % 4 == 3) {
                 _imags = _mm_set1_ps(im);
                 __m128i iterations = _mm_set1_epi32(0);
                 //0xf - all last 4 bits set
@@ -79,23 +78,9 @@ static void enumerate(Arguments* args, Image* img) {
                     _reals = _mm_add_ps(_reals, cre); //re^2 + im^2 + cre
                 }
 
-                unsigned results[4];
-                _mm_storeu_si128((__m128i*) results, iterations);
-
-                for (int i=0; i<4; i++) {
-                    //point is still in. belongs to julia set.
-                    if (results[i] == args->n) {
-                        color_pixel(img, y, x-3+i, BLACK);
-                    } 
-                    //point was already outside. 
-                    else if (results[i] == 0) {
-                        color_pixel(img, y, x-3+i, 1);
-                    } 
-                    //point got outside in step number results[i]. choose color results[i]
-                    else {
-                        color_pixel(img, y, x-3+i, results[i]);
-                    }
-                }
+                //points still in belong to julia set (BLACK), points which were already outside get 1,
+                //every other point got outside in step number iterations. choose color iterations
+                store_lanes(img, y, x-3, iterations, helpers);
             }
         }
     }    
@@ -109,20 +94,21 @@ static void enumerate(Arguments* args, Image* img) {
  * 
  * @param args julia arguments
  * @param img image data
+ * @param region pixels to compute
  */
-static void compute_last_points(Arguments* args, Image* img) {
+static void compute_last_points(Arguments* args, Image* img, const Region* region) {
     float start_x = crealf(args->start);
     float start_y = cimagf(args->start); 
 
     //this column and other columns right side of this column are not computed with previous
     //enumerate() call. Compute them with naive approach and finish the image
-    size_t column = img->width - (img->width % 4);
+    size_t column = region->x1 - ((region->x1 - region->x0) % 4);
 
     //iterate all the points in the complex plane
-    for (size_t y=0; y<img->height; y++) {
+    for (size_t y=region->y0; y<region->y1; y++) {
         float im = start_y  + y * args->res;  // imaginary value
 
-        for (size_t x=column; x<img->width; x++) {
+        for (size_t x=column; x<region->x1; x++) {
             float re = start_x + x * args->res;  //real value
             
             unsigned iterations = iterate_naive(re, im, args);
@@ -131,16 +117,62 @@ static void compute_last_points(Arguments* args, Image* img) {
     }
 }
 
-void julia(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img) {
-    Arguments* args = get_args(c, start, res, n);
-    Image* my_img = get_img(width, height, img, n);
-
-    enumerate(args, my_img);
-    if (width % 4 != 0) {
-        compute_last_points(args, my_img);
+void julia_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region) {
+    enumerate(args, img, helpers, region);
+    if ((region->x1 - region->x0) % 4 != 0) {
+        compute_last_points(args, img, region);
     }
+}
 
-    free(args);
-    free(my_img);
+void julia_points(Arguments* args, xmm_helpers* helpers, const float* reals, const float* imags, size_t count,
+                                                                                            unsigned* values) {
+    __m128 cre = helpers->cre;
+    __m128 cim = helpers->cim;
+    __m128 rds = helpers->radius_sqr;
+    __m128 twos = helpers->twos;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 _reals = _mm_loadu_ps(reals + i);
+        __m128 _imags = _mm_loadu_ps(imags + i);
+        __m128i iterations = _mm_setzero_si128();
+        int mask = 15;
+
+        //same operations as the main iterations loop of enumerate()
+        for (unsigned k=0; k<args->n; k++) {
+            __m128 _re = _mm_mul_ps(_reals, _reals);
+            __m128 _im = _mm_mul_ps(_imags, _imags);
+            __m128 abs = _mm_cmple_ps(_mm_add_ps(_re, _im), rds);
+
+            mask = mask & _mm_movemask_ps(abs);
+            iterations = _mm_add_epi32(iterations, _mm_and_si128(helpers->ones, (__m128i) abs));
+            if (mask == 0) {
+                break;
+            }
+            _imags = _mm_mul_ps(_reals, _imags);
+            _imags = _mm_mul_ps(_imags, twos);
+            _imags = _mm_add_ps(_imags, cim);
+
+            _reals = _mm_sub_ps(_re, _im);
+            _reals = _mm_add_ps(_reals, cre);
+        }
+        _mm_storeu_si128((__m128i*) (values + i), lane_values(iterations, helpers));
+    }
+    //less than 4 points left
+    for (; i < count; i++) {
+        values[i] = iterate_naive(reals[i], imags[i], args);
+    }
 }
 
+void julia(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img) {
+    Arguments args;
+    Image my_img;
+    xmm_helpers helpers;
+    init_args(&args, c, start, res, n);
+    init_img(&my_img, width, height, img, n);
+    init_xmm_helpers(&helpers, &args);
+
+    Region region = full_region(&my_img);
+
+    julia_render(&args, &my_img, &helpers, &region);
+}
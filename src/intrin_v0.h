@@ -1,3 +1,8 @@
+#ifndef MY_INTRIN_V0
+#define MY_INTRIN_V0
+
+#include "util.h"
+
 /**
  * @brief optimized julia algorithm parallelized with SIMD
  * 
@@ -10,3 +15,32 @@
  * @param img image buffer
  */
 void julia(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+
+/**
+ * @brief render the given region of the image described by args and img with the optimized implementation.
+ * Does not allocate any memory, constants are taken from the already broadcast helpers.
+ * 
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param region pixels to compute
+ */
+void julia_render(Arguments* args, Image* img, xmm_helpers* helpers, const Region* region);
+
+/**
+ * @brief iterate a list of arbitrary points with the loop of julia_render, 4 points per sse register.
+ * Points do not have to lie on the pixel grid or in the same row, so callers can pack samples of
+ * different pixels into full registers. Only the quadratic family is supported.
+ * Results are bit-exact with julia_render for the same coordinates.
+ * 
+ * @param args julia arguments
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param reals real parts of the points
+ * @param imags imaginary parts of the points
+ * @param count number of points
+ * @param values iteration number of every point, BLACK for convergent points (same values as color_pixel gets)
+ */
+void julia_points(Arguments* args, xmm_helpers* helpers, const float* reals, const float* imags, size_t count,
+                                                                                            unsigned* values);
+
+#endif
@@ -12,89 +12,26 @@
 #include "bmp.h"
 #include "util.h"
 #include "naive.h"
-
-//4 complex numbers are managed with this data structure together
-typedef struct {
-    size_t x_coords[4];
-    size_t y_coords[4];
-    float reals[4];
-    float imags[4];
-    unsigned count[4];
-    unsigned bits[4];
-    int population; //number of non-empty entries in the data structure. always [0,4]
-    void* adress; //use free() on this to free the struct
-} four_complexes;
-
-
-//xmm version of four_complexes
-typedef struct {
-    __m128 reals; //Real parts
-    __m128 imags; //imaginary parts
-    __m128 dist;  //distance from origin
-    __m128i count; //iteration count. all 4 entries [0,N]
-} xmm_four_complexes;
-
-
-typedef struct {
-    __m128 cre; //filled with real parts of c
-    __m128 cim; //imaginary part
-    __m128 twos; //filled with 2 constants
-    __m128i ones; //filled with 1 constants
-    __m128i ns;   //filled with n (max iter) contants 
-    __m128 radius_sqr; //filled with r^2 with r = max{|c|, 2}
-} xmm_helpers;
-
+#include "intrin_v1.h"
 
 /**
- * @brief setup a four_complexes data structure instance with 16-byte aligned memory and return
+ * @brief reset a four_complexes data structure so that all entries are marked as empty
  */
-four_complexes* get_aligned_four_complexes() {
-    void* memory = malloc(sizeof(four_complexes) + 15);
-    if (memory == NULL) {
-        fprintf(stderr, "Could not allocate memory for four_complexes struct.\n");
-        exit(1);
-    }
-    four_complexes* ret = (four_complexes*) (((uintptr_t)memory+15) & ~ (uintptr_t)0x0F);
-    ret->adress = memory;
-    ret->population = 0;
+void init_four_complexes(four_complexes* nums) {
+    nums->population = 0;
 
     //initialize reals array with FLT_MAX'es. We do this to mark the entries as empty.
     for (int i=0; i<4; i++) {
-        ret->reals[i] = FLT_MAX;
+        nums->reals[i] = FLT_MAX;
     }
-    return ret;
 }
 
 /**
- * @brief Get an xmm four complexes object
+ * @brief reset an xmm four complexes object
  */
-xmm_four_complexes* get_xmm_four_complexes() {
-    xmm_four_complexes* ret = malloc(sizeof(xmm_four_complexes));
-    if (ret == NULL) {
-        fprintf(stderr, "Could not allocate memory for xmm_four_complexes struct.\n");
-        exit(1);       
-    }
-    ret->count = _mm_set1_epi32(0);
+void init_xmm_four_complexes(xmm_four_complexes* xmms) {
+    xmms->count = _mm_set1_epi32(0);
     //no need to initialize rest of registers, they will be loaded later
-    return ret;
-}
-
-/**
- * @brief Get helper registers
- */
-xmm_helpers* get_xmm_helpers(Arguments* args) {
-    xmm_helpers* ret = malloc(sizeof(xmm_helpers));
-    if (ret == NULL) {
-        fprintf(stderr, "Could not allocate memory for xmm_helpers struct.\n");
-        exit(1);       
-    }
-    ret->cre = _mm_set1_ps(crealf(args->c));
-    ret->cim = _mm_set1_ps(cimagf(args->c));
-    ret->twos = _mm_set1_ps(2.0f);
-    ret->ones = _mm_set1_epi32(1);
-    ret->ns = _mm_set1_epi32(args->n);
-    ret->radius_sqr = _mm_set1_ps(args->radius_sqr);
-    return ret;
 }
 
 /**
@@ -201,18 +138,19 @@ void insert(four_complexes* nums, float a, float b, size_t y, size_t x) {
  * @param nums arrays holding 4 complex numbers' data
  * @param xmms sse registers holding 4 complex numbers' data
  * @param helpers helper sse registers
+ * @param region pixels to compute
  */
 static void enumerate(Arguments* args, Image* img, four_complexes* nums, 
-                                xmm_four_complexes* xmms, xmm_helpers* helpers) {
+                                xmm_four_complexes* xmms, xmm_helpers* helpers, const Region* region) {
 
     float start_x = crealf(args->start);
     float start_y = cimagf(args->start); 
 
-    //iterate all the points in the complex plane
-    for (size_t y=0; y<img->height; y++) {
+    //iterate all the points of the region in the complex plane
+    for (size_t y=region->y0; y<region->y1; y++) {
         float im = start_y  + y * args->res;  // imaginary value
 
-        for (size_t x=0; x<img->width; x++) { 
+        for (size_t x=region->x0; x<region->x1; x++) { 
             float re = start_x + x * args->res;  //real value
             insert(nums, re, im, y, x);
 
@@ -263,7 +201,7 @@ static void enumerate(Arguments* args, Image* img, four_complexes* nums,
                 }
             }
             //save reals
-            static float tmp[4];
+            float tmp[4];
             memcpy(tmp, nums->reals, sizeof(float) * 4);
 
             //update reals and imags for next iterations
@@ -280,21 +218,28 @@ static void enumerate(Arguments* args, Image* img, four_complexes* nums,
     }
 }
 
-void julia_V1(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img) {
-    Arguments* args = get_args(c, start, res, n);
-    Image* my_img = get_img(width, height, img, n);
-    four_complexes* nums = get_aligned_four_complexes();
-    xmm_four_complexes* xmms = get_xmm_four_complexes();
-    xmm_helpers* helpers = get_xmm_helpers(args);
+void julia_V1_render(Arguments* args, Image* img, xmm_helpers* helpers, four_complexes* nums, xmm_four_complexes* xmms,
+                                                                                            const Region* region) {
+    init_four_complexes(nums);
+    init_xmm_four_complexes(xmms);
 
-    enumerate(args, my_img, nums, xmms, helpers);
+    enumerate(args, img, nums, xmms, helpers, region);
 
     //finish the remaining points in four_complexes
-    compute_last_points(args, nums, my_img);
-
-    free(nums->adress);
-    free(xmms);
-    free(helpers);
-    free(args);
-    free(my_img);
-}
\ No newline at end of file
+    compute_last_points(args, nums, img);
+}
+
+void julia_V1(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img) {
+    Arguments args;
+    Image my_img;
+    xmm_helpers helpers;
+    four_complexes nums;
+    xmm_four_complexes xmms;
+    init_args(&args, c, start, res, n);
+    init_img(&my_img, width, height, img, n);
+    init_xmm_helpers(&helpers, &args);
+
+    Region region = full_region(&my_img);
+
+    julia_V1_render(&args, &my_img, &helpers, &nums, &xmms, &region);
+}
@@ -1,3 +1,29 @@
+#ifndef MY_INTRIN_V1
+#define MY_INTRIN_V1
+
+#include <stddef.h>
+#include "util.h"
+
+//4 complex numbers are managed with this data structure together.
+//arrays which are loaded into sse registers are kept 16-byte aligned.
+typedef struct {
+    size_t x_coords[4];
+    size_t y_coords[4];
+    _Alignas(16) float reals[4];
+    _Alignas(16) float imags[4];
+    _Alignas(16) unsigned count[4];
+    _Alignas(16) unsigned bits[4];
+    int population; //number of non-empty entries in the data structure. always [0,4]
+} four_complexes;
+
+//xmm version of four_complexes
+typedef struct {
+    __m128 reals; //Real parts
+    __m128 imags; //imaginary parts
+    __m128 dist;  //distance from origin
+    __m128i count; //iteration count. all 4 entries [0,N]
+} xmm_four_complexes;
+
 /**
  * @brief less optimized julia algorithm parallelized with SIMD
  * 
@@ -10,3 +36,20 @@
  * @param img image buffer
  */
 void julia_V1(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+
+
+/**
+ * @brief render the given region of the image described by args and img with the less optimized implementation.
+ * Does not allocate any memory, given scratch structs are reset and reused.
+ * 
+ * @param args julia arguments
+ * @param img image data
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param nums scratch space holding 4 complex numbers' data
+ * @param xmms scratch sse registers holding 4 complex numbers' data
+ * @param region pixels to compute
+ */
+void julia_V1_render(Arguments* args, Image* img, xmm_helpers* helpers, four_complexes* nums, xmm_four_complexes* xmms,
+                                                                                            const Region* region);
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef MY_JULIA
+#define MY_JULIA
+
+//Public interface of libjulia.
+//None of the functions declared here use global or static mutable state, so they can be
+//called from several threads at the same time. A single plan must not be executed
+//by two threads at once, create one plan per thread instead.
+
+#include <complex.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//Implementation versions
+#define INTRIN_V0 0 //optimized SIMD version
+#define INTRIN_V1 1 //less optimized SIMD version
+#define NAIVE 2
+#define INTRIN_FMA 3 //optimized version with fused multiply-add, needs fma
+#define INTRIN_AVX2_FMA 4 //optimized version with fused multiply-add on 8 pixels, needs avx2 and fma
+#define INTRIN_INTERLEAVED 5 //optimized version iterating several independent groups of 4 pixels at once
+#define INTRIN_DEFERRED 6 //optimized version checking the escape radius once every few iterations
+#define INTRIN_MORTON 7 //optimized version iterating 2x2 blocks of pixels in morton order
+
+//fma versions round differently, their iteration numbers can differ from the other versions
+//for a few pixels near the boundary of the julia set
+
+//iteration families, every family has its own kernel
+#define FAMILY_QUADRATIC 0 //z^2 + c
+#define FAMILY_MULTIBROT 1 //z^d + c with integer degree d
+#define FAMILY_BURNING_SHIP 2 //(|re z| + i |im z|)^2 + c
+#define MULTIBROT_MIN_DEGREE 3
+#define MULTIBROT_MAX_DEGREE 8
+
+//largest n for which iteration numbers fit into 16-bit fields (see julia_plan_execute_field16)
+#define FIELD16_MAX_N 65535
+
+//special value to use instead of iteration number for convergent pixels
+#define BLACK 0
+
+//everything needed to describe one render. filled by the caller and passed to julia_plan_create.
+typedef struct {
+    int implementation; //one of the implementation versions above
+    float complex c;
+    float complex start;
+    size_t width;
+    size_t height;
+    float res;
+    unsigned n;
+    //optional, zero-initialised fields select z^2 + c with the default escape radius
+    int family; //FAMILY_QUADRATIC, FAMILY_MULTIBROT or FAMILY_BURNING_SHIP
+    unsigned degree; //exponent d of FAMILY_MULTIBROT
+    float bailout; //escape radius, at least max{|c|, 2}. 0: max{|c|, 2}
+} JuliaParams;
+
+//precomputed state of a render, defined in plan.h
+typedef struct JuliaPlan JuliaPlan;
+
+/**
+ * @brief check if an implementation exists and the processor supports its instructions
+ * 
+ * @param implementation version of julia algorithm
+ * @return 1 if plans can be created for implementation, 0 otherwise
+ */
+int julia_implementation_supported(int implementation);
+
+/**
+ * @brief create a plan for the render described by params.
+ * Escape radius, color constant and sse constants are computed here once.
+ * 
+ * @param params render parameters
+ * @return plan, or NULL if memory could not be allocated, implementation is unknown, not supported or
+ * does not support the family, or bailout is too small
+ */
+JuliaPlan* julia_plan_create(const JuliaParams* params);
+
+/**
+ * @brief run the planned render and write the resulting rgb image into buffer.
+ * Does not allocate any memory.
+ * 
+ * @param plan plan created by julia_plan_create
+ * @param buffer image buffer of size width * height * 3
+ */
+void julia_plan_execute(JuliaPlan* plan, unsigned char* buffer);
+
+/**
+ * @brief run the planned render, but write the iteration number of each pixel into field
+ * instead of coloring an image. BLACK is written for convergent pixels.
+ * Does not allocate any memory.
+ * 
+ * @param plan plan created by julia_plan_create
+ * @param field buffer of width * height unsigned values, row-major
+ */
+void julia_plan_execute_field(JuliaPlan* plan, unsigned* field);
+
+/**
+ * @brief same as julia_plan_execute_field with 16-bit iteration numbers, the field needs half
+ * the memory and bandwidth. Only possible if n is at most FIELD16_MAX_N.
+ * 
+ * @param plan plan created by julia_plan_create
+ * @param field buffer of width * height uint16_t values, row-major
+ * @return 0 on success, -1 if n of the plan is larger than FIELD16_MAX_N
+ */
+int julia_plan_execute_field16(JuliaPlan* plan, uint16_t* field);
+
+/**
+ * @brief free all memory held by plan
+ */
+void julia_plan_destroy(JuliaPlan* plan);
+
+//speed of a machine and implementation. The SIMD kernels iterate groups of 4 neighbouring pixels
+//until the slowest of them is done, so their time follows lane iterations: 4 times the largest
+//iteration number of every group. A render of p pixels and l lane iterations takes
+//p * ns_per_pixel * 10^-9 + l / (giter_per_s * 10^9) seconds
+typedef struct {
+    double giter_per_s; //10^9 lane iterations per second
+    double ns_per_pixel; //cost of a pixel apart from its iterations (setup, coloring, memory)
+    double error; //relative standard deviation of times around this model
+} JuliaRate;
+
+//predicted cost of a render, filled by julia_estimate
+typedef struct {
+    double iterations; //predicted total number of iterations of all pixels
+    double iterations_low; //95% interval of the total number of iterations
+    double iterations_high;
+    double lane_iterations; //predicted lane iterations, see JuliaRate
+    double seconds; //predicted wall time with the calibrated rate
+    double seconds_low; //95% interval of the wall time
+    double seconds_high;
+    size_t samples; //groups of 4 pixels iterated for the prediction
+    unsigned cap; //iteration cap of the samples
+    double sample_seconds; //time spent on the prediction
+} JuliaEstimate;
+
+/**
+ * @brief predict the cost of the render described by params without running it, e.g. for admission
+ * control of a job queue. Groups of 4 neighbouring pixels on a sparse grid are iterated with a tight
+ * iteration cap, the total number of iterations and lane iterations is extrapolated from them and
+ * turned into time with rate. Takes a few milliseconds.
+ * Pixels still inside the escape radius at the cap count as n iterations, apart from the share which
+ * is expected to escape later (as many as escaped in the last half below the cap). The interval covers
+ * the sampling error and the range between none and twice that share escaping right after the cap,
+ * the time interval also the error of rate.
+ * 
+ * @param params render parameters, the implementation is only used through rate
+ * @param rate calibrated speed of the machine and implementation
+ * @param estimate prediction is written here
+ * @return 0 on success, -1 if parameters are invalid or memory could not be allocated
+ */
+int julia_estimate(const JuliaParams* params, const JuliaRate* rate, JuliaEstimate* estimate);
+
+/**
+ * @brief measure the rate of an implementation on this machine for julia_estimate: 10 views are
+ * rendered at 400 x 400 pixels, once with 16 and once with 500 iterations. A least squares line
+ * through (lane iterations, median time) gives the time per lane iteration (slope) and per pixel
+ * (intercept), the residuals its error. Takes about 1.5 seconds, so callers should keep the rate
+ * (julia saves it in its machine profile).
+ *
+ * @param implementation version of julia algorithm
+ * @param rate measured speed of one thread is written here
+ * @return 0 on success, -1 if the implementation is not supported or memory could not be allocated
+ */
+int julia_calibrate(int implementation, JuliaRate* rate);
+
+//One-shot renders, see intrin_v0.h, intrin_v1.h and naive.h
+void julia(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+void julia_V1(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+void julia_V2(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+
+/**
+ * @brief create a BMP image with given arguments.
+ * 
+ * @param image RGB buffer
+ * @param height height of image
+ * @param width  width of image
+ * @param imageFileName name of image file ending with .bmp
+ * @return 0 on success, -1 if the file could not be written
+ */
+int generateBitmapImage (unsigned char* image, int height, int width, char* imageFileName);
+
+#endif
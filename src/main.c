@@ -9,7 +9,9 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <float.h>
+#include <math.h>
 #include <errno.h>
+#include <time.h>
 
 #include "bmp.h"
 #include "naive.h"
@@ -18,6 +20,23 @@
 #include "performanz.h"
 #include "util.h"
 #include "correctness.h"
+#include "regress.h"
+#include "plan.h"
+#include "tilestats.h"
+#include "intrin_interleaved.h"
+#include "intrin_deferred.h"
+#include "render.h"
+#include "trace.h"
+#include "histcolor.h"
+#include "distance.h"
+#include "supersample.h"
+#include "atlas.h"
+#include "autoiter.h"
+#include "estimate.h"
+#include "frame.h"
+#include "autotune.h"
+#include "placement.h"
+#include "miim.h"
 
 // Default values for parameters
 #define DEFAULT_WIDTH 2000
@@ -26,6 +45,8 @@
 #define DEFAULT_N 500
 #define DEFAULT_PATH "image.bmp"
 #define DEFAULT_REPETITIONS 10 //for performance test
+#define DEFAULT_WARMUP 2 //for benchmark harness
+#define MAX_THREADS 1024
 const float complex DEFAULT_START = (-1.5 + -1.5 * I);  
 const float complex DEFAULT_C = (-0.53 + 0.5 * I);
 
@@ -33,13 +54,21 @@ const float complex DEFAULT_C = (-0.53 + 0.5 * I);
 void print_help(char* executable_name) {
 	printf("Usage: %s [-V version] [-B repetitions] [-s <real>,<imag>]\n"
 	       "                [-d <width>,<height>] [-n iterations] [-r step_size]\n"
-		   "                [-c <real>,<imag>] [-o filename] [-x]\n\n", executable_name);
+		   "                [-c <real>,<imag>] [-o filename] [-t threads] [-f family] [-x]\n\n", executable_name);
 
 	printf("    -V version:          Choose the implementation. Use version=0 for optimized\n"
            "                         parallel implementation, version=1 for less optimized\n"
-		   "                         parallel implementation and version=2 for naive\n"
-		   "                         implementation.\n"
-		   "                         Default: 0\n\n");
+		   "                         parallel implementation, version=2 for naive\n"
+		   "                         implementation, version=3 for optimized implementation\n"
+		   "                         with fused multiply-add (needs fma), version=4 for\n"
+		   "                         fused multiply-add on 8 pixels (needs avx2 and fma),\n"
+		   "                         version=5 for optimized implementation iterating\n"
+		   "                         %d independent groups of 4 pixels at once,\n"
+		   "                         version=6 for optimized implementation checking the\n"
+		   "                         escape radius once every %d iterations and version=7\n"
+		   "                         for optimized implementation computing 2x2 blocks of\n"
+		   "                         pixels in morton order.\n"
+		   "                         Default: 0\n\n", INTERLEAVE_GROUPS, BAILOUT_BLOCK);
 
 	printf("    -B[repetitions]:     If -B set, measure average running time of chosen\n"
            "                         implementation with optional argument repetitions\n"
@@ -61,7 +90,10 @@ void print_help(char* executable_name) {
 
 	printf("    -n iterations:       Choose the maximum number of iterations of the function\n"
            "                         call (f(z) = z^2 + c) per pixel.\n"
-		   "                         Default: %d\n\n", DEFAULT_N);
+		   "                         Use '-n auto' to choose n from a sparse pre-pass with a\n"
+		   "                         cap of %d: the smallest n for which at most %.1f%% of\n"
+		   "                         the samples escape after more than n steps.\n"
+		   "                         Default: %d\n\n", AUTO_N_CAP, AUTO_N_AMBIGUOUS * 100, DEFAULT_N);
 
 	printf("    -r step_size:        Choose the gap between two neighboring pixels in the\n"
 		   "                         complex plane. This parameter determines the resolution\n"
@@ -82,14 +114,171 @@ void print_help(char* executable_name) {
 		   "                         Give filename with .bmp extension.\n"
 		   "                         Default: %s\n\n", DEFAULT_PATH);
 
+	printf("    -t threads:          Number of threads rendering the image. Image is split\n"
+		   "                         into bands of %d rows, every thread takes the next\n"
+		   "                         free band. Correctness tests use all processors\n"
+		   "                         unless -t is given.\n"
+		   "                         Default: 1\n\n", DEFAULT_BAND_HEIGHT);
+
+	printf("    -f family:           Choose the iteration function: quadratic for\n"
+		   "                         z^2 + c, multibrot<d> for z^d + c with d from %d to %d\n"
+		   "                         (e.g. multibrot3) or burning-ship for\n"
+		   "                         (|re z| + i |im z|)^2 + c. Every family has its own\n"
+		   "                         kernel, families other than quadratic are rendered\n"
+		   "                         by the optimized implementation (-V 0) only.\n"
+		   "                         Default: quadratic\n\n", MULTIBROT_MIN_DEGREE, MULTIBROT_MAX_DEGREE);
+
+	printf("    --bailout=radius:    Escape radius of the iteration. Must be at least\n"
+		   "                         max{|c|, 2}, larger radii give smoother gradients.\n"
+		   "                         Default: max{|c|, 2}\n\n");
+
+	printf("    --color=mode:        Coloring of iteration numbers. linear maps 0..n to the\n"
+		   "                         color range, histogram spreads the color range over\n"
+		   "                         the iteration numbers which occur in the image\n"
+		   "                         (histogram equalisation, computed with -t threads).\n"
+		   "                         Default: linear\n\n");
+
+	printf("    --distance[=fill]:   Render the estimated distance of every pixel to the\n"
+		   "                         julia set instead of iteration numbers. The\n"
+		   "                         derivative of z is iterated along in sse registers,\n"
+		   "                         pixels closer than %.1f pixels are drawn black.\n"
+		   "                         Escape radius is %.0f unless --bailout is given.\n"
+		   "                         With fill, pixels inside the estimated distance of an\n"
+		   "                         exterior pixel are filled without iterating them.\n"
+		   "                         Quadratic family only.\n\n", DE_BOUNDARY, DE_RADIUS);
+
+	printf("    --miim[=hits]:       Plot only the boundary of the julia set with the\n"
+		   "                         modified inverse iteration method: preimages\n"
+		   "                         +-sqrt(z - c) of the repelling fixed point are followed\n"
+		   "                         up to n steps deep, until their pixel was hit hits\n"
+		   "                         times. Cost grows with the number of boundary pixels.\n"
+		   "                         Quadratic family only.\n"
+		   "                         Default: %d hits\n\n", MIIM_DEFAULT_HITS);
+
+	printf("    --aa[=threshold]:    Adaptive anti-aliasing. After the 1x render, pixels\n"
+		   "                         whose iteration number differs from a neighbour by\n"
+		   "                         more than threshold get %d jittered sub-samples,\n"
+		   "                         packed into full sse registers across pixels.\n"
+		   "                         Prints the number of samples per pixel.\n"
+		   "                         Default: %d iterations\n\n", SS_SAMPLES, SS_DEFAULT_THRESHOLD);
+
+	printf("    --atlas=cols,rows[,files]: Render a mosaic of cols x rows julia thumbnails,\n"
+		   "                         c runs over the grid of cell centres of\n"
+		   "                         [%.2f, %.2f] x [%.2f, %.2f] i. -d gives the size of\n"
+		   "                         one thumbnail, -s and -r its view (default: -r fits\n"
+		   "                         3.0 into the thumbnail). Every sse lane carries its own\n"
+		   "                         c and is refilled from one queue of (c, pixel) jobs.\n"
+		   "                         With files, every thumbnail is written into its own\n"
+		   "                         file <filename>_<col>_<row>.bmp instead of a mosaic.\n"
+		   "                         Quadratic family only.\n\n", crealf(ATLAS_C_MIN), crealf(ATLAS_C_MAX),
+		                                                     cimagf(ATLAS_C_MIN), cimagf(ATLAS_C_MAX));
+
+	printf("    --estimate[=giter,ns[,error]]: Predict the cost of the render instead of\n"
+		   "                         running it. Groups of 4 pixels every 16 pixels or\n"
+		   "                         fewer are iterated with a cap of %d, the total\n"
+		   "                         number of iterations is extrapolated and turned into\n"
+		   "                         time with the rate of the machine, with a 95%%\n"
+		   "                         interval. giter is the rate of one thread in 10^9\n"
+		   "                         lane iterations per second, ns the cost of a pixel\n"
+		   "                         and error the relative error of the rate (default\n"
+		   "                         %.2f). If not given, the rate of -V is taken from\n"
+		   "                         the profile (see --profile) or measured once and\n"
+		   "                         saved in it. Threads scale ideally.\n\n", ESTIMATE_CAP, CALIBRATION_MIN_ERROR);
+
+	printf("    --frame[=margin]:    Choose -s and -r so that the filled julia set of c\n"
+		   "                         fills the image up to an empty margin on every side,\n"
+		   "                         as share of width and height (0 to 0.45). Two grids\n"
+		   "                         of %d x %d points are iterated with a cap of %d\n"
+		   "                         to find the bounding box of the set, in a few ms.\n"
+		   "                         Overrides -s and -r.\n"
+		   "                         Default margin: %.2f\n\n", FRAME_GRID, FRAME_GRID, FRAME_CAP,
+		                                                   FRAME_DEFAULT_MARGIN);
+
 	printf("    -x:                  Run correctness test with user-given arguments.\n"
-		   "                         All of the three implementations are tested against\n"
-		   "                         a reference implementation.\n"
+		   "                         Every supported implementation is tested against\n"
+		   "                         a reference implementation, as well as distance\n"
+		   "                         estimation, point list, atlas and placed renders.\n"
 		   "                         Use -x to only run correctness test.\n"
 		   "                         Use -xi to run correctness test and rerun to create\n"
 		   "                         an image afterwards.\n"
 	       "                         Use -x0 to run detailed correctness test with\n"
-		   "                         fixed arguments.\n\n");
+		   "                         fixed arguments.\n"
+		   "                         Use -xt to run multithreaded stress test.\n"
+		   "                         Iteration numbers are compared in tiles of %dx%d\n"
+		   "                         pixels by several threads. Number of mismatching\n"
+		   "                         pixels, largest iteration difference and first\n"
+		   "                         mismatch locations are printed for every\n"
+		   "                         implementation.\n\n", DIFF_TILE, DIFF_TILE);
+	printf("    --fuzz[=seconds]:    Run randomised correctness test with random c, start,\n"
+		   "                         step size, iterations and image size for the given\n"
+		   "                         time. Arguments of failing cases are printed.\n"
+		   "                         Default: %d seconds\n\n", DEFAULT_FUZZ_SECONDS);
+	printf("    --tolerance=percent: FMA implementations (-V 3 and 4) round differently.\n"
+		   "                         By default correctness tests compare them with a\n"
+		   "                         reference using fma, results must be bit-exact.\n"
+		   "                         With --tolerance they are compared with the reference\n"
+		   "                         implementation and may differ in the given percent of\n"
+		   "                         all pixels.\n\n");
+	printf("    --bench[=csv|json]:  Run non-interactive benchmark of all implementations\n"
+		   "                         with all c values and image sizes and print results\n"
+		   "                         as csv (default) or json. Reports median, p95 and\n"
+		   "                         standard deviation of running time and total\n"
+		   "                         iterations per second (giter_per_s). Use -B to set\n"
+		   "                         repetitions and -n to set iterations.\n\n");
+	printf("    --warmup=count:      Number of untimed runs before measuring.\n"
+		   "                         Default: %d\n\n", DEFAULT_WARMUP);
+	printf("    --bench-sizes=count: Only use the first count image sizes (500x500,\n"
+		   "                         1000x1000, ...) in benchmark. Default: 10\n\n");
+	printf("    --bench-regress=file:\n"
+		   "                         Run fixed set of regression scenarios and compare\n"
+		   "                         throughput with baseline json file. Fails if a\n"
+		   "                         scenario is more than --threshold percent slower.\n\n");
+	printf("    --bench-baseline=file:\n"
+		   "                         Run regression scenarios and write a new baseline.\n\n");
+	printf("    --threshold=percent: Allowed throughput drop for --bench-regress.\n"
+		   "                         Default: %.1f\n\n", DEFAULT_THRESHOLD);
+	printf("    --autotune[=file]:   Find the fastest implementation (without fma, so the\n"
+		   "                         profile does not change pixels), number of threads\n"
+		   "                         and band height of this machine for small, medium\n"
+		   "                         and large images with low, medium and high n on\n"
+		   "                         four c values and write them to a profile (default:\n"
+		   "                         ~/%s). Threads up to -t or all processors.\n\n", PROFILE_FILE);
+	printf("    --profile=file|none: Profile of --autotune used to render. Without -V and\n"
+		   "                         -t, implementation and threads are taken from the\n"
+		   "                         entry of the image size and n, the band height always.\n"
+		   "                         Default: ~/%s if it exists\n\n", PROFILE_FILE);
+	printf("    --affinity=mode:     Render with workers pinned to processors and NUMA\n"
+		   "                         aware memory: the workers of every node first-touch\n"
+		   "                         the rows they render and take bands of their own\n"
+		   "                         node before stealing from other nodes. mode is\n"
+		   "                         scatter (worker t on node t %% nodes), compact (fill\n"
+		   "                         one node after the other), none (not pinned) or a\n"
+		   "                         processor list like 0-3,8. Default of --numa-sim and\n"
+		   "                         --numa-bench: scatter\n\n");
+	printf("    --numa-sim=nodes:    Split the processors into nodes simulated NUMA nodes\n"
+		   "                         (sharing processors if there are fewer), to test\n"
+		   "                         placement on a single node machine.\n\n");
+	printf("    --numa-bench:        Compare placement of --affinity with naive placement\n"
+		   "                         (buffer touched by the main thread, one queue of\n"
+		   "                         unpinned workers) for all c values at %lu x %lu.\n"
+		   "                         Threads: -t or all processors.\n\n", image_sizes[NUMA_BENCH_SIZE],
+		                                                                    image_sizes[NUMA_BENCH_SIZE]);
+	printf("    --counters:          Read hardware performance counters (cycles,\n"
+		   "                         instructions, IPC, branch misses, L1d and LLC misses)\n"
+		   "                         with perf_event_open. With -B every kernel call is\n"
+		   "                         counted, otherwise the image is rendered in three\n"
+		   "                         counted phases: iterate, color and write.\n"
+		   "                         Falls back to time measurement if counters are not\n"
+		   "                         available.\n\n");
+	printf("    --tile-stats=prefix: Render in tiles of 32x32 pixels and write iteration\n"
+		   "                         sum, maximum, convergent pixels and wall time of\n"
+		   "                         every tile into prefix_tiles.csv, a heatmap of\n"
+		   "                         iterations per tile into prefix_heatmap.bmp and a\n"
+		   "                         histogram of iterations into prefix_histogram.csv.\n\n");
+	printf("    --trace=file:        Write a timeline of the render in Chrome trace event\n"
+		   "                         format (open with chrome://tracing or Perfetto):\n"
+		   "                         phases of the program, every band and every worker\n"
+		   "                         thread.\n\n");
 	printf("    -h or --help:        Prints complete usage information\n\n");       
 }
 
@@ -97,12 +286,54 @@ void invalid_argument(char flag) {
 	fprintf(stderr, "Invalid argument for option -%c, use -h or --help for help.\n", flag);
 	exit(EXIT_FAILURE);
 }
+void invalid_long_argument(const char* name) {
+	fprintf(stderr, "Invalid argument for option --%s, use -h or --help for help.\n", name);
+	exit(EXIT_FAILURE);
+}
 void missing_second_option(char flag) {
 	fprintf(stderr, "Option -%c needs second argument, use -h or --help for help.\n", flag);
 	exit(EXIT_FAILURE);
 }
 
+//return values of getopt_long for options which only have a long name
+enum {
+	OPT_BENCH = 256,
+	OPT_WARMUP,
+	OPT_BENCH_SIZES,
+	OPT_BENCH_REGRESS,
+	OPT_BENCH_BASELINE,
+	OPT_THRESHOLD,
+	OPT_COUNTERS,
+	OPT_TILE_STATS,
+	OPT_TRACE,
+	OPT_FUZZ,
+	OPT_TOLERANCE,
+	OPT_BAILOUT,
+	OPT_COLOR,
+	OPT_DISTANCE,
+	OPT_MIIM,
+	OPT_AA,
+	OPT_ATLAS,
+	OPT_ESTIMATE,
+	OPT_FRAME,
+	OPT_AUTOTUNE,
+	OPT_PROFILE,
+	OPT_AFFINITY,
+	OPT_NUMA_SIM,
+	OPT_NUMA_BENCH,
+};
+
+//modes of --distance
+enum {
+	DISTANCE_OFF,
+	DISTANCE_ON, //iterate every pixel
+	DISTANCE_FILL, //fill disks around exterior pixels
+};
+
 int main(int argc, char **argv) {
+	//start of argument parsing, shown as time 0 in the trace
+	uint64_t program_start = trace_now();
+
 	//initialize arguments with default values defined above
 	//default values are used if not given by user
 	int implementation = INTRIN_V0;
@@ -110,25 +341,91 @@ int main(int argc, char **argv) {
 	size_t width = DEFAULT_WIDTH;
 	size_t height = DEFAULT_HEIGHT;
 	unsigned n = DEFAULT_N;
+	bool n_auto = false;
 	float res = DEFAULT_RES;
 	float complex c = DEFAULT_C;
 	char *path = DEFAULT_PATH; 
 	unsigned char *img;
 	long int repetitions = DEFAULT_REPETITIONS;
+	int threads = 0; //0: not given, render with one thread and test with all processors
+	char* trace_path = NULL;
+	int family = FAMILY_QUADRATIC;
+	unsigned degree = 2; //exponent of multibrot family
+	float bailout = 0.0f; //0: escape radius max{|c|, 2}
+	bool histogram_coloring = false;
+	int distance = DISTANCE_OFF;
+	unsigned miim_hits = 0; //0: escape time rendering, otherwise hits per pixel of inverse iteration
+	bool supersampling = false;
+	unsigned aa_threshold = SS_DEFAULT_THRESHOLD;
+	size_t atlas_cols = 0; //0: no atlas, otherwise thumbnails per row
+	size_t atlas_rows = 0;
+	bool atlas_files = false;
+	bool res_given = false;
+	bool estimating = false;
+	JuliaRate rate = {0.0, 0.0, CALIBRATION_MIN_ERROR}; //giter_per_s 0: calibrate
+	float frame_margin = -1.0f; //negative: view of -s and -r, otherwise framed around the set
+	bool tuning = false;
+	char* profile_path = NULL; //NULL: default profile if it exists
+	bool implementation_given = false;
+	size_t band_height = DEFAULT_BAND_HEIGHT;
+	//pinned workers with first touch, used if an affinity or simulated nodes are given
+	Placement placement;
+	placement.affinity = AFFINITY_SCATTER;
+	placement.local = true;
+	const char* affinity = NULL;
+	int numa_nodes = 0; //0: nodes of the machine
+	bool placing = false;
+	bool numa_bench = false;
 
 	//performance and correctness testing options
 	bool benchmarking = false;
-	int correctness = 0; //0: no correctness test, 1: run correctness test, 2: run correctness test and create image
+	bool bench_suite = false;
+	char* regress_path = NULL;
+	char* baseline_path = NULL;
+	double threshold = DEFAULT_THRESHOLD;
+	bool use_counters = false;
+	char* tile_stats = NULL; //prefix of tile statistics files
+	BenchConfig bench_config = {DEFAULT_WARMUP, DEFAULT_REPETITIONS, 10, DEFAULT_N, BENCH_CSV};
+	//0: no correctness test, 1: run correctness test, 2: run correctness test and create image,
+	//3: detailed correctness test, 4: randomised correctness test
+	int correctness = 0;
+	double fuzz_seconds = DEFAULT_FUZZ_SECONDS;
+	double tolerance = -1.0; //negative: fma implementations have to be bit-exact with the fma reference
 
 	// helper variables for parsing arguments below
 	char *token;
 	char *endptr;
 
-	static const struct option long_options[] = {{"help", no_argument, 0, 'h'},{NULL, 0, NULL, '?'}};
+	static const struct option long_options[] = {{"help", no_argument, 0, 'h'},
+	                                             {"bench", optional_argument, 0, OPT_BENCH},
+	                                             {"warmup", required_argument, 0, OPT_WARMUP},
+	                                             {"bench-sizes", required_argument, 0, OPT_BENCH_SIZES},
+	                                             {"bench-regress", required_argument, 0, OPT_BENCH_REGRESS},
+	                                             {"bench-baseline", required_argument, 0, OPT_BENCH_BASELINE},
+	                                             {"threshold", required_argument, 0, OPT_THRESHOLD},
+	                                             {"counters", no_argument, 0, OPT_COUNTERS},
+	                                             {"tile-stats", required_argument, 0, OPT_TILE_STATS},
+	                                             {"trace", required_argument, 0, OPT_TRACE},
+	                                             {"fuzz", optional_argument, 0, OPT_FUZZ},
+	                                             {"tolerance", required_argument, 0, OPT_TOLERANCE},
+	                                             {"bailout", required_argument, 0, OPT_BAILOUT},
+	                                             {"color", required_argument, 0, OPT_COLOR},
+	                                             {"distance", optional_argument, 0, OPT_DISTANCE},
+	                                             {"miim", optional_argument, 0, OPT_MIIM},
+	                                             {"aa", optional_argument, 0, OPT_AA},
+	                                             {"atlas", required_argument, 0, OPT_ATLAS},
+	                                             {"estimate", optional_argument, 0, OPT_ESTIMATE},
+	                                             {"frame", optional_argument, 0, OPT_FRAME},
+	                                             {"autotune", optional_argument, 0, OPT_AUTOTUNE},
+	                                             {"profile", required_argument, 0, OPT_PROFILE},
+	                                             {"affinity", required_argument, 0, OPT_AFFINITY},
+	                                             {"numa-sim", required_argument, 0, OPT_NUMA_SIM},
+	                                             {"numa-bench", no_argument, 0, OPT_NUMA_BENCH},
+	                                             {NULL, 0, NULL, '?'}};
 	int index = -1;
 	int flag;
 
-	while ((flag = getopt_long(argc, argv, "V:B::s:d:n:r:c:o:hx::", long_options, &index)) != -1) {
+	while ((flag = getopt_long(argc, argv, "V:B::s:d:n:r:c:o:t:f:hx::", long_options, &index)) != -1) {
 		switch (flag) {
 			//help
 			case 'h':
@@ -139,7 +436,10 @@ int main(int argc, char **argv) {
 				correctness = 1;
 				if (optarg != NULL) {
 					if (strcmp(optarg, "0") == 0) {
-						test_correctness();
+						correctness = 3;
+					}
+					if (strcmp(optarg, "t") == 0) {
+						test_threads();
 						return 0;
 					}
 					if (strcmp(optarg, "i") == 0) {
@@ -149,17 +449,46 @@ int main(int argc, char **argv) {
 				break;
 			//implementation version
 			case 'V':
-				//only 0, 1 and 2 are valid arguments for this options
+				implementation_given = true;
+				//only 0 to 7 are valid arguments for this options
 				if (optarg != NULL) {
 					if (strcmp(optarg, "1") == 0) {
 						implementation = INTRIN_V1;
 					} else if (strcmp(optarg, "2") == 0) {
 						implementation = NAIVE;
+					} else if (strcmp(optarg, "3") == 0) {
+						implementation = INTRIN_FMA;
+					} else if (strcmp(optarg, "4") == 0) {
+						implementation = INTRIN_AVX2_FMA;
+					} else if (strcmp(optarg, "5") == 0) {
+						implementation = INTRIN_INTERLEAVED;
+					} else if (strcmp(optarg, "6") == 0) {
+						implementation = INTRIN_DEFERRED;
+					} else if (strcmp(optarg, "7") == 0) {
+						implementation = INTRIN_MORTON;
 					} else if (strcmp(optarg, "0") != 0) {
 						invalid_argument('V');
 					}					
 				}
 				break;
+			//iteration family
+			case 'f':
+				if (strcmp(optarg, "quadratic") == 0) {
+					family = FAMILY_QUADRATIC;
+				} else if (strcmp(optarg, "burning-ship") == 0) {
+					family = FAMILY_BURNING_SHIP;
+				} else if (strncmp(optarg, "multibrot", 9) == 0 && optarg[9] != '\0') {
+					errno = 0;
+					unsigned long d = strtoul(optarg + 9, &endptr, 10);
+					if (errno != 0 || *endptr != '\0' || d < MULTIBROT_MIN_DEGREE || d > MULTIBROT_MAX_DEGREE) {
+						invalid_argument('f');
+					}
+					family = FAMILY_MULTIBROT;
+					degree = d;
+				} else {
+					invalid_argument('f');
+				}
+				break;
 			//benchmarking
 			case 'B':
 				benchmarking = true;
@@ -182,7 +511,8 @@ int main(int argc, char **argv) {
 			case 'c':
 				//if -c rand is given, choose a random c from selected c values.
 				if (flag == 'c' && optarg && strcmp(optarg, "rand") == 0) {
-					c = get_random_c();
+					unsigned seed = (unsigned) time(NULL);
+					c = get_random_c(&seed);
 					break;
 				}
 				float re, im;
@@ -243,6 +573,10 @@ int main(int argc, char **argv) {
 				break;
 			//maximum number of iterations
 			case 'n':
+				if (strcmp(optarg, "auto") == 0) {
+					n_auto = true;
+					break;
+				}
 				errno = 0;
 				long val = strtol(optarg, &endptr, 10);
 				if (errno != 0 || *endptr != '\0' || val < 0 || val >= UINT_MAX) {
@@ -257,6 +591,7 @@ int main(int argc, char **argv) {
 				if (errno != 0 || *endptr != '\0' || res <= 0.0f) {
 					invalid_argument('r');
 				}
+				res_given = true;
 
 				break;
 			//output file
@@ -270,8 +605,218 @@ int main(int argc, char **argv) {
 				}
 				path = optarg;
 				break;
+			//non-interactive benchmark harness
+			case OPT_BENCH:
+				bench_suite = true;
+				if (optarg != NULL) {
+					if (strcmp(optarg, "json") == 0) {
+						bench_config.format = BENCH_JSON;
+					} else if (strcmp(optarg, "csv") != 0) {
+						invalid_long_argument("bench");
+					}
+				}
+				break;
+			case OPT_WARMUP:
+				errno = 0;
+				bench_config.warmup = strtol(optarg, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || bench_config.warmup < 0) {
+					invalid_long_argument("warmup");
+				}
+				break;
+			case OPT_BENCH_SIZES:
+				errno = 0;
+				bench_config.sizes = strtol(optarg, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || bench_config.sizes < 1 || bench_config.sizes > 10) {
+					invalid_long_argument("bench-sizes");
+				}
+				break;
+			//performance regression suite
+			case OPT_BENCH_REGRESS:
+				regress_path = optarg;
+				break;
+			case OPT_BENCH_BASELINE:
+				baseline_path = optarg;
+				break;
+			case OPT_THRESHOLD:
+				errno = 0;
+				threshold = strtod(optarg, &endptr);
+				if (errno != 0 || *endptr != '\0' || threshold < 0.0) {
+					invalid_long_argument("threshold");
+				}
+				break;
+			//hardware performance counters
+			case OPT_COUNTERS:
+				use_counters = true;
+				break;
+			//per tile statistics
+			case OPT_TILE_STATS:
+				tile_stats = optarg;
+				break;
+			//number of threads
+			case 't':
+				errno = 0;
+				long t = strtol(optarg, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || t < 1 || t > MAX_THREADS) {
+					invalid_argument('t');
+				}
+				threads = t;
+				break;
+			//trace event timeline
+			case OPT_TRACE:
+				trace_path = optarg;
+				break;
+			//randomised correctness test
+			case OPT_FUZZ:
+				correctness = 4;
+				if (optarg != NULL) {
+					errno = 0;
+					fuzz_seconds = strtod(optarg, &endptr);
+					if (errno != 0 || *endptr != '\0' || fuzz_seconds <= 0.0) {
+						invalid_long_argument("fuzz");
+					}
+				}
+				break;
+			//allowed difference of fma implementations
+			case OPT_TOLERANCE:
+				errno = 0;
+				tolerance = strtod(optarg, &endptr);
+				if (errno != 0 || *endptr != '\0' || tolerance < 0.0 || tolerance > 100.0) {
+					invalid_long_argument("tolerance");
+				}
+				break;
+			//escape radius
+			case OPT_BAILOUT:
+				errno = 0;
+				bailout = strtof(optarg, &endptr);
+				if (errno != 0 || *endptr != '\0' || !(bailout > 0.0f) || isinf(bailout)) {
+					invalid_long_argument("bailout");
+				}
+				break;
+			//coloring of iteration numbers
+			case OPT_COLOR:
+				if (strcmp(optarg, "histogram") == 0) {
+					histogram_coloring = true;
+				} else if (strcmp(optarg, "linear") == 0) {
+					histogram_coloring = false;
+				} else {
+					invalid_long_argument("color");
+				}
+				break;
+			//distance estimation
+			case OPT_DISTANCE:
+				distance = DISTANCE_ON;
+				if (optarg != NULL) {
+					if (strcmp(optarg, "fill") != 0) {
+						invalid_long_argument("distance");
+					}
+					distance = DISTANCE_FILL;
+				}
+				break;
+			//boundary by inverse iteration
+			case OPT_MIIM:
+				miim_hits = MIIM_DEFAULT_HITS;
+				if (optarg != NULL) {
+					errno = 0;
+					unsigned long hits = strtoul(optarg, &endptr, 10);
+					if (errno != 0 || *endptr != '\0' || hits < 1 || hits > 255) {
+						invalid_long_argument("miim");
+					}
+					miim_hits = hits;
+				}
+				break;
+			//adaptive supersampling
+			case OPT_AA:
+				supersampling = true;
+				if (optarg != NULL) {
+					errno = 0;
+					unsigned long value = strtoul(optarg, &endptr, 10);
+					if (errno != 0 || *endptr != '\0' || *optarg == '\0' || value > UINT_MAX) {
+						invalid_long_argument("aa");
+					}
+					aa_threshold = value;
+				}
+				break;
+			//mosaic of thumbnails for a grid of c values
+			case OPT_ATLAS:
+				token = strtok(optarg, ",");
+				errno = 0;
+				long cols = strtol(token, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || cols <= 0) {
+					invalid_long_argument("atlas");
+				}
+				token = strtok(NULL, ",");
+				if (token == NULL) {
+					invalid_long_argument("atlas");
+				}
+				errno = 0;
+				long rows = strtol(token, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || rows <= 0) {
+					invalid_long_argument("atlas");
+				}
+				token = strtok(NULL, ",");
+				if (token != NULL) {
+					if (strcmp(token, "files") != 0) {
+						invalid_long_argument("atlas");
+					}
+					atlas_files = true;
+				}
+				atlas_cols = cols;
+				atlas_rows = rows;
+				break;
+			//predict cost instead of rendering
+			case OPT_ESTIMATE:
+				estimating = true;
+				if (optarg != NULL) {
+					errno = 0;
+					rate.giter_per_s = strtod(optarg, &endptr);
+					if (*endptr == ',') {
+						rate.ns_per_pixel = strtod(endptr + 1, &endptr);
+					}
+					if (*endptr == ',') {
+						rate.error = strtod(endptr + 1, &endptr);
+					}
+					if (errno != 0 || *endptr != '\0' || !(rate.giter_per_s > 0.0) || rate.ns_per_pixel < 0.0 || rate.error < 0.0) {
+						invalid_long_argument("estimate");
+					}
+				}
+				break;
+			//machine profile
+			case OPT_AUTOTUNE:
+				tuning = true;
+				profile_path = optarg;
+				break;
+			case OPT_PROFILE:
+				profile_path = optarg;
+				break;
+			//numa placement
+			case OPT_AFFINITY:
+				affinity = optarg;
+				placing = true;
+				break;
+			case OPT_NUMA_SIM:
+				errno = 0;
+				numa_nodes = strtol(optarg, &endptr, 10);
+				if (errno != 0 || *endptr != '\0' || numa_nodes < 1 || numa_nodes > PLACEMENT_MAX_NODES) {
+					invalid_long_argument("numa-sim");
+				}
+				placing = true;
+				break;
+			case OPT_NUMA_BENCH:
+				numa_bench = true;
+				break;
+			//choose the view around the set
+			case OPT_FRAME:
+				frame_margin = FRAME_DEFAULT_MARGIN;
+				if (optarg != NULL) {
+					errno = 0;
+					frame_margin = strtof(optarg, &endptr);
+					if (errno != 0 || *endptr != '\0' || !(frame_margin >= 0.0f && frame_margin <= 0.45f)) {
+						invalid_long_argument("frame");
+					}
+				}
+				break;
 			case '?':
-				if (optopt == 's' || optopt == 'd' || optopt == 'n' || optopt == 'r' || optopt == 'c' || optopt == 'o' || optopt == 'h') {
+				if (optopt == 's' || optopt == 't' || optopt == 'd' || optopt == 'n' || optopt == 'r' || optopt == 'c' || optopt == 'o' || optopt == 'f' || optopt == 'h') {
 					fprintf(stderr, "Option -%c needs an argument, use -h or --help for help.\n", optopt);
 				}
 				else {
@@ -288,6 +833,74 @@ int main(int argc, char **argv) {
 		return EXIT_FAILURE;
 	}
 
+	if (!julia_implementation_supported(implementation)) {
+		fprintf(stderr, "Implementation %d is not supported by this processor.\n", implementation);
+		return EXIT_FAILURE;
+	}
+	if (!implementation_supports_family(implementation, family)) {
+		fprintf(stderr, "Implementation %d does not support the chosen iteration family, use -V 0.\n", implementation);
+		return EXIT_FAILURE;
+	}
+
+	if (trace_path != NULL) {
+		trace_enable(program_start);
+		trace_thread_name("main");
+		trace_event("parse arguments", program_start);
+	}
+
+	if (placing || numa_bench) {
+		if (topology_read(&placement.topology) != 0) {
+			return EXIT_FAILURE;
+		}
+		if (numa_nodes != 0) {
+			topology_simulate(&placement.topology, numa_nodes);
+		}
+		if (affinity != NULL && placement_parse_affinity(&placement, affinity) != 0) {
+			invalid_long_argument("affinity");
+		}
+	}
+	if (numa_bench) {
+		int bench_threads = (threads != 0) ? threads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+		numa_benchmark(&placement, (bench_threads > 0) ? bench_threads : 1, band_height, n);
+		return 0;
+	}
+
+	if (tuning) {
+		char default_path[4096];
+		if (profile_path == NULL) {
+			profile_path = profile_default_path(default_path, sizeof(default_path));
+			if (profile_path == NULL) {
+				fprintf(stderr, "HOME is not set, use --autotune=file.\n");
+				return EXIT_FAILURE;
+			}
+		}
+		int max_threads = (threads != 0) ? threads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+		Profile profile;
+		if (autotune(&profile, (max_threads > 0) ? max_threads : 1) != 0 || profile_write(&profile, profile_path) != 0) {
+			return EXIT_FAILURE;
+		}
+		profile_print(&profile, stdout);
+		printf("--> Profile %s is created.\n", profile_path);
+		return 0;
+	}
+
+	if (baseline_path != NULL) {
+		return write_baseline(baseline_path) == 0 ? 0 : EXIT_FAILURE;
+	}
+	if (regress_path != NULL) {
+		return compare_baseline(regress_path, threshold) == 0 ? 0 : EXIT_FAILURE;
+	}
+
+	if (bench_suite) {
+		if (repetitions < 1) {
+			invalid_argument('B');
+		}
+		bench_config.repetitions = repetitions;
+		bench_config.n = n;
+		benchmark_suite(&bench_config, stdout);
+		return 0;
+	}
+
 	if (correctness != 0 && benchmarking) {
 		fprintf(stderr, "Invalid arguments: -x and -B[repetitions] flags are set at the same time.\n");
 		fprintf(stderr, "Can not run perfomance and correctness test simultaneously.\n");
@@ -295,18 +908,160 @@ int main(int argc, char **argv) {
 	}
 
 	Arguments* args = get_args(c, start, res, n);
+	if (init_family(args, family, degree, bailout) != 0) {
+		return EXIT_FAILURE;
+	}
+	if (frame_margin >= 0.0f) {
+		if (atlas_cols != 0) {
+			fprintf(stderr, "Invalid arguments: every thumbnail of --atlas has its own c, --frame needs one c.\n");
+			return EXIT_FAILURE;
+		}
+		Frame frame;
+		uint64_t frame_start = trace_now();
+		if (frame_julia(args, width, height, frame_margin, &frame) != 0) {
+			return EXIT_FAILURE;
+		}
+		trace_event("frame", frame_start);
+		start = frame.start;
+		res = frame.res;
+		args->start = start;
+		args->res = res;
+		printf("Frame: [%f, %f] x [%f, %f] i -> -s %f,%f -r %g (%f s, %lu samples)\n", crealf(frame.low),
+		                crealf(frame.high), cimagf(frame.low), cimagf(frame.high), crealf(start), cimagf(start), res,
+		                frame.seconds, frame.samples);
+	}
+	if (n_auto) {
+		AutoIterations chosen;
+		uint64_t prepass_start = trace_now();
+		if (choose_iterations(args, width, height, &chosen) != 0) {
+			return EXIT_FAILURE;
+		}
+		trace_event("n auto pre-pass", prepass_start);
+		n = chosen.n;
+		args->n = n;
+		printf("Automatic n: %u (pre-pass: %f s, %lu samples, %.1f%% escaped within %d steps,\n"
+		       "                  %lu samples escape after more than n steps)\n", n, chosen.seconds, chosen.samples,
+		                chosen.escaped * 100.0 / chosen.samples, AUTO_N_CAP, chosen.ambiguous);
+	}
+
+	//configuration of the machine profile, only for renders. --estimate also takes the rate from it
+	char default_path[4096];
+	Profile profile;
+	profile_clear(&profile);
+	if (correctness == 0 && !benchmarking && (profile_path == NULL || strcmp(profile_path, "none") != 0)) {
+		bool explicit = profile_path != NULL;
+		if (!explicit) {
+			profile_path = profile_default_path(default_path, sizeof(default_path));
+		}
+		const TuneEntry* entry = NULL;
+		if (profile_path != NULL && (explicit || access(profile_path, R_OK) == 0)) {
+			if (profile_read(&profile, profile_path) != 0) {
+				return EXIT_FAILURE;
+			}
+			entry = profile_lookup(&profile, width * height, n);
+		}
+		if (entry != NULL) {
+			if (!implementation_given && implementation_supports_family(entry->implementation, family)) {
+				implementation = entry->implementation;
+			}
+			if (threads == 0) {
+				threads = entry->threads;
+			}
+			band_height = entry->band_height;
+			printf("Profile %s: %s, %d threads, bands of %lu rows\n", profile_path, names[implementation],
+			                (threads != 0) ? threads : 1, band_height);
+		}
+	}
+
+	//tests are split into tiles, which are checked by all processors unless -t is given
+	int test_threads = (threads != 0) ? threads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (test_threads < 1) {
+		test_threads = 1;
+	}
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	if (estimating) {
+		if (rate.giter_per_s == 0.0 && profile.rates[implementation].giter_per_s > 0.0) {
+			rate = profile.rates[implementation];
+			printf("Rate of %s from profile %s: %.4f Giter/s, %.2f ns per pixel, %.1f%% error\n",
+			                names[implementation], profile_path, rate.giter_per_s, rate.ns_per_pixel, 100 * rate.error);
+		} else if (rate.giter_per_s == 0.0) {
+			struct timespec calibration_start;
+			struct timespec calibration_end;
+			clock_gettime(CLOCK_MONOTONIC, &calibration_start);
+			if (julia_calibrate(implementation, &rate) != 0) {
+				return EXIT_FAILURE;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &calibration_end);
+			printf("Calibration: %.4f Giter/s, %.2f ns per pixel, %.1f%% error with %s (%f s)\n", rate.giter_per_s,
+			                rate.ns_per_pixel, 100 * rate.error, names[implementation],
+			                calibration_end.tv_sec - calibration_start.tv_sec
+			                + 1e-9 * (calibration_end.tv_nsec - calibration_start.tv_nsec));
+			//later estimates take the rate from the profile
+			if (profile_path != NULL && strcmp(profile_path, "none") != 0) {
+				profile.rates[implementation] = rate;
+				if (profile_write(&profile, profile_path) == 0) {
+					printf("             saved in profile %s\n", profile_path);
+				}
+			}
+		}
+		//ideal scaling: threads share the lane iterations and the pixels
+		JuliaRate scaled = {rate.giter_per_s * threads, rate.ns_per_pixel / threads, rate.error};
+		JuliaParams params;
+		plan_params(&params, implementation, args, width, height);
+		JuliaEstimate estimate;
+		if (julia_estimate(&params, &scaled, &estimate) != 0) {
+			return EXIT_FAILURE;
+		}
+		printf("Estimate: %.3g iterations [%.3g, %.3g], %.3g lane iterations\n"
+		       "          %f s [%f, %f] with %d threads\n"
+		       "          (%lu groups of 4 pixels with cap %u in %f s)\n", estimate.iterations,
+		                estimate.iterations_low, estimate.iterations_high, estimate.lane_iterations, estimate.seconds,
+		                estimate.seconds_low, estimate.seconds_high, threads, estimate.samples, estimate.cap,
+		                estimate.sample_seconds);
+		return 0;
+	}
+
+	if (correctness == 3) {
+		return (test_correctness(tolerance, test_threads) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (correctness == 4) {
+		return (test_fuzz(fuzz_seconds, tolerance, test_threads) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
 	//correctness is 1 or 2.
 	if (correctness != 0) {
 		//test run all implementations for correctness
-		test(args, width, height);
+		if (test(args, width, height, tolerance, test_threads) != 0) {
+			return EXIT_FAILURE;
+		}
 
 		//do not create an image, just return
 		if (correctness == 1) 
 			return 0;
 	}
         
+	//-d gives the size of one thumbnail, the image is the mosaic of all thumbnails
+	Atlas atlas;
+	if (atlas_cols != 0) {
+		if (family != FAMILY_QUADRATIC) {
+			fprintf(stderr, "Atlas mode is only supported for the quadratic family.\n");
+			return EXIT_FAILURE;
+		}
+		if (!res_given) {
+			res = 3.0f / ((width > height) ? width : height);
+		}
+		if (atlas_create(&atlas, atlas_cols, atlas_rows, width, height, start, res, n, bailout) != 0) {
+			return EXIT_FAILURE;
+		}
+		width *= atlas_cols;
+		height *= atlas_rows;
+	}
+
 	//allocate memory for image array and create structs from variables
+	uint64_t allocation_start = trace_now();
 	img = malloc(height * width * 3);
 	if (img == NULL) {
 		fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", width, height);
@@ -314,10 +1069,73 @@ int main(int argc, char **argv) {
 	}
 
 	Image* my_img = get_img(width, height, img, n);
+	trace_event("allocation", allocation_start);
+
+	Counters counters;
+	if (use_counters) {
+		counters_open(&counters);
+	}
 
 	//run performance test
 	if (benchmarking) {
-		measure(implementation, repetitions, args, my_img, true);
+		measure(implementation, repetitions, args, my_img, true, use_counters ? &counters : NULL);
+	}
+	//render tile by tile and write statistics of every tile
+	else if (tile_stats != NULL) {
+		JuliaParams params;
+		plan_params(&params, implementation, args, width, height);
+		JuliaPlan* plan = julia_plan_create(&params);
+		if (plan == NULL || render_tile_stats(plan, img, tile_stats) != 0) {
+			return EXIT_FAILURE;
+		}
+		julia_plan_destroy(plan);
+	}
+	//run the algorithm phase by phase and count every phase
+	else if (use_counters) {
+		if (measure_phases(implementation, args, my_img, path, &counters) != 0) {
+			return EXIT_FAILURE;
+		}
+		printf("--> Image %s is created.\n", path);
+	}
+	//plot the boundary by inverse iteration
+	else if (miim_hits != 0) {
+		MiimStats stats;
+		struct timespec miim_start;
+		struct timespec miim_end;
+		uint64_t kernel_start = trace_now();
+		clock_gettime(CLOCK_MONOTONIC, &miim_start);
+		if (julia_miim_render(args, my_img, miim_hits, &stats) != 0) {
+			return EXIT_FAILURE;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &miim_end);
+		trace_event("inverse iteration", kernel_start);
+		printf("Inverse iteration: %f s, %llu preimages, %llu boundary pixels (%.1f%% of all pixels)\n",
+		                miim_end.tv_sec - miim_start.tv_sec + 1e-9 * (miim_end.tv_nsec - miim_start.tv_nsec),
+		                stats.points, stats.pixels, stats.pixels * 100.0 / (width * height));
+	}
+	//thumbnails of many c values in one vector loop
+	else if (atlas_cols != 0) {
+		struct timespec atlas_start;
+		struct timespec atlas_end;
+		uint64_t kernel_start = trace_now();
+		clock_gettime(CLOCK_MONOTONIC, &atlas_start);
+		if (render_atlas(&atlas, my_img, threads) != 0) {
+			return EXIT_FAILURE;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &atlas_end);
+		trace_event("atlas", kernel_start);
+		double seconds = atlas_end.tv_sec - atlas_start.tv_sec + 1e-9 * (atlas_end.tv_nsec - atlas_start.tv_nsec);
+		printf("Atlas: %f s, %lu x %lu thumbnails of %lu x %lu pixels (res = %.6f), %.1f Mpixel/s\n",
+		                seconds, atlas_cols, atlas_rows, atlas.width, atlas.height, res,
+		                width * height / seconds * 1e-6);
+		if (atlas_files) {
+			if (write_atlas_files(&atlas, img, path) != 0) {
+				return EXIT_FAILURE;
+			}
+			printf("--> %lu thumbnails %.*s_<col>_<row>.bmp are created.\n", atlas_cols * atlas_rows,
+			                                                                (int) strlen(path) - 4, path);
+		}
+		atlas_destroy(&atlas);
 	}
 	//run the algorithm 
 	else {
@@ -328,25 +1146,151 @@ int main(int argc, char **argv) {
 		switch (implementation) {
 			case INTRIN_V0:
 				printf("Running implementation Optimized (V0) ...\n\n");
-				julia(c, start, width, height, res, n, img);
 				break;
 			case INTRIN_V1:
 				printf("Running implementation Less Optimized (V1) ...\n\n");
-				julia_V1(c, start, width, height, res, n, img);
 				break;
 			case NAIVE:
 				printf("Running implementation Naive (V2) ...\n\n");
-				julia_V2(c, start, width, height, res, n, img);
 				break;
+			case INTRIN_FMA:
+				printf("Running implementation Optimized FMA (V3) ...\n\n");
+				break;
+			case INTRIN_AVX2_FMA:
+				printf("Running implementation Optimized AVX2 FMA (V4) ...\n\n");
+				break;
+			case INTRIN_INTERLEAVED:
+				printf("Running implementation Interleaved (V5) ...\n\n");
+				break;
+			case INTRIN_DEFERRED:
+				printf("Running implementation Deferred Bailout (V6) ...\n\n");
+				break;
+			case INTRIN_MORTON:
+				printf("Running implementation Morton 2x2 (V7) ...\n\n");
+				break;
+		}
+		if (distance != DISTANCE_OFF) {
+			distance_radius(args);
+		}
+		JuliaParams params;
+		plan_params(&params, implementation, args, width, height);
+		JuliaPlan* plan = julia_plan_create(&params);
+		if (plan == NULL) {
+			return EXIT_FAILURE;
 		}
+		if (distance != DISTANCE_OFF) {
+			float* field = malloc(width * height * sizeof(float));
+			if (field == NULL) {
+				fprintf(stderr, "Could not allocate memory for a distance field sized %lu x %lu.\n", width, height);
+				return EXIT_FAILURE;
+			}
+			struct timespec de_start;
+			struct timespec de_end;
+			unsigned long long iterated;
+			uint64_t kernel_start = trace_now();
+			clock_gettime(CLOCK_MONOTONIC, &de_start);
+			if (render_distance(plan, field, distance == DISTANCE_FILL, threads, &iterated) != 0) {
+				return EXIT_FAILURE;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &de_end);
+			trace_event("distance estimation", kernel_start);
+			printf("Distance estimation: %f s, %.1f%% of all pixels iterated\n",
+			                de_end.tv_sec - de_start.tv_sec + 1e-9 * (de_end.tv_nsec - de_start.tv_nsec),
+			                iterated * 100.0 / (width * height));
+			color_distance(my_img, field, res);
+			free(field);
+		}
+		else if (histogram_coloring) {
+			//iteration numbers first, 16-bit if n allows it, colored after the whole histogram is known
+			bool narrow = field16_fits(n);
+			void* field = malloc(width * height * (narrow ? sizeof(uint16_t) : sizeof(unsigned)));
+			if (field == NULL) {
+				fprintf(stderr, "Could not allocate memory for an iteration field sized %lu x %lu.\n", width, height);
+				return EXIT_FAILURE;
+			}
+			uint64_t kernel_start = trace_now();
+			if (render_parallel(plan, NULL, narrow ? NULL : field, narrow ? field : NULL, threads,
+			                                                                    band_height) != 0) {
+				return EXIT_FAILURE;
+			}
+			trace_event("julia kernel", kernel_start);
+
+			struct timespec color_start;
+			struct timespec color_end;
+			uint64_t coloring_start = trace_now();
+			clock_gettime(CLOCK_MONOTONIC, &color_start);
+			if (color_histogram(my_img, narrow ? NULL : field, narrow ? field : NULL, n, threads) != 0) {
+				return EXIT_FAILURE;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &color_end);
+			trace_event("histogram coloring", coloring_start);
+			printf("Histogram coloring: %f s with %d threads (%d-bit iteration field)\n",
+			                color_end.tv_sec - color_start.tv_sec + 1e-9 * (color_end.tv_nsec - color_start.tv_nsec),
+			                threads, narrow ? 16 : 32);
+			free(field);
+		}
+		else if (supersampling) {
+			struct timespec aa_start;
+			struct timespec aa_end;
+			SupersampleStats stats;
+			uint64_t kernel_start = trace_now();
+			clock_gettime(CLOCK_MONOTONIC, &aa_start);
+			if (render_supersampled(plan, img, aa_threshold, threads, &stats) != 0) {
+				return EXIT_FAILURE;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &aa_end);
+			trace_event("adaptive supersampling", kernel_start);
+			printf("Adaptive supersampling: %f s, %.1f%% of all pixels supersampled,\n"
+			       "                        %llu samples = %.3f x pixel count\n",
+			                aa_end.tv_sec - aa_start.tv_sec + 1e-9 * (aa_end.tv_nsec - aa_start.tv_nsec),
+			                stats.supersampled * 100.0 / stats.pixels, stats.samples,
+			                (double) stats.samples / stats.pixels);
+		}
+		else if (placing) {
+			PlacementStats stats;
+			uint64_t kernel_start = trace_now();
+			if (render_parallel_placed(plan, img, NULL, NULL, threads, band_height, &placement, &stats) != 0) {
+				return EXIT_FAILURE;
+			}
+			trace_event("julia kernel", kernel_start);
+			placement_print(&placement);
+			printf("    %lu bands: %.1f%% rendered on a remote node, %.1f%% stolen from another node\n",
+			                stats.bands, stats.remote_bands * 100.0 / stats.bands,
+			                stats.stolen_bands * 100.0 / stats.bands);
+			if (stats.pin_failures > 0) {
+				printf("    %d workers could not be pinned\n", stats.pin_failures);
+			}
+		}
+		else {
+			uint64_t kernel_start = trace_now();
+			if (render_parallel(plan, img, NULL, NULL, threads, band_height) != 0) {
+				return EXIT_FAILURE;
+			}
+			trace_event("julia kernel", kernel_start);
+		}
+		julia_plan_destroy(plan);
 	}
 
 	//if -B flag not set, create the image
-	if (!benchmarking) {
-		generateBitmapImage(img, height, width, path);
+	if (!benchmarking && !use_counters && !atlas_files) {
+		uint64_t write_start = trace_now();
+		if (generateBitmapImage(img, height, width, path) != 0) {
+			return EXIT_FAILURE;
+		}
+		trace_event("generateBitmapImage", write_start);
 		printf("--> Image %s is created.\n", path);
 	}
 
+	if (trace_path != NULL) {
+		if (trace_write(trace_path) != 0) {
+			return EXIT_FAILURE;
+		}
+		printf("--> Trace %s is created.\n", trace_path);
+	}
+
+	if (use_counters) {
+		counters_close(&counters);
+	}
 	free(img);
 	free(args);
 	free(my_img);
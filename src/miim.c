@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include <math.h>
+
+#include "util.h"
+#include "miim.h"
+
+//point of the depth first traversal
+typedef struct {
+    float complex z;
+    unsigned depth; //inverse iterations from the fixed point
+} miim_point;
+
+/**
+ * @return repelling fixed point of z -> z^2 + c, the root of z^2 - z + c = 0 with |2z| > 1
+ */
+static float complex repelling_fixed_point(float complex c) {
+    float complex root = csqrtf(0.25f - c);
+    float complex z1 = 0.5f + root;
+    float complex z2 = 0.5f - root;
+    return (cabsf(z1) >= cabsf(z2)) ? z1 : z2;
+}
+
+int julia_miim_render(Arguments* args, Image* img, unsigned max_hits, MiimStats* stats) {
+    if (args->family != FAMILY_QUADRATIC) {
+        fprintf(stderr, "Inverse iteration is only supported for the quadratic family.\n");
+        return -1;
+    }
+    size_t width = img->width;
+    size_t height = img->height;
+    //every traversal step replaces one point with at most two, so the stack holds at most
+    //one waiting sibling per level
+    size_t capacity = 2 * (size_t) args->n + 2;
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    float complex c = args->c;
+
+    //coarse grid over the disk which contains the julia set and the image
+    float radius = 0.5f + sqrtf(0.25f + cabsf(c));
+    float grid_x0 = fminf(-radius, start_x);
+    float grid_y0 = fminf(-radius, start_y);
+    float grid_x1 = fmaxf(radius, start_x + width * args->res);
+    float grid_y1 = fmaxf(radius, start_y + height * args->res);
+    float cell = fmaxf(grid_x1 - grid_x0, grid_y1 - grid_y0) / MIIM_COARSE_CELLS;
+    size_t grid_width = (size_t) ceilf((grid_x1 - grid_x0) / cell) + 1;
+    size_t grid_height = (size_t) ceilf((grid_y1 - grid_y0) / cell) + 1;
+
+    unsigned char* hits = calloc(width * height, sizeof(unsigned char));
+    unsigned char* coarse_hits = calloc(grid_width * grid_height, sizeof(unsigned char));
+    miim_point* stack = malloc(capacity * sizeof(miim_point));
+    if (hits == NULL || coarse_hits == NULL || stack == NULL) {
+        fprintf(stderr, "Could not allocate memory for inverse iteration of an image sized %lu x %lu.\n",
+                                                                                            width, height);
+        free(hits);
+        free(coarse_hits);
+        free(stack);
+        return -1;
+    }
+
+    //background first, boundary pixels are plotted over it
+    Region region = full_region(img);
+    for (size_t y=region.y0; y<region.y1; y++) {
+        for (size_t x=region.x0; x<region.x1; x++) {
+            color_pixel(img, y, x, 1);
+        }
+    }
+
+    stats->points = 0;
+    stats->pixels = 0;
+
+    size_t top = 0;
+    stack[top++] = (miim_point) {repelling_fixed_point(c), 0};
+    while (top > 0) {
+        miim_point p = stack[--top];
+        if (p.depth >= args->n) {
+            continue;
+        }
+        float complex w = csqrtf(p.z - c);
+        float complex preimages[2] = {w, -w};
+        for (int i=0; i<2; i++) {
+            float complex z = preimages[i];
+            stats->points++;
+            //pixel (x, y) is computed by the kernels at start + (x + y i) * res
+            float fx = floorf((crealf(z) - start_x) / args->res + 0.5f);
+            float fy = floorf((cimagf(z) - start_y) / args->res + 0.5f);
+            miim_point next = {z, p.depth + 1};
+
+            if (fx < 0.0f || fy < 0.0f || fx >= (float) width || fy >= (float) height) {
+                //parts of the boundary outside of the image can have preimages inside of it,
+                //they are pruned by the hits of their coarse cell
+                float gx = floorf((crealf(z) - grid_x0) / cell);
+                float gy = floorf((cimagf(z) - grid_y0) / cell);
+                if (gx < 0.0f || gy < 0.0f || gx >= (float) grid_width || gy >= (float) grid_height) {
+                    continue;
+                }
+                unsigned char* h = &coarse_hits[(size_t) gy * grid_width + (size_t) gx];
+                if (*h < max_hits) {
+                    (*h)++;
+                    stack[top++] = next;
+                }
+                continue;
+            }
+            size_t x = (size_t) fx;
+            size_t y = (size_t) fy;
+            unsigned char* h = &hits[y * width + x];
+            if (*h >= max_hits) {
+                continue;
+            }
+            if (*h == 0) {
+                color_pixel(img, y, x, BLACK);
+                stats->pixels++;
+            }
+            (*h)++;
+            stack[top++] = next;
+        }
+    }
+
+    free(hits);
+    free(coarse_hits);
+    free(stack);
+    return 0;
+}
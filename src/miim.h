@@ -0,0 +1,39 @@
+#ifndef MY_MIIM
+#define MY_MIIM
+
+#include "util.h"
+
+//default number of times a pixel may be hit before its preimages are pruned
+#define MIIM_DEFAULT_HITS 4
+//cells along the longer side of the coarse grid which counts hits of preimages outside of the image
+#define MIIM_COARSE_CELLS 256
+
+//work done by a boundary render
+typedef struct {
+    unsigned long long points; //preimages computed
+    unsigned long long pixels; //boundary pixels plotted
+} MiimStats;
+
+/**
+ * @brief plot the boundary of the julia set with the modified inverse iteration method (MIIM).
+ * Starts at the repelling fixed point of z -> z^2 + c, which belongs to the julia set, and follows
+ * the preimages z -> +-sqrt(z - c) depth first. Every preimage inside the image is plotted and counts
+ * a hit of its pixel, preimages of pixels hit more than max_hits times are not followed, so the work
+ * grows with the number of boundary pixels instead of all pixels times n. Orbits are at most n deep.
+ * Preimages outside of the image count hits of a coarse grid of MIIM_COARSE_CELLS cells along the longer
+ * side of the disk |z| <= 1/2 + sqrt(1/4 + |c|), which contains the julia set, and the image, and are
+ * pruned the same way, so the work outside of the image is bounded by the cells of the grid.
+ * The boundary of a zoomed view is mostly reached through preimages outside of the image, whose cells
+ * are much larger than its pixels and are pruned early, so zoomed views are under-sampled and show gaps.
+ * Boundary pixels are colored like convergent pixels (BLACK), all other pixels like pixels which
+ * escape at once (1), into img->buffer or img->field.
+ * 
+ * @param args julia arguments, only the quadratic family is supported
+ * @param img image data
+ * @param max_hits hits of a pixel until it is pruned, 1 to 255
+ * @param stats work done is written here
+ * @return 0 on success, -1 if memory could not be allocated or the family is not supported
+ */
+int julia_miim_render(Arguments* args, Image* img, unsigned max_hits, MiimStats* stats);
+
+#endif
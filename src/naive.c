@@ -31,17 +31,17 @@ unsigned iterate_naive(float a, float b, Arguments* args) {
 
 /**
  * @brief iterates all the starting points in the complex plane.
- * for each point, computes the series and colors corresponding pixel
+ * for each point of the region, computes the series and colors corresponding pixel
  */
-static void enumerate(Arguments* args, Image* img) {
+static void enumerate(Arguments* args, Image* img, const Region* region) {
     float start_x = crealf(args->start);
     float start_y = cimagf(args->start); 
 
     //iterate all the points in the complex plane
-    for (size_t y=0; y<img->height; y++) {
+    for (size_t y=region->y0; y<region->y1; y++) {
         float im = start_y + y * args->res;  // imaginary value
 
-        for (size_t x=0; x<img->width; x++) { 
+        for (size_t x=region->x0; x<region->x1; x++) { 
             float re = start_x + x * args->res;  //real value
             
             unsigned iterations = iterate_naive(re, im, args);
@@ -50,12 +50,17 @@ static void enumerate(Arguments* args, Image* img) {
     }
 }
 
+void julia_V2_render(Arguments* args, Image* img, const Region* region) {
+    enumerate(args, img, region);
+}
+
 void julia_V2(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img) {
-    Arguments* args = get_args(c, start, res, n);
-    Image* my_img = get_img(width, height, img, n);
+    Arguments args;
+    Image my_img;
+    init_args(&args, c, start, res, n);
+    init_img(&my_img, width, height, img, n);
 
-    enumerate(args, my_img);
+    Region region = full_region(&my_img);
 
-    free(args);
-    free(my_img);
+    julia_V2_render(&args, &my_img, &region);
 }
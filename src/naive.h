@@ -1,4 +1,7 @@
 
+#ifndef MY_NAIVE
+#define MY_NAIVE
+
 #include "util.h"
 
 /**
@@ -26,3 +29,16 @@ unsigned iterate_naive(float a, float b, Arguments* args);
  * @param img image buffer
  */
 void julia_V2(float complex c, float complex start, size_t width, size_t height, float res, unsigned n, unsigned char* img);
+
+
+/**
+ * @brief render the given region of the image described by args and img with the naive implementation.
+ * Does not allocate any memory.
+ * 
+ * @param args julia arguments
+ * @param img image data
+ * @param region pixels to compute
+ */
+void julia_V2_render(Arguments* args, Image* img, const Region* region);
+
+#endif
@@ -3,30 +3,35 @@
 #include <stdio.h>
 #include <float.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "intrin_v0.h"
 #include "intrin_v1.h"
 #include "naive.h"
+#include "bmp.h"
 #include "util.h"
+#include "plan.h"
+#include "render.h"
+#include "performanz.h"
 
-const char* names[] = {"Optimized", "Less Optimized", "Naive"};
-
-double measure(int implementation, long int repetitions, Arguments* args, Image* img, bool print) {
-    void (*julia_impl)(float complex, float complex, size_t, size_t, float, unsigned, unsigned char*);
-
-    switch (implementation) {
-        case INTRIN_V0:
-            julia_impl = julia; //select optimized implementation
-            break;
-        case INTRIN_V1:
-            julia_impl = julia_V1; //select less optimized implementation
-            break;
-        case NAIVE:
-            julia_impl = julia_V2; //select naive implementation
-            break;
-        default:
-            fprintf(stderr, "Invalid argument. There is no implementation with id %d\n", implementation);
-            exit(EXIT_FAILURE);
+const char* names[] = {"Optimized", "Less Optimized", "Naive", "Optimized FMA", "Optimized AVX2 FMA", "Interleaved", "Deferred Bailout", "Morton 2x2"};
+
+//number of implementations in names[] table
+#define KERNEL_COUNT ((int) (sizeof(names) / sizeof(names[0])))
+const int kernel_count = KERNEL_COUNT;
+
+double measure(int implementation, long int repetitions, Arguments* args, Image* img, bool print, Counters* counters) {
+    JuliaParams params;
+    plan_params(&params, implementation, args, img->width, img->height);
+
+    //constants and scratch memory are prepared once, only julia_plan_execute is timed
+    JuliaPlan* plan = julia_plan_create(&params);
+    if (plan == NULL) {
+        exit(EXIT_FAILURE);
     }
 
     if (print) {
@@ -39,24 +44,91 @@ double measure(int implementation, long int repetitions, Arguments* args, Image*
                             args->n, img->width, img->height);
     }
 
+    //every kernel call is wrapped with hardware counters if requested
+    CounterSample sample;
+    counters_reset(&sample);
+
     struct timespec start;
     struct timespec end;
     clock_gettime(CLOCK_MONOTONIC, &start);
 
     for (int i=0; i<repetitions; i++) {
-        julia_impl(args->c, args->start, img->width, img->height, args->res, args->n, img->buffer);
+        if (counters != NULL) {
+            counters_start(counters, &sample);
+            julia_plan_execute(plan, img->buffer);
+            counters_stop(counters, &sample);
+        } else {
+            julia_plan_execute(plan, img->buffer);
+        }
     }
 
     clock_gettime(CLOCK_MONOTONIC, &end);
+    julia_plan_destroy(plan);
     double t = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
     double average = t/repetitions;
 
     if (print) {
         printf("\n==========> Completed: Average = %f seconds\n", average);
     }
+    if (print && counters != NULL) {
+        printf("\nCounters per kernel call:\n");
+        counters_print(counters, "kernel", &sample, img->width * img->height);
+    }
     return average;
 }
 
+int measure_phases(int implementation, Arguments* args, Image* img, char* path, Counters* counters) {
+    JuliaParams params;
+    plan_params(&params, implementation, args, img->width, img->height);
+    JuliaPlan* plan = julia_plan_create(&params);
+    //16-bit iteration numbers if n allows it, halves the memory traffic of both phases
+    bool narrow = field16_fits(args->n);
+    size_t entry = narrow ? sizeof(uint16_t) : sizeof(unsigned);
+    void* field = malloc(img->width * img->height * entry);
+    if (plan == NULL || field == NULL) {
+        fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", img->width, img->height);
+        exit(EXIT_FAILURE);
+    }
+
+    CounterSample iterate;
+    CounterSample color;
+    CounterSample write;
+    counters_reset(&iterate);
+    counters_reset(&color);
+    counters_reset(&write);
+
+    //compute iteration numbers first, then color them, so that both phases can be counted on their own
+    counters_start(counters, &iterate);
+    if (narrow) {
+        julia_plan_execute_field16(plan, field);
+    } else {
+        julia_plan_execute_field(plan, field);
+    }
+    counters_stop(counters, &iterate);
+
+    counters_start(counters, &color);
+    if (narrow) {
+        color_field16(img, field);
+    } else {
+        color_field(img, field);
+    }
+    counters_stop(counters, &color);
+
+    counters_start(counters, &write);
+    int status = generateBitmapImage(img->buffer, img->height, img->width, path);
+    counters_stop(counters, &write);
+
+    printf("%s implementation render phases (%d-bit iteration field):\n", names[implementation], narrow ? 16 : 32);
+    size_t pixels = img->width * img->height;
+    counters_print(counters, "iterate", &iterate, pixels);
+    counters_print(counters, "color", &color, pixels);
+    counters_print(counters, "write", &write, pixels);
+
+    julia_plan_destroy(plan);
+    free(field);
+    return status;
+}
+
 void performance_comparison() {
     //these parameters do not change during entire test
     unsigned n = 500;
@@ -70,11 +142,15 @@ void performance_comparison() {
            "Function calls are repeated multiple times for every c value.\n"
            "Average time for a function call is printed.\n\n");
     
-    printf("Do you want to run detailed performance comparison test? [y/n] ");
-    char response = getchar();
-    if (response != 'y' && response != 'Y') {
-        printf("Abort.\n");
-        return;
+    //only ask for confirmation when somebody is sitting in front of the terminal,
+    //so that the test can run unattended (e.g. with input redirected from /dev/null)
+    if (isatty(STDIN_FILENO)) {
+        printf("Do you want to run detailed performance comparison test? [y/n] ");
+        char response = getchar();
+        if (response != 'y' && response != 'Y') {
+            printf("Abort.\n");
+            return;
+        }
     }
 
     Arguments* args;
@@ -112,9 +188,9 @@ void performance_comparison() {
             args = get_args(c_values[c], start, 3.0f/size, n);
             img = get_img(size, size, buffer, n);
             
-            intrin0_total += measure(INTRIN_V0, repetitions, args, img, false);
-            intrin1_total += measure(INTRIN_V1, repetitions, args, img, false);
-            naive_total += measure(NAIVE, repetitions, args, img, false);
+            intrin0_total += measure(INTRIN_V0, repetitions, args, img, false, NULL);
+            intrin1_total += measure(INTRIN_V1, repetitions, args, img, false, NULL);
+            naive_total += measure(NAIVE, repetitions, args, img, false, NULL);
 
             free(args);
             free(img);
@@ -137,3 +213,244 @@ void performance_comparison() {
     }
 }
 
+
+/**
+ * @return seconds elapsed between start and end
+ */
+static double elapsed(struct timespec* start, struct timespec* end) {
+    return end->tv_sec - start->tv_sec + 1e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+unsigned long long count_iterations(const unsigned* field, size_t pixels, unsigned n) {
+    unsigned long long total = 0;
+    for (size_t i=0; i<pixels; i++) {
+        //convergent pixels run until maximum number of iterations
+        total += (field[i] == BLACK) ? n : field[i];
+    }
+    return total;
+}
+
+void benchmark(int implementation, Arguments* args, Image* img, long warmup, long repetitions, char* path,
+                BenchResult* result) {
+    JuliaParams params;
+    plan_params(&params, implementation, args, img->width, img->height);
+    JuliaPlan* plan = julia_plan_create(&params);
+    double* times = malloc(sizeof(double) * repetitions);
+    if (plan == NULL || times == NULL) {
+        fprintf(stderr, "Could not allocate memory for benchmark.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (long i=0; i<warmup; i++) {
+        julia_plan_execute(plan, img->buffer);
+        if (path != NULL && generateBitmapImage(img->buffer, img->height, img->width, path) != 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //every execution is timed on its own, so that we get the distribution of running times
+    for (long i=0; i<repetitions; i++) {
+        struct timespec start;
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        julia_plan_execute(plan, img->buffer);
+        if (path != NULL && generateBitmapImage(img->buffer, img->height, img->width, path) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        times[i] = elapsed(&start, &end);
+    }
+    julia_plan_destroy(plan);
+
+    double sum = 0.0;
+    for (long i=0; i<repetitions; i++) {
+        sum += times[i];
+    }
+    result->mean = sum / repetitions;
+
+    double squares = 0.0;
+    for (long i=0; i<repetitions; i++) {
+        squares += (times[i] - result->mean) * (times[i] - result->mean);
+    }
+    result->stddev = (repetitions > 1) ? sqrt(squares / (repetitions - 1)) : 0.0;
+
+    qsort(times, repetitions, sizeof(double), compare_doubles);
+    result->min = times[0];
+    result->median = (repetitions % 2 == 1) ? times[repetitions / 2]
+                                            : (times[repetitions / 2 - 1] + times[repetitions / 2]) / 2;
+    //nearest-rank percentile
+    long rank = (long) ceil(0.95 * repetitions);
+    result->p95 = times[rank - 1];
+    result->repetitions = repetitions;
+    free(times);
+}
+
+/**
+ * @brief print one benchmark result as csv row or json object
+ */
+static void print_result(FILE* out, int format, bool first, int implementation, Arguments* args, Image* img,
+                        unsigned long long iterations, BenchResult* r) {
+    double giter = iterations / r->median * 1e-9;
+
+    if (format == BENCH_CSV) {
+        fprintf(out, "%d,%s,%lu,%lu,%.6f,%.6f,%u,%ld,%.9f,%.9f,%.9f,%.9f,%.9f,%llu,%.6f\n",
+                implementation, names[implementation], img->width, img->height, crealf(args->c), cimagf(args->c),
+                args->n, r->repetitions, r->median, r->p95, r->mean, r->stddev, r->min, iterations, giter);
+    } else {
+        fprintf(out, "%s  {\"version\": %d, \"kernel\": \"%s\", \"width\": %lu, \"height\": %lu, "
+                "\"c_re\": %.6f, \"c_im\": %.6f, \"n\": %u, \"repetitions\": %ld, "
+                "\"median_s\": %.9f, \"p95_s\": %.9f, \"mean_s\": %.9f, \"stddev_s\": %.9f, \"min_s\": %.9f, "
+                "\"iterations\": %llu, \"giter_per_s\": %.6f}",
+                first ? "" : ",\n", implementation, names[implementation], img->width, img->height,
+                crealf(args->c), cimagf(args->c), args->n, r->repetitions, r->median, r->p95, r->mean, r->stddev,
+                r->min, iterations, giter);
+    }
+}
+
+void benchmark_suite(BenchConfig* config, FILE* out) {
+    float complex start = -1.5 + -1.5 * I;
+
+    if (config->format == BENCH_CSV) {
+        fprintf(out, "version,kernel,width,height,c_re,c_im,n,repetitions,median_s,p95_s,mean_s,stddev_s,min_s,"
+                     "iterations,giter_per_s\n");
+    } else {
+        fprintf(out, "{\"results\": [\n");
+    }
+
+    bool first = true;
+    for (int s=0; s<config->sizes; s++) {
+        size_t size = image_sizes[s];
+        unsigned char* buffer = malloc(size * size * 3);
+        unsigned* field = malloc(size * size * sizeof(unsigned));
+        if (buffer == NULL || field == NULL) {
+            fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", size, size);
+            exit(EXIT_FAILURE);
+        }
+
+        for (int c=0; c<10; c++) {
+            //we need to adjust resolution according to image size to get a view of complete julia set
+            Arguments args;
+            Image img;
+            init_args(&args, c_values[c], start, 3.0f/size, config->n);
+            init_img(&img, size, size, buffer, config->n);
+
+            for (int k=0; k<KERNEL_COUNT; k++) {
+                if (!julia_implementation_supported(k)) {
+                    continue;
+                }
+                fprintf(stderr, "Benchmark %lu x %lu, c %d/10, %s ...\n", size, size, c+1, names[k]);
+
+                //iterations of this kernel, untimed. fma kernels round differently and iterate
+                //some pixels a different number of times
+                JuliaParams params;
+                plan_params(&params, k, &args, size, size);
+                JuliaPlan* plan = julia_plan_create(&params);
+                if (plan == NULL) {
+                    exit(EXIT_FAILURE);
+                }
+                julia_plan_execute_field(plan, field);
+                julia_plan_destroy(plan);
+                unsigned long long iterations = count_iterations(field, size * size, args.n);
+
+                BenchResult result;
+                benchmark(k, &args, &img, config->warmup, config->repetitions, NULL, &result);
+                print_result(out, config->format, first, k, &args, &img, iterations, &result);
+                first = false;
+                fflush(out);
+            }
+        }
+        free(buffer);
+        free(field);
+    }
+
+    if (config->format == BENCH_JSON) {
+        fprintf(out, "\n]}\n");
+    }
+}
+
+/**
+ * @brief render into a fresh buffer which is not touched yet, with the touch of the naive or placed way
+ *
+ * @return seconds of touching and rendering
+ */
+static double numa_run(JuliaPlan* plan, size_t bytes, int threads, size_t band_height, const Placement* placement,
+                                                                                    PlacementStats* stats) {
+    //mmap instead of malloc, which may hand out memory touched by an earlier run
+    unsigned char* buffer = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        fprintf(stderr, "Could not allocate memory for the numa benchmark.\n");
+        exit(EXIT_FAILURE);
+    }
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!placement->local) {
+        memset(buffer, 0, bytes);
+    }
+    if (render_parallel_placed(plan, buffer, NULL, NULL, threads, band_height, placement, stats) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    munmap(buffer, bytes);
+    return elapsed(&start, &end);
+}
+
+void numa_benchmark(const Placement* placement, int threads, size_t band_height, unsigned n) {
+    float complex start = -1.5 + -1.5 * I;
+    size_t size = image_sizes[NUMA_BENCH_SIZE];
+    Placement naive = *placement;
+    naive.affinity = AFFINITY_NONE;
+    naive.local = false;
+    Placement placed = *placement;
+    placed.local = true;
+
+    placement_print(&placed);
+    printf("Image %lu x %lu, n = %u, %d threads, bands of %lu rows, fastest of %d runs:\n", size, size, n, threads,
+                                                                    band_height, NUMA_BENCH_REPETITIONS);
+    printf("%-18s %10s %8s %10s %8s %8s %8s\n", "c", "naive s", "remote", "placed s", "remote", "stolen",
+                                                                                                    "speedup");
+    double naive_total = 0.0;
+    double placed_total = 0.0;
+    for (int c=0; c<10; c++) {
+        Arguments args;
+        init_args(&args, c_values[c], start, 3.0f/size, n);
+        JuliaParams params;
+        plan_params(&params, INTRIN_V0, &args, size, size);
+        JuliaPlan* plan = julia_plan_create(&params);
+        if (plan == NULL) {
+            exit(EXIT_FAILURE);
+        }
+
+        //alternate both ways, so that noise of the machine hits both alike
+        double naive_best = DBL_MAX;
+        double placed_best = DBL_MAX;
+        PlacementStats naive_stats;
+        PlacementStats placed_stats;
+        for (int r=0; r<NUMA_BENCH_REPETITIONS; r++) {
+            double t = numa_run(plan, size * size * 3, threads, band_height, &naive, &naive_stats);
+            naive_best = (t < naive_best) ? t : naive_best;
+            t = numa_run(plan, size * size * 3, threads, band_height, &placed, &placed_stats);
+            placed_best = (t < placed_best) ? t : placed_best;
+        }
+        julia_plan_destroy(plan);
+        naive_total += naive_best;
+        placed_total += placed_best;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%.3f %+.3f i", crealf(c_values[c]), cimagf(c_values[c]));
+        printf("%-18s %10f %7.1f%% %10f %7.1f%% %7.1f%% %8.3f\n", name, naive_best,
+                        naive_stats.remote_bands * 100.0 / naive_stats.bands, placed_best,
+                        placed_stats.remote_bands * 100.0 / placed_stats.bands,
+                        placed_stats.stolen_bands * 100.0 / placed_stats.bands, naive_best / placed_best);
+        if (placed_stats.pin_failures > 0) {
+            printf("    %d workers could not be pinned\n", placed_stats.pin_failures);
+        }
+    }
+    printf("Total: naive %f s, placed %f s, speedup %.3f\n", naive_total, placed_total, naive_total / placed_total);
+}
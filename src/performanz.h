@@ -1,4 +1,41 @@
+#ifndef MY_PERFORMANZ
+#define MY_PERFORMANZ
+
+#include <stdio.h>
 #include "util.h"
+#include "counters.h"
+#include "placement.h"
+
+//image size (index into image_sizes[]) and timed runs per c value of numa_benchmark
+#define NUMA_BENCH_SIZE 1
+#define NUMA_BENCH_REPETITIONS 3
+
+//output formats of the benchmark harness
+#define BENCH_CSV 0
+#define BENCH_JSON 1
+
+//names of implementations, indexed by version
+extern const char* names[];
+extern const int kernel_count;
+
+//settings of the benchmark harness
+typedef struct {
+    long warmup; //untimed executions before measuring
+    long repetitions; //timed executions per kernel and scenario
+    int sizes; //use first 'sizes' entries of image_sizes[]
+    unsigned n; //maximum number of iterations
+    int format; //BENCH_CSV or BENCH_JSON
+} BenchConfig;
+
+//statistics of the running times of one kernel in one scenario (seconds per call)
+typedef struct {
+    long repetitions;
+    double median;
+    double p95;
+    double mean;
+    double stddev;
+    double min;
+} BenchResult;
 
 /**
  * @brief run given implementation with given arguments and return average 
@@ -9,12 +46,83 @@
  * @param args arguments for julia function call
  * @param img image info
  * @param print print info if set to true
+ * @param counters if not NULL, hardware counters are read around every call and printed
  * @return average running time of function 
  */
-double measure(int implementation, long int repetitions, Arguments* args, Image* img, bool print);
+double measure(int implementation, long int repetitions, Arguments* args, Image* img, bool print, Counters* counters);
+
+/**
+ * @brief render an image in three separate phases (iterate, color, write) and print
+ * wall time and hardware counters of each phase, per call and per pixel.
+ * 
+ * @param implementation version of julia algorithm
+ * @param args arguments for julia function call
+ * @param img image info, rgb values are written into img->buffer
+ * @param path bmp file to write
+ * @param counters opened hardware counters, only time is printed if they are not available
+ * @return 0 on success, -1 if image could not be written
+ */
+int measure_phases(int implementation, Arguments* args, Image* img, char* path, Counters* counters);
 
 /**
  * @brief Compare performances and scaling of naive, 
  * optimized and less optimized implementations with various fixed parameters
  */
 void performance_comparison();
+
+
+/**
+ * @brief number of iterations of z -> z^2 + c computed for a whole image.
+ * A pixel with iteration number k needed k iterations, convergent pixels (BLACK) needed n.
+ * 
+ * @param field iteration numbers, computed by julia_plan_execute_field
+ * @param pixels number of entries in field
+ * @param n maximum number of iterations
+ * @return total number of iterations
+ */
+unsigned long long count_iterations(const unsigned* field, size_t pixels, unsigned n);
+
+/**
+ * @brief time single executions of given implementation after some warm-up executions
+ * and compute statistics of the running times. Only julia_plan_execute is timed,
+ * and writing the image file if path is given.
+ * 
+ * @param implementation version of julia algorithm
+ * @param args arguments for julia function call
+ * @param img image info
+ * @param warmup number of untimed executions
+ * @param repetitions number of timed executions, at least 1
+ * @param path if not NULL, every execution also writes the image into this bmp file
+ * @param result statistics are written here
+ */
+void benchmark(int implementation, Arguments* args, Image* img, long warmup, long repetitions, char* path,
+                BenchResult* result);
+
+/**
+ * @brief non-interactive benchmark of every implementation in names[] with every c value in c_values[]
+ * and the first config->sizes image sizes in image_sizes[].
+ * Writes one csv row or json object per run into out. Key metric is giter_per_s,
+ * total number of iterations divided by median running time. The iterations are counted from a
+ * field computed by the same implementation.
+ * 
+ * @param config benchmark settings
+ * @param out results are written here
+ */
+void benchmark_suite(BenchConfig* config, FILE* out);
+
+/**
+ * @brief compare NUMA-aware placement with naive placement for every c value of c_values[] at
+ * image_sizes[NUMA_BENCH_SIZE]. Naive: a fresh buffer is written by the calling thread first (as the
+ * buffer of main.c is) and rendered by unpinned workers from one queue of bands. Placed: a fresh
+ * buffer is first touched by the workers of every node and rendered with render_parallel_placed.
+ * Both times include touching the buffer. The fastest of NUMA_BENCH_REPETITIONS runs and the share
+ * of bands rendered on a remote node are printed; the latter is also meaningful with simulated nodes.
+ *
+ * @param placement nodes and affinity of the placed runs
+ * @param threads number of worker threads
+ * @param band_height rows per band
+ * @param n maximum number of iterations
+ */
+void numa_benchmark(const Placement* placement, int threads, size_t band_height, unsigned n);
+
+#endif
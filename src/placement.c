@@ -0,0 +1,215 @@
+//cpu_set_t and pthread_setaffinity_np
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "placement.h"
+
+struct AffinityMask {
+    cpu_set_t set;
+};
+
+int parse_cpu_list(const char* text, int* cpus, int max) {
+    int count = 0;
+    const char* p = text;
+    while (*p != '\0' && *p != '\n') {
+        char* end;
+        errno = 0;
+        long first = strtol(p, &end, 10);
+        if (errno != 0 || end == p || first < 0 || first >= CPU_SETSIZE) {
+            return -1;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (errno != 0 || end == p || last < first || last >= CPU_SETSIZE) {
+                return -1;
+            }
+        }
+        for (long cpu=first; cpu<=last; cpu++) {
+            if (count == max) {
+                return -1;
+            }
+            cpus[count++] = cpu;
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0' && *end != '\n') {
+            return -1;
+        }
+        p = end;
+    }
+    return count;
+}
+
+int topology_read(Topology* topology) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        fprintf(stderr, "Could not read the processors of this process.\n");
+        return -1;
+    }
+
+    topology->nodes = 0;
+    topology->cpu_count = 0;
+    topology->simulated = false;
+    int cpus[PLACEMENT_MAX_CPUS];
+    for (int n=0; n<PLACEMENT_MAX_NODES; n++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        char line[4096];
+        int count = (fgets(line, sizeof(line), file) != NULL) ? parse_cpu_list(line, cpus, PLACEMENT_MAX_CPUS) : -1;
+        fclose(file);
+
+        //nodes without processors of this process (memory only, other cpuset) are left out
+        bool used = false;
+        for (int i=0; i<count && topology->cpu_count < PLACEMENT_MAX_CPUS; i++) {
+            if (CPU_ISSET(cpus[i], &allowed)) {
+                topology->cpus[topology->cpu_count] = cpus[i];
+                topology->node[topology->cpu_count] = topology->nodes;
+                topology->cpu_count++;
+                used = true;
+            }
+        }
+        topology->nodes += used;
+    }
+
+    if (topology->cpu_count == 0) {
+        //no NUMA information, e.g. a kernel without CONFIG_NUMA
+        topology->nodes = 1;
+        for (int cpu=0; cpu<CPU_SETSIZE && topology->cpu_count < PLACEMENT_MAX_CPUS; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                topology->cpus[topology->cpu_count] = cpu;
+                topology->node[topology->cpu_count] = 0;
+                topology->cpu_count++;
+            }
+        }
+    }
+    return (topology->cpu_count > 0) ? 0 : -1;
+}
+
+void topology_simulate(Topology* topology, int nodes) {
+    if (topology->cpu_count < nodes) {
+        //every node gets one processor, shared round robin
+        for (int i=topology->cpu_count; i<nodes; i++) {
+            topology->cpus[i] = topology->cpus[i % topology->cpu_count];
+        }
+        topology->cpu_count = nodes;
+    }
+    for (int i=0; i<topology->cpu_count; i++) {
+        topology->node[i] = i * nodes / topology->cpu_count;
+    }
+    topology->nodes = nodes;
+    topology->simulated = true;
+}
+
+int placement_parse_affinity(Placement* placement, const char* text) {
+    if (strcmp(text, "none") == 0) {
+        placement->affinity = AFFINITY_NONE;
+    } else if (strcmp(text, "compact") == 0) {
+        placement->affinity = AFFINITY_COMPACT;
+    } else if (strcmp(text, "scatter") == 0) {
+        placement->affinity = AFFINITY_SCATTER;
+    } else {
+        placement->list_count = parse_cpu_list(text, placement->list, PLACEMENT_MAX_CPUS);
+        if (placement->list_count <= 0) {
+            return -1;
+        }
+        placement->affinity = AFFINITY_LIST;
+    }
+    return 0;
+}
+
+/**
+ * @return node of a processor in topology, 0 if it is not part of it
+ */
+static int node_of_cpu(const Topology* topology, int cpu) {
+    for (int i=0; i<topology->cpu_count; i++) {
+        if (topology->cpus[i] == cpu) {
+            return topology->node[i];
+        }
+    }
+    return 0;
+}
+
+void placement_worker(const Placement* placement, int worker, int* cpu, int* node) {
+    const Topology* topology = &placement->topology;
+    switch (placement->affinity) {
+        case AFFINITY_COMPACT: {
+            int i = worker % topology->cpu_count;
+            *cpu = topology->cpus[i];
+            *node = topology->node[i];
+            return;
+        }
+        case AFFINITY_SCATTER: {
+            //the (worker / nodes)-th processor of node worker % nodes, cpus are sorted by node
+            int k = worker % topology->nodes;
+            int first = 0;
+            while (topology->node[first] != k) {
+                first++;
+            }
+            int count = 0;
+            while (first + count < topology->cpu_count && topology->node[first + count] == k) {
+                count++;
+            }
+            *cpu = topology->cpus[first + (worker / topology->nodes) % count];
+            *node = k;
+            return;
+        }
+        case AFFINITY_LIST:
+            *cpu = placement->list[worker % placement->list_count];
+            *node = node_of_cpu(topology, *cpu);
+            return;
+    }
+    *cpu = -1;
+    *node = worker % topology->nodes;
+}
+
+int pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) ? 0 : -1;
+}
+
+AffinityMask* affinity_save(void) {
+    AffinityMask* mask = malloc(sizeof(AffinityMask));
+    if (mask != NULL && pthread_getaffinity_np(pthread_self(), sizeof(mask->set), &mask->set) != 0) {
+        free(mask);
+        return NULL;
+    }
+    return mask;
+}
+
+void affinity_restore(AffinityMask* mask) {
+    if (mask == NULL) {
+        return;
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(mask->set), &mask->set);
+    free(mask);
+}
+
+void placement_print(const Placement* placement) {
+    static const char* affinities[] = {"none", "compact", "scatter", "list"};
+    const Topology* topology = &placement->topology;
+    printf("Placement: %d %snodes, affinity %s, %s\n", topology->nodes, topology->simulated ? "simulated " : "",
+                    affinities[placement->affinity], placement->local ? "first touch and node-local bands"
+                                                                    : "one shared queue of bands");
+    for (int k=0; k<topology->nodes; k++) {
+        printf("    node %d: processors", k);
+        for (int i=0; i<topology->cpu_count; i++) {
+            if (topology->node[i] == k) {
+                printf(" %d", topology->cpus[i]);
+            }
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef MY_PLACEMENT
+#define MY_PLACEMENT
+
+#include <stdbool.h>
+
+//largest number of processors and NUMA nodes of a topology
+#define PLACEMENT_MAX_CPUS 1024
+#define PLACEMENT_MAX_NODES 64
+
+//how workers are pinned to processors
+enum {
+    AFFINITY_NONE, //not pinned, the scheduler of the operating system decides
+    AFFINITY_COMPACT, //worker t on the t-th processor in node order, fills one node after the other
+    AFFINITY_SCATTER, //worker t on node t % nodes, spreads the workers over all nodes
+    AFFINITY_LIST, //worker t on the t-th processor of a given list
+};
+
+//processors of the machine grouped by NUMA node
+typedef struct {
+    int nodes;
+    int cpu_count;
+    int cpus[PLACEMENT_MAX_CPUS]; //processor numbers, sorted by node
+    int node[PLACEMENT_MAX_CPUS]; //node of every entry of cpus, 0 to nodes - 1
+    bool simulated; //nodes are made up by topology_simulate
+} Topology;
+
+//where the workers of a parallel render run and who touches the image memory first
+typedef struct {
+    Topology topology;
+    int affinity; //AFFINITY_*
+    int list[PLACEMENT_MAX_CPUS]; //processors of AFFINITY_LIST
+    int list_count;
+    //true: every node's workers first-touch the rows of their node and take bands of their node first.
+    //false: one queue of bands for all workers, memory belongs to the node of the calling thread
+    bool local;
+} Placement;
+
+//opaque copy of the affinity of a thread
+typedef struct AffinityMask AffinityMask;
+
+/**
+ * @brief read the NUMA nodes of the processors this process may run on from
+ * /sys/devices/system/node. Without NUMA information all processors form one node.
+ *
+ * @param topology topology is written here
+ * @return 0 on success, -1 if the processors could not be determined
+ */
+int topology_read(Topology* topology);
+
+/**
+ * @brief split the processors of a topology into nodes equal parts to test NUMA placement on a
+ * single node machine. If there are fewer processors than nodes, processors are shared by nodes.
+ *
+ * @param topology topology read by topology_read, changed in place
+ * @param nodes number of simulated nodes, 1 to PLACEMENT_MAX_NODES
+ */
+void topology_simulate(Topology* topology, int nodes);
+
+/**
+ * @brief parse a processor list like 0-3,8,10-11 as in /sys/devices/system/node/node0/cpulist
+ *
+ * @param text processor list
+ * @param cpus processor numbers are written here
+ * @param max size of cpus
+ * @return number of processors, -1 if the list is invalid or too long
+ */
+int parse_cpu_list(const char* text, int* cpus, int max);
+
+/**
+ * @brief set the affinity of a placement from none, compact, scatter or a processor list
+ *
+ * @return 0 on success, -1 if text is invalid
+ */
+int placement_parse_affinity(Placement* placement, const char* text);
+
+/**
+ * @brief processor and node of a worker of a parallel render
+ *
+ * @param placement placement of the render
+ * @param worker index of the worker, 0 is the calling thread
+ * @param cpu processor of the worker, -1 if it is not pinned
+ * @param node node of the worker, for AFFINITY_NONE the node it is counted for
+ */
+void placement_worker(const Placement* placement, int worker, int* cpu, int* node);
+
+/**
+ * @brief pin the calling thread to one processor
+ *
+ * @return 0 on success, -1 if the processor is not available
+ */
+int pin_thread(int cpu);
+
+/**
+ * @return affinity of the calling thread, to be restored with affinity_restore, NULL if it could not be read
+ */
+AffinityMask* affinity_save(void);
+
+/**
+ * @brief restore the affinity of the calling thread and free mask, nothing happens for NULL
+ */
+void affinity_restore(AffinityMask* mask);
+
+/**
+ * @brief print nodes and processors of a placement
+ */
+void placement_print(const Placement* placement);
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+
+#include "julia.h"
+#include "util.h"
+#include "naive.h"
+#include "intrin_v0.h"
+#include "intrin_v1.h"
+#include "intrin_fma.h"
+#include "intrin_interleaved.h"
+#include "intrin_deferred.h"
+#include "intrin_morton.h"
+#include "intrin_family.h"
+#include "plan.h"
+
+int julia_implementation_supported(int implementation) {
+    switch (implementation) {
+        case INTRIN_V0:
+        case INTRIN_V1:
+        case NAIVE:
+        case INTRIN_INTERLEAVED:
+        case INTRIN_DEFERRED:
+        case INTRIN_MORTON:
+            return 1;
+        case INTRIN_FMA:
+            return __builtin_cpu_supports("fma");
+        case INTRIN_AVX2_FMA:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+    return 0;
+}
+
+bool implementation_uses_fma(int implementation) {
+    return implementation == INTRIN_FMA || implementation == INTRIN_AVX2_FMA;
+}
+
+bool implementation_supports_family(int implementation, int family) {
+    //other families have one specialised kernel each, selected by the optimized implementation
+    return family == FAMILY_QUADRATIC || implementation == INTRIN_V0;
+}
+
+void plan_params(JuliaParams* params, int implementation, Arguments* args, size_t width, size_t height) {
+    *params = (JuliaParams) {implementation, args->c, args->start, width, height, args->res, args->n,
+                                                                args->family, args->degree, args->bailout};
+}
+
+JuliaPlan* julia_plan_create(const JuliaParams* params) {
+    if (params->implementation < INTRIN_V0 || params->implementation > INTRIN_MORTON) {
+        fprintf(stderr, "Invalid argument. There is no implementation with id %d\n", params->implementation);
+        return NULL;
+    }
+    if (!julia_implementation_supported(params->implementation)) {
+        fprintf(stderr, "Implementation %d is not supported by this processor.\n", params->implementation);
+        return NULL;
+    }
+
+    if (!implementation_supports_family(params->implementation, params->family)) {
+        fprintf(stderr, "Implementation %d does not support iteration family %d.\n",
+                                                        params->implementation, params->family);
+        return NULL;
+    }
+
+    //plan holds sse registers, so it needs 16-byte aligned memory.
+    //aligned_alloc wants the size to be a multiple of the alignment.
+    size_t size = (sizeof(JuliaPlan) + 15) & ~(size_t)0x0F;
+    JuliaPlan* plan = aligned_alloc(16, size);
+    if (plan == NULL) {
+        fprintf(stderr, "Could not allocate memory for julia plan.\n");
+        return NULL;
+    }
+
+    plan->params = *params;
+    init_args(&plan->args, params->c, params->start, params->res, params->n);
+    if (init_family(&plan->args, params->family, params->degree, params->bailout) != 0) {
+        free(plan);
+        return NULL;
+    }
+    init_img(&plan->img, params->width, params->height, NULL, params->n);
+    init_xmm_helpers(&plan->helpers, &plan->args);
+    return plan;
+}
+
+void plan_render_region(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch) {
+    switch (plan->params.implementation) {
+        case INTRIN_V0:
+            if (plan->args.family != FAMILY_QUADRATIC) {
+                julia_family_render(&plan->args, img, &plan->helpers, region);
+            }
+            else {
+                julia_render(&plan->args, img, &plan->helpers, region);
+            }
+            break;
+        case INTRIN_V1:
+            julia_V1_render(&plan->args, img, &plan->helpers, &scratch->nums, &scratch->xmms, region);
+            break;
+        case NAIVE:
+            julia_V2_render(&plan->args, img, region);
+            break;
+        case INTRIN_FMA:
+            julia_fma_render(&plan->args, img, &plan->helpers, region);
+            break;
+        case INTRIN_AVX2_FMA:
+            julia_avx2_fma_render(&plan->args, img, &plan->helpers, region);
+            break;
+        case INTRIN_INTERLEAVED:
+            julia_interleaved_render(&plan->args, img, &plan->helpers, region);
+            break;
+        case INTRIN_DEFERRED:
+            julia_deferred_render(&plan->args, img, &plan->helpers, region);
+            break;
+        case INTRIN_MORTON:
+            julia_morton_render(&plan->args, img, &plan->helpers, region);
+            break;
+    }
+}
+
+/**
+ * @brief run the selected implementation on the complete image currently set in the plan
+ */
+static void execute(JuliaPlan* plan) {
+    Region region = full_region(&plan->img);
+    plan_render_region(plan, &plan->img, &region, &plan->scratch);
+}
+
+void julia_plan_execute(JuliaPlan* plan, unsigned char* buffer) {
+    plan->img.buffer = buffer;
+    plan->img.field = NULL;
+    plan->img.field16 = NULL;
+    execute(plan);
+}
+
+void julia_plan_execute_field(JuliaPlan* plan, unsigned* field) {
+    plan->img.buffer = NULL;
+    plan->img.field = field;
+    plan->img.field16 = NULL;
+    execute(plan);
+}
+
+int julia_plan_execute_field16(JuliaPlan* plan, uint16_t* field) {
+    if (!field16_fits(plan->args.n)) {
+        fprintf(stderr, "Iteration numbers of n = %u do not fit into a 16-bit field.\n", plan->args.n);
+        return -1;
+    }
+    plan->img.buffer = NULL;
+    plan->img.field = NULL;
+    plan->img.field16 = field;
+    execute(plan);
+    return 0;
+}
+
+void julia_plan_destroy(JuliaPlan* plan) {
+    free(plan);
+}
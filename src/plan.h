@@ -0,0 +1,56 @@
+#ifndef MY_PLAN
+#define MY_PLAN
+
+#include "julia.h"
+#include "util.h"
+#include "intrin_v1.h"
+
+//scratch structs of the less optimized implementation.
+//every thread rendering with the same plan needs its own.
+typedef struct {
+    four_complexes nums;
+    xmm_four_complexes xmms;
+} KernelScratch;
+
+//precomputed state of a render. Created once, executed any number of times.
+//All broadcast constants and scratch structs live inside the plan itself,
+//so julia_plan_execute does not allocate any memory.
+//JuliaParams and the plan functions are declared in the public header julia.h
+struct JuliaPlan {
+    JuliaParams params;
+    Arguments args;
+    Image img;
+    xmm_helpers helpers;
+    KernelScratch scratch; //scratch used by julia_plan_execute
+};
+
+/**
+ * @brief render a region of an image with the planned implementation.
+ * The plan is only read, so several threads can render different regions of the
+ * same plan at the same time as long as each uses its own scratch.
+ * 
+ * @param plan plan created by julia_plan_create
+ * @param img image to render into, a copy of plan->img with buffer or field set
+ * @param region pixels to compute
+ * @param scratch scratch structs of the calling thread
+ */
+void plan_render_region(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch);
+
+/**
+ * @return true if implementation uses fused multiply-add and is therefore bit-exact
+ * with the fma reference instead of the reference implementation
+ */
+bool implementation_uses_fma(int implementation);
+
+/**
+ * @return true if implementation can render the given iteration family.
+ * z^2 + c is supported by all implementations, the other families only by INTRIN_V0.
+ */
+bool implementation_supports_family(int implementation, int family);
+
+/**
+ * @brief fill params of a render of the given size with c, start, res, n and the iteration family of args
+ */
+void plan_params(JuliaParams* params, int implementation, Arguments* args, size_t width, size_t height);
+
+#endif
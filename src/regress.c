@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <unistd.h>
+
+#include "util.h"
+#include "plan.h"
+#include "performanz.h"
+#include "regress.h"
+
+//maximum number of scenarios in a baseline file
+#define MAX_SCENARIOS 4096
+#define NAME_LENGTH 64
+
+//fixed part of a scenario, every entry is run with every c value and every implementation
+typedef struct {
+    int size; //index into image_sizes[]
+    unsigned n;
+    bool file; //write bmp file after every render
+} scenario;
+
+static const scenario scenarios[] = {
+    {0, 100, false},
+    {0, 1000, false},
+    {0, 1000, true},
+    {1, 100, false},
+    {1, 100, true},
+};
+
+#define SCENARIO_COUNT ((int) (sizeof(scenarios) / sizeof(scenarios[0])))
+
+//result of one run of the suite
+typedef struct {
+    char name[NAME_LENGTH];
+    int scenario; //index into scenarios[]
+    int c; //index into c_values[]
+    int implementation;
+    double giter; //giter/s of fastest run
+    double giter_median; //giter/s of median run
+    double median; //median seconds per render
+    double min; //seconds of fastest render
+} regress_result;
+
+/**
+ * @brief run one scenario with given c value and implementation.
+ * Throughput is computed from the fastest and from the median of all timed runs.
+ * 
+ * @param sc scenario
+ * @param c index into c_values[]
+ * @param implementation version of julia algorithm
+ * @param path temporary bmp file for scenarios with file output
+ * @param r result is written here
+ */
+static void run_scenario(const scenario* sc, int c, int implementation, char* path, regress_result* r) {
+    float complex start = -1.5 + -1.5 * I;
+    size_t size = image_sizes[sc->size];
+
+    unsigned char* buffer = malloc(size * size * 3);
+    unsigned* field = malloc(size * size * sizeof(unsigned));
+    if (buffer == NULL || field == NULL) {
+        fprintf(stderr, "Could not allocate memory for an image sized %lu x %lu.\n", size, size);
+        exit(EXIT_FAILURE);
+    }
+
+    Arguments args;
+    Image img;
+    init_args(&args, c_values[c], start, 3.0f/size, sc->n);
+    init_img(&img, size, size, buffer, sc->n);
+
+    //iterations of this implementation, fma kernels iterate some pixels a different number of times
+    JuliaParams params;
+    plan_params(&params, implementation, &args, size, size);
+    JuliaPlan* plan = julia_plan_create(&params);
+    if (plan == NULL) {
+        exit(EXIT_FAILURE);
+    }
+    julia_plan_execute_field(plan, field);
+    julia_plan_destroy(plan);
+    unsigned long long iterations = count_iterations(field, size * size, args.n);
+
+    r->scenario = sc - scenarios;
+    r->c = c;
+    r->implementation = implementation;
+    snprintf(r->name, NAME_LENGTH, "V%d/%lux%lu/c%d/n%u/%s", implementation, size, size, c, sc->n,
+                                                                sc->file ? "file" : "nofile");
+    fprintf(stderr, "Running %s ...\n", r->name);
+
+    BenchResult result;
+    benchmark(implementation, &args, &img, REGRESS_WARMUP, REGRESS_REPETITIONS, sc->file ? path : NULL, &result);
+    r->median = result.median;
+    r->min = result.min;
+    r->giter = iterations / result.min * 1e-9;
+    r->giter_median = iterations / result.median * 1e-9;
+
+    free(buffer);
+    free(field);
+}
+
+/**
+ * @brief create temporary file for scenarios with file output. path is overwritten with its name.
+ */
+static void temporary_bmp(char* path) {
+    int fd = mkstemps(path, 4);
+    if (fd == -1) {
+        fprintf(stderr, "Could not create temporary file %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+}
+
+/**
+ * @brief run every scenario with every c value and selected implementation
+ * 
+ * @param kernels true for every implementation to run, kernel_count entries
+ * @param results results are written here, must hold SCENARIO_COUNT * 10 * kernel_count entries
+ * @return number of results
+ */
+static int run_scenarios(const bool* kernels, regress_result* results) {
+    char path[] = "/tmp/julia-regress-XXXXXX.bmp";
+    temporary_bmp(path);
+
+    int count = 0;
+    for (int s=0; s<SCENARIO_COUNT; s++) {
+        for (int c=0; c<10; c++) {
+            for (int k=0; k<kernel_count; k++) {
+                if (!kernels[k]) {
+                    continue;
+                }
+                run_scenario(&scenarios[s], c, k, path, &results[count++]);
+            }
+        }
+    }
+    remove(path);
+    return count;
+}
+
+static regress_result* alloc_results() {
+    regress_result* results = malloc(sizeof(regress_result) * SCENARIO_COUNT * 10 * kernel_count);
+    if (results == NULL) {
+        fprintf(stderr, "Could not allocate memory for regression results.\n");
+        exit(EXIT_FAILURE);
+    }
+    return results;
+}
+
+int write_baseline(char* path) {
+    bool kernels[kernel_count];
+    for (int k=0; k<kernel_count; k++) {
+        kernels[k] = julia_implementation_supported(k);
+    }
+    regress_result* results = alloc_results();
+    int count = run_scenarios(kernels, results);
+
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not create file %s.\n", path);
+        free(results);
+        return -1;
+    }
+
+    //one scenario per line, so that read_baseline does not need a complete json parser.
+    //baseline throughput is the one of a typical (median) run
+    fprintf(file, "{\"scenarios\": [\n");
+    for (int i=0; i<count; i++) {
+        fprintf(file, "  {\"scenario\": \"%s\", \"median_s\": %.9f, \"min_s\": %.9f, \"giter_per_s\": %.6f}%s\n",
+                results[i].name, results[i].median, results[i].min, results[i].giter_median,
+                (i == count - 1) ? "" : ",");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+    free(results);
+
+    printf("--> Baseline with %d scenarios written to %s.\n", count, path);
+    return 0;
+}
+
+/**
+ * @brief read scenarios written by write_baseline
+ * 
+ * @return number of scenarios read, -1 if file could not be opened
+ */
+static int read_baseline(char* path, regress_result* baseline) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open baseline file %s.\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) != NULL && count < MAX_SCENARIOS) {
+        char* name = strstr(line, "\"scenario\": \"");
+        char* median = strstr(line, "\"median_s\": ");
+        char* min = strstr(line, "\"min_s\": ");
+        char* giter = strstr(line, "\"giter_per_s\": ");
+        if (name == NULL || median == NULL || min == NULL || giter == NULL) {
+            continue;
+        }
+        regress_result* r = &baseline[count];
+        if (sscanf(name, "\"scenario\": \"%63[^\"]\"", r->name) == 1 &&
+            sscanf(median, "\"median_s\": %lf", &r->median) == 1 &&
+            sscanf(min, "\"min_s\": %lf", &r->min) == 1 &&
+            sscanf(giter, "\"giter_per_s\": %lf", &r->giter_median) == 1 && r->min > 0.0) {
+            //the file stores the throughput of the median run, the fastest run did the same iterations
+            r->giter = r->giter_median * r->median / r->min;
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+int compare_baseline(char* path, double threshold) {
+    regress_result* baseline = malloc(sizeof(regress_result) * MAX_SCENARIOS);
+    if (baseline == NULL) {
+        fprintf(stderr, "Could not allocate memory for regression results.\n");
+        exit(EXIT_FAILURE);
+    }
+    int baseline_count = read_baseline(path, baseline);
+    if (baseline_count < 0) {
+        free(baseline);
+        return -1;
+    }
+
+    //only kernels of the baseline are run, a kernel without baseline could not fail anyway
+    bool kernels[kernel_count];
+    for (int k=0; k<kernel_count; k++) {
+        kernels[k] = false;
+    }
+    for (int j=0; j<baseline_count; j++) {
+        int k;
+        if (sscanf(baseline[j].name, "V%d/", &k) == 1 && k >= 0 && k < kernel_count) {
+            kernels[k] = true;
+        }
+    }
+    for (int k=0; k<kernel_count; k++) {
+        if (kernels[k] && !julia_implementation_supported(k)) {
+            printf("%s is in the baseline, but not supported by this processor. It is not checked.\n", names[k]);
+            kernels[k] = false;
+        } else if (!kernels[k] && julia_implementation_supported(k)) {
+            printf("%s is not in the baseline and is not checked, record a new baseline to include it.\n",
+                                                                                                    names[k]);
+        }
+    }
+
+    regress_result* results = alloc_results();
+    int count = run_scenarios(kernels, results);
+
+    char bmp_path[] = "/tmp/julia-regress-XXXXXX.bmp";
+    temporary_bmp(bmp_path);
+
+    printf("%-36s %12s %12s %9s %8s\n", "scenario", "base Giter/s", "now Giter/s", "speedup", "status");
+    int failed = 0;
+    //geometric mean of speedups per kernel
+    double log_speedup[kernel_count];
+    int compared[kernel_count];
+    for (int k=0; k<kernel_count; k++) {
+        log_speedup[k] = 0.0;
+        compared[k] = 0;
+    }
+    for (int i=0; i<count; i++) {
+        regress_result* base = NULL;
+        for (int j=0; j<baseline_count; j++) {
+            if (strcmp(baseline[j].name, results[i].name) == 0) {
+                base = &baseline[j];
+                break;
+            }
+        }
+        if (base == NULL) {
+            //the baseline is older than the scenarios of its kernel
+            printf("%-36s %12s %12.4f %9s %8s\n", results[i].name, "-", results[i].giter, "-", "MISSING");
+            failed++;
+            continue;
+        }
+
+        //fastest run now is compared with the fastest run of the baseline. Noise from other processes
+        //only makes runs slower, so a real regression has to slow down even the fastest run.
+        //comparing with the median of the baseline would add the gap between median and fastest run
+        //(4-10%) as a speedup and hide regressions of that size
+        double speedup = results[i].giter / base->giter;
+        bool regression = (1.0 - speedup) * 100.0 > threshold;
+
+        //measure a slow scenario once more before reporting it, a single
+        //disturbance of the machine should not make the suite fail
+        if (regression) {
+            regress_result again;
+            run_scenario(&scenarios[results[i].scenario], results[i].c, results[i].implementation, bmp_path, &again);
+            if (again.giter > results[i].giter) {
+                results[i] = again;
+            }
+            speedup = results[i].giter / base->giter;
+            regression = (1.0 - speedup) * 100.0 > threshold;
+        }
+        if (regression) {
+            failed++;
+        }
+        log_speedup[results[i].implementation] += log(speedup);
+        compared[results[i].implementation]++;
+        printf("%-36s %12.4f %12.4f %8.3fx %8s\n", results[i].name, base->giter, results[i].giter, speedup,
+                                                    regression ? "FAILED" : "ok");
+    }
+
+    printf("\nGeometric mean speedup:");
+    const char* separator = " ";
+    for (int k=0; k<kernel_count; k++) {
+        if (compared[k] != 0) {
+            printf("%s%s %.3fx", separator, names[k], exp(log_speedup[k] / compared[k]));
+            separator = ", ";
+        }
+    }
+    printf("\n");
+
+    if (failed != 0) {
+        printf("\n--> Failed: %d of %d scenarios are missing in or more than %.1f%% slower than baseline %s.\n",
+                                                                            failed, count, threshold, path);
+    } else {
+        printf("\n--> Passed: no scenario is more than %.1f%% slower than baseline %s.\n", threshold, path);
+    }
+    remove(bmp_path);
+    free(baseline);
+    free(results);
+    return failed;
+}
@@ -0,0 +1,29 @@
+#ifndef MY_REGRESS
+#define MY_REGRESS
+
+//Default settings of the performance regression suite
+#define DEFAULT_THRESHOLD 15.0 //maximum allowed throughput drop in percent
+#define REGRESS_REPETITIONS 9 //timed runs per scenario, fastest run is compared
+#define REGRESS_WARMUP 2
+
+/**
+ * @brief run all regression scenarios and write the results into a baseline json file.
+ * 
+ * @param path path of baseline file
+ * @return 0 on success, -1 if file could not be written
+ */
+int write_baseline(char* path);
+
+/**
+ * @brief run all regression scenarios of the implementations in the given baseline file and compare
+ * their throughput. A diff of every scenario is printed. A scenario fails if it is missing in the
+ * baseline or if its throughput (giter/s of the fastest run) is more than threshold percent lower
+ * than the throughput of the fastest run in the baseline, also when measured again.
+ * 
+ * @param path path of baseline file created by write_baseline
+ * @param threshold maximum allowed throughput drop in percent
+ * @return number of failed scenarios, -1 if baseline could not be read
+ */
+int compare_baseline(char* path, double threshold);
+
+#endif
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "util.h"
+#include "plan.h"
+#include "trace.h"
+#include "render.h"
+
+//state shared by all workers of one render
+typedef struct {
+    JuliaPlan* plan;
+    Image img; //buffer or field to render into
+    band_function render_band;
+    void* context; //passed to render_band
+    size_t band_height;
+    size_t bands;
+    atomic_size_t next_band; //next band which is not taken by a worker yet
+} render_job;
+
+//state of one worker
+typedef struct {
+    render_job* job;
+    KernelScratch scratch;
+    char name[32];
+} render_worker;
+
+/**
+ * @brief take bands until all bands of the image are taken
+ */
+static void* render_worker_run(void* arg) {
+    render_worker* worker = arg;
+    render_job* job = worker->job;
+    Image img = job->img;
+
+    if (worker->name[0] != '\0') {
+        trace_thread_name(worker->name);
+    }
+    uint64_t worker_start = trace_now();
+
+    while (true) {
+        size_t band = atomic_fetch_add(&job->next_band, 1);
+        if (band >= job->bands) {
+            break;
+        }
+        Region region = {0, band * job->band_height, img.width, (band + 1) * job->band_height};
+        if (region.y1 > img.height) {
+            region.y1 = img.height;
+        }
+
+        uint64_t start = trace_now();
+        job->render_band(job->plan, &img, &region, &worker->scratch, job->context);
+        trace_event_rows("band", start, region.y0, region.y1);
+    }
+    trace_event("worker", worker_start);
+    if (worker->name[0] != '\0') {
+        trace_thread_done();
+    }
+    return NULL;
+}
+
+/**
+ * @brief band function of render_parallel, renders the band with the planned implementation
+ */
+static void render_planned_band(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch,
+                                                                                        void* context) {
+    (void) context;
+    plan_render_region(plan, img, region, scratch);
+}
+
+int render_parallel(JuliaPlan* plan, unsigned char* buffer, unsigned* field, uint16_t* field16, int threads,
+                                                                                        size_t band_height) {
+    Image img = plan->img;
+    img.buffer = buffer;
+    img.field = field;
+    img.field16 = field16;
+    return render_bands(plan, &img, threads, band_height, render_planned_band, NULL);
+}
+
+int render_bands(JuliaPlan* plan, const Image* img, int threads, size_t band_height, band_function render_band,
+                                                                                        void* context) {
+    render_job job;
+    job.plan = plan;
+    job.img = *img;
+    job.render_band = render_band;
+    job.context = context;
+    job.band_height = band_height;
+    job.bands = (job.img.height + band_height - 1) / band_height;
+    atomic_init(&job.next_band, 0);
+
+    //workers hold sse registers in their scratch, so they need 16-byte aligned memory
+    size_t size = (sizeof(render_worker) * threads + 15) & ~(size_t)0x0F;
+    render_worker* workers = aligned_alloc(16, size);
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    if (workers == NULL || ids == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d threads.\n", threads);
+        free(workers);
+        free(ids);
+        return -1;
+    }
+
+    int started = 0;
+    for (int t=0; t<threads; t++) {
+        workers[t].job = &job;
+        snprintf(workers[t].name, sizeof(workers[t].name), "worker %d", t);
+    }
+    //calling thread is worker 0 and keeps its own name in the trace.
+    //no thread is created for a single worker
+    workers[0].name[0] = '\0';
+    for (int t=1; t<threads; t++) {
+        //remaining workers take the bands of a thread which could not be created
+        if (pthread_create(&ids[t], NULL, render_worker_run, &workers[t]) != 0) {
+            fprintf(stderr, "Could not create thread %d, continuing with %d threads.\n", t, t);
+            break;
+        }
+        started++;
+    }
+    render_worker_run(&workers[0]);
+
+    for (int t=1; t<=started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    free(workers);
+    free(ids);
+    return 0;
+}
+
+//bands [first, end) of one node, its workers take them first
+typedef struct {
+    size_t first;
+    size_t end;
+    atomic_size_t next;
+} node_queue;
+
+//state shared by all workers of render_parallel_placed
+typedef struct {
+    JuliaPlan* plan;
+    Image img;
+    size_t band_height;
+    bool local;
+    bool touching; //first pass: write zeros into the rows of the own node instead of rendering
+    unsigned char* memory; //output written by the render
+    size_t row_bytes;
+    int workers_per_node[PLACEMENT_MAX_NODES];
+    node_queue queues[PLACEMENT_MAX_NODES]; //one per node if local, otherwise only the first
+    int queue_count;
+    int home_node; //node of the memory if not local
+    atomic_size_t remote;
+    atomic_size_t stolen;
+    atomic_int pin_failures;
+} placed_job;
+
+//state of one worker of render_parallel_placed
+typedef struct {
+    placed_job* job;
+    KernelScratch scratch;
+    int cpu; //-1: not pinned
+    int node;
+    int rank; //index among the workers of the node
+    char name[32];
+} placed_worker;
+
+/**
+ * @brief write zeros into the share of the worker of the rows of its node
+ */
+static void touch_rows(placed_job* job, placed_worker* worker) {
+    node_queue* queue = &job->queues[worker->node];
+    size_t y0 = queue->first * job->band_height;
+    size_t y1 = queue->end * job->band_height;
+    y1 = (y1 < job->img.height) ? y1 : job->img.height;
+    if (y0 >= y1) {
+        return;
+    }
+    size_t count = job->workers_per_node[worker->node];
+    size_t from = y0 + (y1 - y0) * worker->rank / count;
+    size_t to = y0 + (y1 - y0) * (worker->rank + 1) / count;
+    memset(job->memory + from * job->row_bytes, 0, (to - from) * job->row_bytes);
+}
+
+/**
+ * @brief take bands of the own node until they are gone, then of the other nodes
+ */
+static void* placed_worker_run(void* arg) {
+    placed_worker* worker = arg;
+    placed_job* job = worker->job;
+    Image img = job->img;
+
+    if (worker->name[0] != '\0') {
+        trace_thread_name(worker->name);
+    }
+    //failures are counted once, in the render pass
+    if (worker->cpu >= 0 && pin_thread(worker->cpu) != 0 && !job->touching) {
+        atomic_fetch_add(&job->pin_failures, 1);
+    }
+    if (job->touching) {
+        touch_rows(job, worker);
+        if (worker->name[0] != '\0') {
+            trace_thread_done();
+        }
+        return NULL;
+    }
+    uint64_t worker_start = trace_now();
+
+    int own = job->local ? worker->node : 0;
+    for (int step=0; step<job->queue_count; step++) {
+        int k = (own + step) % job->queue_count;
+        node_queue* queue = &job->queues[k];
+        while (true) {
+            size_t band = atomic_fetch_add(&queue->next, 1);
+            if (band >= queue->end) {
+                break;
+            }
+            Region region = {0, band * job->band_height, img.width, (band + 1) * job->band_height};
+            if (region.y1 > img.height) {
+                region.y1 = img.height;
+            }
+
+            uint64_t start = trace_now();
+            plan_render_region(job->plan, &img, &region, &worker->scratch);
+            trace_event_rows("band", start, region.y0, region.y1);
+            if ((job->local ? k : job->home_node) != worker->node) {
+                atomic_fetch_add(&job->remote, 1);
+            }
+            if (step > 0) {
+                atomic_fetch_add(&job->stolen, 1);
+            }
+        }
+    }
+    trace_event("worker", worker_start);
+    if (worker->name[0] != '\0') {
+        trace_thread_done();
+    }
+    return NULL;
+}
+
+/**
+ * @brief run placed_worker_run in all workers, the calling thread is worker 0
+ */
+static int run_placed_workers(placed_worker* workers, int threads) {
+    pthread_t* ids = malloc(sizeof(pthread_t) * threads);
+    if (ids == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d threads.\n", threads);
+        return -1;
+    }
+    int started = 0;
+    for (int t=1; t<threads; t++) {
+        //remaining workers take the bands of a thread which could not be created
+        if (pthread_create(&ids[t], NULL, placed_worker_run, &workers[t]) != 0) {
+            fprintf(stderr, "Could not create thread %d, continuing with %d threads.\n", t, t);
+            break;
+        }
+        started++;
+    }
+    AffinityMask* mask = affinity_save();
+    placed_worker_run(&workers[0]);
+    affinity_restore(mask);
+
+    for (int t=1; t<=started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    free(ids);
+    return 0;
+}
+
+int render_parallel_placed(JuliaPlan* plan, unsigned char* buffer, unsigned* field, uint16_t* field16, int threads,
+                                    size_t band_height, const Placement* placement, PlacementStats* stats) {
+    placed_job job;
+    job.plan = plan;
+    job.img = plan->img;
+    job.img.buffer = buffer;
+    job.img.field = field;
+    job.img.field16 = field16;
+    job.band_height = band_height;
+    job.local = placement->local;
+    if (field != NULL) {
+        job.memory = (unsigned char*) field;
+        job.row_bytes = job.img.width * sizeof(unsigned);
+    } else if (field16 != NULL) {
+        job.memory = (unsigned char*) field16;
+        job.row_bytes = job.img.width * sizeof(uint16_t);
+    } else {
+        job.memory = buffer;
+        job.row_bytes = job.img.width * 3;
+    }
+    atomic_init(&job.remote, 0);
+    atomic_init(&job.stolen, 0);
+    atomic_init(&job.pin_failures, 0);
+
+    //workers hold sse registers in their scratch, so they need 16-byte aligned memory
+    size_t size = (sizeof(placed_worker) * threads + 15) & ~(size_t)0x0F;
+    placed_worker* workers = aligned_alloc(16, size);
+    if (workers == NULL) {
+        fprintf(stderr, "Could not allocate memory for %d threads.\n", threads);
+        return -1;
+    }
+    int nodes = placement->topology.nodes;
+    for (int k=0; k<nodes; k++) {
+        job.workers_per_node[k] = 0;
+    }
+    for (int t=0; t<threads; t++) {
+        workers[t].job = &job;
+        placement_worker(placement, t, &workers[t].cpu, &workers[t].node);
+        workers[t].rank = job.workers_per_node[workers[t].node]++;
+        snprintf(workers[t].name, sizeof(workers[t].name), "worker %d (node %d)", t, workers[t].node);
+    }
+    workers[0].name[0] = '\0';
+    job.home_node = workers[0].node;
+
+    //contiguous ranges of bands, as many bands per node as it has workers
+    size_t bands = (job.img.height + band_height - 1) / band_height;
+    job.queue_count = job.local ? nodes : 1;
+    int before = 0;
+    for (int k=0; k<job.queue_count; k++) {
+        int with = job.local ? before + job.workers_per_node[k] : threads;
+        job.queues[k].first = bands * before / threads;
+        job.queues[k].end = bands * with / threads;
+        atomic_init(&job.queues[k].next, job.queues[k].first);
+        before = with;
+    }
+
+    int status = 0;
+    if (job.local) {
+        job.touching = true;
+        status = run_placed_workers(workers, threads);
+    }
+    job.touching = false;
+    if (status == 0) {
+        status = run_placed_workers(workers, threads);
+    }
+    free(workers);
+
+    if (stats != NULL) {
+        stats->bands = bands;
+        stats->remote_bands = atomic_load(&job.remote);
+        stats->stolen_bands = atomic_load(&job.stolen);
+        stats->pin_failures = atomic_load(&job.pin_failures);
+    }
+    return status;
+}
@@ -0,0 +1,79 @@
+#ifndef MY_RENDER
+#define MY_RENDER
+
+#include "plan.h"
+#include "placement.h"
+
+//rows per band, bands are the unit of work of the parallel renderer
+#define DEFAULT_BAND_HEIGHT 16
+
+/**
+ * @brief render the planned image with several threads.
+ * The image is split into bands of band_height rows. Workers take the next band with a
+ * single atomic increment, so fast workers take more bands and no locks are needed.
+ * Every worker uses its own scratch and image struct, the plan is only read.
+ * Each band and each worker is recorded in the trace if tracing is enabled.
+ * 
+ * @param plan plan of the render
+ * @param buffer rgb image buffer, NULL if field or field16 is given
+ * @param field iteration numbers are written here instead of rgb values if not NULL
+ * @param field16 16-bit iteration numbers are written here if not NULL, n must fit (see field16_fits)
+ * @param threads number of worker threads including the calling thread, 1 renders in the calling thread only
+ * @param band_height rows per band
+ * @return 0 on success, -1 if memory for workers could not be allocated
+ */
+int render_parallel(JuliaPlan* plan, unsigned char* buffer, unsigned* field, uint16_t* field16, int threads,
+                                                                                        size_t band_height);
+
+//where the bands of render_parallel_placed were rendered
+typedef struct {
+    size_t bands;
+    size_t remote_bands; //bands rendered on another node than the node holding their memory
+    size_t stolen_bands; //bands taken from the queue of another node
+    int pin_failures; //workers which could not be pinned to their processor
+} PlacementStats;
+
+/**
+ * @brief render_parallel with workers pinned to processors according to placement->affinity.
+ * With placement->local the bands are split into one contiguous range per NUMA node, sized by the
+ * number of workers on the node. In a first pass the workers of every node write zeros into the
+ * rows of their range, so that the pages of a fresh (untouched) buffer are placed on that node.
+ * In the render pass workers take bands of their own node first and only then steal from the
+ * other nodes, nearest node number first. Without local all workers share one queue like
+ * render_parallel and the memory is counted as belonging to the node of the calling thread.
+ * The calling thread is pinned as worker 0 and gets its affinity back afterwards.
+ *
+ * @param plan plan of the render
+ * @param buffer rgb image buffer, NULL if field or field16 is given
+ * @param field iteration numbers are written here instead of rgb values if not NULL
+ * @param field16 16-bit iteration numbers are written here if not NULL, n must fit (see field16_fits)
+ * @param threads number of worker threads including the calling thread
+ * @param band_height rows per band
+ * @param placement processors, nodes and affinity of the workers
+ * @param stats where the bands were rendered, may be NULL
+ * @return 0 on success, -1 if memory for workers could not be allocated
+ */
+int render_parallel_placed(JuliaPlan* plan, unsigned char* buffer, unsigned* field, uint16_t* field16, int threads,
+                                    size_t band_height, const Placement* placement, PlacementStats* stats);
+
+//renders one band of an image, called by several threads at once for different bands
+typedef void (*band_function)(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch,
+                                                                                        void* context);
+
+/**
+ * @brief split the image into bands of band_height rows and call render_band for every band from
+ * several threads, same scheduling as render_parallel. Used by renders which do not write
+ * iteration numbers, e.g. distance estimation.
+ * 
+ * @param plan plan of the render, passed to render_band
+ * @param img image passed to render_band (a copy per worker)
+ * @param threads number of worker threads including the calling thread
+ * @param band_height rows per band
+ * @param render_band function rendering one band
+ * @param context passed to render_band
+ * @return 0 on success, -1 if memory for workers could not be allocated
+ */
+int render_bands(JuliaPlan* plan, const Image* img, int threads, size_t band_height, band_function render_band,
+                                                                                        void* context);
+
+#endif
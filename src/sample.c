@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+
+#include "util.h"
+#include "intrin_v0.h"
+#include "intrin_family.h"
+#include "sample.h"
+
+void iterate_points(Arguments* args, xmm_helpers* helpers, const float* reals, const float* imags, size_t count,
+                                                                                            unsigned* values) {
+    if (args->family == FAMILY_QUADRATIC) {
+        julia_points(args, helpers, reals, imags, count, values);
+        return;
+    }
+    for (size_t i=0; i<count; i++) {
+        values[i] = iterate_family(reals[i], imags[i], args);
+    }
+}
+
+size_t sample_count(size_t width, size_t height, size_t stride) {
+    return ((width + stride - 1) / stride) * ((height + stride - 1) / stride);
+}
+
+/**
+ * @return pixel in the middle of block i of the given stride, clipped to size
+ */
+static size_t sample_position(size_t i, size_t stride, size_t size) {
+    size_t p = i * stride + stride / 2;
+    return (p < size) ? p : size - 1;
+}
+
+/**
+ * @brief iterate every sample as a group of lanes pixels starting at the sample pixel rounded down
+ * to a multiple of lanes
+ */
+static size_t sample_lanes(Arguments* args, size_t width, size_t height, size_t stride, size_t lanes,
+                                                                                        unsigned* values) {
+    size_t cols = (width + stride - 1) / stride;
+    size_t rows = (height + stride - 1) / stride;
+    size_t count = cols * rows * lanes;
+    float* reals = malloc(count * sizeof(float));
+    float* imags = malloc(count * sizeof(float));
+    if (reals == NULL || imags == NULL) {
+        fprintf(stderr, "Could not allocate memory for %lu samples.\n", count);
+        free(reals);
+        free(imags);
+        return 0;
+    }
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    for (size_t j=0; j<rows; j++) {
+        for (size_t i=0; i<cols; i++) {
+            size_t x = sample_position(i, stride, width) / lanes * lanes;
+            if (x + lanes > width) {
+                x = (width > lanes) ? width - lanes : 0;
+            }
+            size_t y = sample_position(j, stride, height);
+            for (size_t l=0; l<lanes; l++) {
+                size_t o = (j * cols + i) * lanes + l;
+                //same coordinates as the kernels
+                reals[o] = start_x + ((x + l < width) ? x + l : width - 1) * args->res;
+                imags[o] = start_y + y * args->res;
+            }
+        }
+    }
+    xmm_helpers helpers;
+    init_xmm_helpers(&helpers, args);
+    iterate_points(args, &helpers, reals, imags, count, values);
+    free(reals);
+    free(imags);
+    return cols * rows;
+}
+
+size_t sample_grid(Arguments* args, size_t width, size_t height, size_t stride, unsigned* values) {
+    return sample_lanes(args, width, height, stride, 1, values);
+}
+
+size_t sample_groups(Arguments* args, size_t width, size_t height, size_t stride, unsigned* values) {
+    return sample_lanes(args, width, height, stride, 4, values);
+}
@@ -0,0 +1,56 @@
+#ifndef MY_SAMPLE
+#define MY_SAMPLE
+
+#include "util.h"
+
+//pixels between two samples of a sparse pre-pass, in x and in y
+#define SAMPLE_STRIDE 16
+
+/**
+ * @brief iterate a list of arbitrary points with the kernel of the iteration family selected in args:
+ * julia_points for the quadratic family, iterate_family for the others.
+ *
+ * @param args julia arguments
+ * @param helpers helper registers created by init_xmm_helpers(helpers, args)
+ * @param reals real parts of the points
+ * @param imags imaginary parts of the points
+ * @param count number of points
+ * @param values iteration number of every point, BLACK for convergent points
+ */
+void iterate_points(Arguments* args, xmm_helpers* helpers, const float* reals, const float* imags, size_t count,
+                                                                                            unsigned* values);
+
+/**
+ * @return number of samples of a width x height image with the given stride,
+ * at least one sample per row and column of samples
+ */
+size_t sample_count(size_t width, size_t height, size_t stride);
+
+/**
+ * @brief sparse pre-pass: iterate one pixel out of every stride x stride block of the image (the pixel
+ * in the middle of the block, clipped to the image) with the point list kernel.
+ *
+ * @param args julia arguments, args->n is the iteration cap of the pre-pass
+ * @param width width of the image
+ * @param height height of the image
+ * @param stride distance of samples in pixels
+ * @param values iteration number of every sample, sample_count(width, height, stride) entries, row-major
+ * @return number of samples, 0 if memory could not be allocated
+ */
+size_t sample_grid(Arguments* args, size_t width, size_t height, size_t stride, unsigned* values);
+
+/**
+ * @brief same as sample_grid, but every sample is the group of 4 neighbouring pixels of the SIMD
+ * kernels containing the sample pixel (x rounded down to a multiple of 4, moved left at the right
+ * border). Images narrower than 4 pixels repeat their last pixel.
+ *
+ * @param args julia arguments, args->n is the iteration cap of the pre-pass
+ * @param width width of the image
+ * @param height height of the image
+ * @param stride distance of samples in pixels
+ * @param values iteration numbers, 4 per sample, 4 * sample_count(width, height, stride) entries
+ * @return number of samples, 0 if memory could not be allocated
+ */
+size_t sample_groups(Arguments* args, size_t width, size_t height, size_t stride, unsigned* values);
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <complex.h>
+
+#include "util.h"
+#include "plan.h"
+#include "render.h"
+#include "sample.h"
+#include "supersample.h"
+
+//state shared by all bands of one render_supersampled call
+typedef struct {
+    const unsigned* field; //iteration numbers of the 1x pass, NULL if field16 is used
+    const uint16_t* field16;
+    unsigned threshold;
+    atomic_ullong supersampled;
+    atomic_int failed; //memory for the sub-samples of a band could not be allocated
+} supersample_job;
+
+/**
+ * @return number of iterations of pixel o of the 1x pass, convergent pixels (BLACK) needed all n
+ */
+static unsigned iterations_at(const supersample_job* job, size_t o, unsigned n) {
+    unsigned value = (job->field != NULL) ? job->field[o] : job->field16[o];
+    return (value == BLACK) ? n : value;
+}
+
+/**
+ * @return true if the iteration number of pixel (x, y) differs from one of its 4 neighbours by more than threshold
+ */
+static bool high_variance(const supersample_job* job, const Image* img, size_t y, size_t x, unsigned n) {
+    size_t w = img->width;
+    size_t o = y * w + x;
+    unsigned it = iterations_at(job, o, n);
+    size_t neighbours[4];
+    int count = 0;
+    if (x > 0) neighbours[count++] = o - 1;
+    if (x + 1 < w) neighbours[count++] = o + 1;
+    if (y > 0) neighbours[count++] = o - w;
+    if (y + 1 < img->height) neighbours[count++] = o + w;
+
+    for (int i=0; i<count; i++) {
+        unsigned other = iterations_at(job, neighbours[i], n);
+        unsigned diff = (other > it) ? other - it : it - other;
+        if (diff > job->threshold) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @return uniformly distributed value in [0, 1) computed from key (integer hash, no state)
+ */
+static float jitter(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x7feb352dU;
+    key ^= key >> 15;
+    key *= 0x846ca68bU;
+    key ^= key >> 16;
+    return (key >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief write the SS_SAMPLES sub-sample coordinates of pixel (x, y) into reals and imags.
+ * Pixel (x, y) is at start + (x + y i) * res, its sub-samples cover [x - 0.5, x + 0.5) x [y - 0.5, y + 0.5)
+ */
+static void sub_samples(Arguments* args, size_t width, size_t y, size_t x, float* reals, float* imags) {
+    float start_x = crealf(args->start);
+    float start_y = cimagf(args->start);
+    uint32_t key = (uint32_t) ((y * width + x) * SS_SAMPLES);
+
+    for (int j=0; j<SS_GRID; j++) {
+        for (int i=0; i<SS_GRID; i++) {
+            int s = j * SS_GRID + i;
+            float dx = (i + jitter(2 * (key + s))) / SS_GRID - 0.5f;
+            float dy = (j + jitter(2 * (key + s) + 1)) / SS_GRID - 0.5f;
+            reals[s] = start_x + (x + dx) * args->res;
+            imags[s] = start_y + (y + dy) * args->res;
+        }
+    }
+}
+
+/**
+ * @brief color pixel (x, y) with the mean color of its sub-samples, same channels as color_pixel
+ */
+static void color_mean(Image* img, size_t y, size_t x, const unsigned* values) {
+    unsigned red = 0, green = 0, blue = 0;
+    for (int s=0; s<SS_SAMPLES; s++) {
+        unsigned char color = map_to_color(values[s], img->color_const);
+        red += color >> 1;
+        green += color >> 2;
+        blue += color;
+    }
+    unsigned o = offset(img, y, x);
+    img->buffer[o+2] = (red + SS_SAMPLES / 2) / SS_SAMPLES;
+    img->buffer[o+1] = (green + SS_SAMPLES / 2) / SS_SAMPLES;
+    img->buffer[o]   = (blue + SS_SAMPLES / 2) / SS_SAMPLES;
+}
+
+/**
+ * @brief band function of render_supersampled: colors the band from the 1x pass and supersamples
+ * its high variance pixels with one point list
+ */
+static void supersample_band(JuliaPlan* plan, Image* img, const Region* region, KernelScratch* scratch,
+                                                                                        void* context) {
+    (void) scratch;
+    supersample_job* job = context;
+    unsigned n = plan->args.n;
+
+    size_t selected = 0;
+    for (size_t y=region->y0; y<region->y1; y++) {
+        for (size_t x=region->x0; x<region->x1; x++) {
+            selected += high_variance(job, img, y, x, n);
+        }
+    }
+
+    float* reals = NULL;
+    float* imags = NULL;
+    unsigned* values = NULL;
+    if (selected != 0) {
+        reals = malloc(selected * SS_SAMPLES * sizeof(float));
+        imags = malloc(selected * SS_SAMPLES * sizeof(float));
+        values = malloc(selected * SS_SAMPLES * sizeof(unsigned));
+        if (reals == NULL || imags == NULL || values == NULL) {
+            atomic_store(&job->failed, 1);
+            selected = 0;
+        }
+    }
+
+    //pixels without sub-samples are colored right away, the others are collected in row-major order
+    size_t next = 0;
+    for (size_t y=region->y0; y<region->y1; y++) {
+        for (size_t x=region->x0; x<region->x1; x++) {
+            if (next < selected && high_variance(job, img, y, x, n)) {
+                sub_samples(&plan->args, img->width, y, x, reals + next * SS_SAMPLES, imags + next * SS_SAMPLES);
+                next++;
+            } else {
+                unsigned value = (job->field != NULL) ? job->field[y * img->width + x]
+                                                      : job->field16[y * img->width + x];
+                color_pixel(img, y, x, value);
+            }
+        }
+    }
+
+    if (selected != 0) {
+        iterate_points(&plan->args, &plan->helpers, reals, imags, selected * SS_SAMPLES, values);
+
+        //same order as above
+        next = 0;
+        for (size_t y=region->y0; y<region->y1 && next < selected; y++) {
+            for (size_t x=region->x0; x<region->x1 && next < selected; x++) {
+                if (high_variance(job, img, y, x, n)) {
+                    color_mean(img, y, x, values + next * SS_SAMPLES);
+                    next++;
+                }
+            }
+        }
+        atomic_fetch_add(&job->supersampled, selected);
+    }
+    free(reals);
+    free(imags);
+    free(values);
+}
+
+int render_supersampled(JuliaPlan* plan, unsigned char* buffer, unsigned threshold, int threads,
+                                                                                    SupersampleStats* stats) {
+    size_t width = plan->params.width;
+    size_t height = plan->params.height;
+    bool narrow = field16_fits(plan->args.n);
+
+    //1x pass, 16-bit iteration numbers if n allows it
+    void* field = malloc(width * height * (narrow ? sizeof(uint16_t) : sizeof(unsigned)));
+    if (field == NULL) {
+        fprintf(stderr, "Could not allocate memory for an iteration field sized %lu x %lu.\n", width, height);
+        return -1;
+    }
+    if (render_parallel(plan, NULL, narrow ? NULL : field, narrow ? field : NULL, threads, DEFAULT_BAND_HEIGHT) != 0) {
+        free(field);
+        return -1;
+    }
+
+    supersample_job job;
+    job.field = narrow ? NULL : field;
+    job.field16 = narrow ? field : NULL;
+    job.threshold = threshold;
+    atomic_init(&job.supersampled, 0);
+    atomic_init(&job.failed, 0);
+
+    Image img = plan->img;
+    img.buffer = buffer;
+    img.field = NULL;
+    img.field16 = NULL;
+    int result = render_bands(plan, &img, threads, DEFAULT_BAND_HEIGHT, supersample_band, &job);
+    free(field);
+    if (result != 0) {
+        return -1;
+    }
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Could not allocate memory for sub-samples.\n");
+        return -1;
+    }
+
+    stats->pixels = (unsigned long long) width * height;
+    stats->supersampled = atomic_load(&job.supersampled);
+    stats->samples = stats->pixels + stats->supersampled * SS_SAMPLES;
+    return 0;
+}
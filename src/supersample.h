@@ -0,0 +1,40 @@
+#ifndef MY_SUPERSAMPLE
+#define MY_SUPERSAMPLE
+
+#include "util.h"
+#include "plan.h"
+
+//supersampled pixels are covered by a jittered SS_GRID x SS_GRID grid of sub-samples
+#define SS_GRID 4
+#define SS_SAMPLES (SS_GRID * SS_GRID)
+//pixels whose iteration number differs from a neighbour by more than this are supersampled
+#define SS_DEFAULT_THRESHOLD 4
+
+//work done by render_supersampled
+typedef struct {
+    unsigned long long pixels; //pixels of the image, each one sampled once at 1x
+    unsigned long long supersampled; //pixels which got SS_SAMPLES additional sub-samples
+    unsigned long long samples; //all iterated points: pixels + supersampled * SS_SAMPLES
+} SupersampleStats;
+
+/**
+ * @brief adaptive anti-aliasing. Renders the iteration numbers of the planned image at 1x first,
+ * then only pixels whose iteration number differs from one of their 4 neighbours by more than
+ * threshold are supersampled: every such pixel gets SS_SAMPLES sub-samples at jittered positions of
+ * a grid over the pixel, and its color is the mean color of the sub-samples. Every other pixel is
+ * colored as without supersampling.
+ * The sub-samples of all supersampled pixels of a band are collected into one list and iterated
+ * with julia_points, so registers are always full even if single pixels are supersampled.
+ * Jitter is derived from the pixel position, the image does not depend on the number of threads.
+ *
+ * @param plan plan of the render, the 1x pass uses the planned implementation
+ * @param buffer rgb image buffer of the planned size
+ * @param threshold allowed difference of iteration numbers of neighbouring pixels
+ * @param threads number of threads including the calling thread
+ * @param stats number of pixels and samples is written here
+ * @return 0 on success, -1 if memory could not be allocated or workers could not be created
+ */
+int render_supersampled(JuliaPlan* plan, unsigned char* buffer, unsigned threshold, int threads,
+                                                                                    SupersampleStats* stats);
+
+#endif
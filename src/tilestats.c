@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "util.h"
+#include "plan.h"
+#include "bmp.h"
+#include "tilestats.h"
+
+//largest n for which the 32-bit sums of the TILE_SIZE / 4 pixels of every lane in a row of a tile fit
+#define TILE_SSE_MAX_N (UINT32_MAX / (TILE_SIZE / 4))
+
+/**
+ * @return seconds elapsed between start and end
+ */
+static double elapsed(struct timespec* start, struct timespec* end) {
+    return end->tv_sec - start->tv_sec + 1e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief write statistics of every tile as csv
+ */
+static int write_tiles_csv(char* path, TileStats* tiles, size_t tiles_x, size_t tiles_y, Image* img) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not create file %s.\n", path);
+        return -1;
+    }
+    fprintf(file, "tile_x,tile_y,x0,y0,width,height,iterations,max,interior,seconds\n");
+    for (size_t ty=0; ty<tiles_y; ty++) {
+        for (size_t tx=0; tx<tiles_x; tx++) {
+            TileStats* t = &tiles[ty * tiles_x + tx];
+            size_t x0 = tx * TILE_SIZE;
+            size_t y0 = ty * TILE_SIZE;
+            size_t w = (x0 + TILE_SIZE < img->width) ? TILE_SIZE : img->width - x0;
+            size_t h = (y0 + TILE_SIZE < img->height) ? TILE_SIZE : img->height - y0;
+            fprintf(file, "%lu,%lu,%lu,%lu,%lu,%lu,%llu,%u,%u,%.9f\n", tx, ty, x0, y0, w, h,
+                                                        t->iterations, t->max, t->interior, t->seconds);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief write histogram of iteration numbers as csv. Bin 0 holds convergent pixels (BLACK).
+ */
+static int write_histogram_csv(char* path, unsigned long long* histogram, unsigned n) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not create file %s.\n", path);
+        return -1;
+    }
+    fprintf(file, "iterations,pixels\n");
+    for (unsigned i=0; i<n; i++) {
+        if (histogram[i] != 0) {
+            fprintf(file, "%u,%llu\n", i, histogram[i]);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief write heatmap of iterations per tile as image of the same size as the rendered image.
+ * Every pixel gets the color of its tile, from blue (cheap) to red (most expensive tile).
+ */
+static int write_heatmap(char* path, TileStats* tiles, size_t tiles_x, Image* img) {
+    unsigned long long max = 1;
+    size_t tiles_y = (img->height + TILE_SIZE - 1) / TILE_SIZE;
+    for (size_t i=0; i<tiles_x * tiles_y; i++) {
+        if (tiles[i].iterations > max) {
+            max = tiles[i].iterations;
+        }
+    }
+
+    unsigned char* heatmap = malloc(img->width * img->height * 3);
+    if (heatmap == NULL) {
+        fprintf(stderr, "Could not allocate memory for heatmap.\n");
+        return -1;
+    }
+    for (size_t y=0; y<img->height; y++) {
+        for (size_t x=0; x<img->width; x++) {
+            TileStats* t = &tiles[(y / TILE_SIZE) * tiles_x + x / TILE_SIZE];
+            unsigned char heat = (unsigned char) (255.0 * t->iterations / max);
+            unsigned o = offset(img, y, x);
+            heatmap[o+2] = heat; //red
+            heatmap[o+1] = 0; //green
+            heatmap[o] = 255 - heat; //blue
+        }
+    }
+    int status = generateBitmapImage(heatmap, img->height, img->width, path);
+    free(heatmap);
+    return status;
+}
+
+/**
+ * @brief add iteration sum, maximum and number of convergent pixels of a tile to t.
+ * 4 pixels are processed at once with sse instructions, up to TILE_SSE_MAX_N iterations.
+ * Above, the 32-bit sums of a row could overflow, so all pixels are processed one by one.
+ * 
+ * @param field iteration numbers of the image
+ * @param width width of the image
+ * @param region pixels of the tile
+ * @param n maximum number of iterations, counted for convergent pixels
+ * @param t statistics of the tile
+ */
+static void tile_stats(const unsigned* field, size_t width, const Region* region, unsigned n, TileStats* t) {
+    size_t count = region->x1 - region->x0;
+    size_t vectors = (n <= TILE_SSE_MAX_N) ? count / 4 : 0;
+    __m128i ns = _mm_set1_epi32(n);
+    __m128i zeros = _mm_setzero_si128();
+    __m128i sum = zeros; //2 x 64 bit
+    __m128i max = zeros;
+    __m128i interior = zeros;
+
+    for (size_t y=region->y0; y<region->y1; y++) {
+        const unsigned* row = field + y * width + region->x0;
+        __m128i row_sum = zeros;
+        for (size_t v=0; v<vectors; v++) {
+            __m128i iterations = _mm_loadu_si128((const __m128i*) (row + 4 * v));
+            //all bits set for convergent pixels
+            __m128i black = _mm_cmpeq_epi32(iterations, zeros);
+            //convergent pixels needed n iterations
+            iterations = _mm_add_epi32(iterations, _mm_and_si128(black, ns));
+            //subtract -1 for every convergent pixel
+            interior = _mm_sub_epi32(interior, black);
+            row_sum = _mm_add_epi32(row_sum, iterations);
+            //sse2 has no max instruction for 32 bit integers, select with a mask instead.
+            //the signed compare is right, iteration numbers are below 2^31
+            __m128i greater = _mm_cmpgt_epi32(iterations, max);
+            max = _mm_or_si128(_mm_and_si128(greater, iterations), _mm_andnot_si128(greater, max));
+        }
+        //widen the sums of the row to 64 bit
+        sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(row_sum, zeros));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(row_sum, zeros));
+
+        for (size_t x=4*vectors; x<count; x++) {
+            unsigned iterations = (row[x] == BLACK) ? n : row[x];
+            t->interior += (row[x] == BLACK);
+            t->iterations += iterations;
+            if (iterations > t->max) {
+                t->max = iterations;
+            }
+        }
+    }
+
+    unsigned long long sums[2];
+    unsigned maxs[4];
+    unsigned interiors[4];
+    _mm_storeu_si128((__m128i*) sums, sum);
+    _mm_storeu_si128((__m128i*) maxs, max);
+    _mm_storeu_si128((__m128i*) interiors, interior);
+    t->iterations += sums[0] + sums[1];
+    for (int i=0; i<4; i++) {
+        t->interior += interiors[i];
+        if (maxs[i] > t->max) {
+            t->max = maxs[i];
+        }
+    }
+}
+
+int render_tile_stats(JuliaPlan* plan, unsigned char* buffer, char* prefix) {
+    Image img = plan->img;
+    unsigned n = plan->args.n;
+    size_t tiles_x = (img.width + TILE_SIZE - 1) / TILE_SIZE;
+    size_t tiles_y = (img.height + TILE_SIZE - 1) / TILE_SIZE;
+
+    unsigned* field = malloc(img.width * img.height * sizeof(unsigned));
+    TileStats* tiles = calloc(tiles_x * tiles_y, sizeof(TileStats));
+    unsigned long long* histogram = calloc(n + 1, sizeof(unsigned long long));
+    unsigned* lanes[4];
+    lanes[0] = calloc(4 * (size_t) (n + 1), sizeof(unsigned));
+    if (field == NULL || tiles == NULL || histogram == NULL || lanes[0] == NULL) {
+        fprintf(stderr, "Could not allocate memory for tile statistics.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i=1; i<4; i++) {
+        lanes[i] = lanes[0] + i * (size_t) (n + 1);
+    }
+
+    img.buffer = NULL;
+    img.field = field;
+    double total = 0.0;
+
+    struct timespec loop_start;
+    struct timespec loop_end;
+    clock_gettime(CLOCK_MONOTONIC, &loop_start);
+
+    for (size_t ty=0; ty<tiles_y; ty++) {
+        for (size_t tx=0; tx<tiles_x; tx++) {
+            Region region = {tx * TILE_SIZE, ty * TILE_SIZE, (tx + 1) * TILE_SIZE, (ty + 1) * TILE_SIZE};
+            if (region.x1 > img.width) {
+                region.x1 = img.width;
+            }
+            if (region.y1 > img.height) {
+                region.y1 = img.height;
+            }
+
+            struct timespec start;
+            struct timespec end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            plan_render_region(plan, &img, &region, &plan->scratch);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            //tile is still in cache, collecting its statistics is cheap compared to computing it
+            TileStats* t = &tiles[ty * tiles_x + tx];
+            t->seconds = elapsed(&start, &end);
+            total += t->seconds;
+            tile_stats(field, img.width, &region, n, t);
+            for (size_t y=region.y0; y<region.y1; y++) {
+                const unsigned* row = &field[y * img.width];
+
+                //neighbouring pixels mostly have the same iteration number. incrementing the same
+                //histogram bin again and again waits for the previous increment every time,
+                //so neighbouring pixels count into 4 interleaved histograms, merged at the end.
+                size_t x = region.x0;
+                for (; x + 3 < region.x1; x += 4) {
+                    lanes[0][row[x]]++;
+                    lanes[1][row[x + 1]]++;
+                    lanes[2][row[x + 2]]++;
+                    lanes[3][row[x + 3]]++;
+                }
+                for (; x < region.x1; x++) {
+                    lanes[0][row[x]]++;
+                }
+            }
+        }
+    }
+
+    for (unsigned i=0; i<=n; i++) {
+        histogram[i] = (unsigned long long) lanes[0][i] + lanes[1][i] + lanes[2][i] + lanes[3][i];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &loop_end);
+    //time spent on anything else than computing tiles: timers and collecting statistics
+    double overhead = (elapsed(&loop_start, &loop_end) - total) / total * 100.0;
+
+    img.buffer = buffer;
+    color_field(&img, field);
+
+    size_t length = strlen(prefix) + 32;
+    char* path = malloc(length);
+    if (path == NULL) {
+        fprintf(stderr, "Could not allocate memory for file name.\n");
+        exit(EXIT_FAILURE);
+    }
+    int status = 0;
+    snprintf(path, length, "%s_tiles.csv", prefix);
+    status |= write_tiles_csv(path, tiles, tiles_x, tiles_y, &img);
+    snprintf(path, length, "%s_histogram.csv", prefix);
+    status |= write_histogram_csv(path, histogram, n);
+    snprintf(path, length, "%s_heatmap.bmp", prefix);
+    status |= write_heatmap(path, tiles, tiles_x, &img);
+
+    printf("Tile statistics: %lu x %lu tiles of %d x %d pixels, kernel time %f s, collection overhead %.2f%%\n",
+                                            tiles_x, tiles_y, TILE_SIZE, TILE_SIZE, total, overhead);
+    printf("--> %s_tiles.csv, %s_histogram.csv and %s_heatmap.bmp are created.\n", prefix, prefix, prefix);
+
+    free(path);
+    free(field);
+    free(tiles);
+    free(histogram);
+    free(lanes[0]);
+    return status;
+}
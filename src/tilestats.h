@@ -0,0 +1,30 @@
+#ifndef MY_TILESTATS
+#define MY_TILESTATS
+
+#include "plan.h"
+
+//edge length of a tile in pixels
+#define TILE_SIZE 32
+
+//statistics of one tile
+typedef struct {
+    unsigned long long iterations; //sum of iterations of all pixels (convergent pixels count n)
+    unsigned max; //maximum iterations of a pixel
+    unsigned interior; //number of convergent (BLACK) pixels
+    double seconds; //wall time spent computing the tile
+} TileStats;
+
+/**
+ * @brief render the planned image tile by tile and collect statistics of every tile
+ * and a histogram of iteration numbers of the whole image.
+ * Writes <prefix>_tiles.csv, <prefix>_heatmap.bmp and <prefix>_histogram.csv.
+ * Colors the image into buffer afterwards, as julia_plan_execute would do.
+ * 
+ * @param plan plan of the render
+ * @param buffer rgb image buffer of size width * height * 3
+ * @param prefix prefix of the written files
+ * @return 0 on success, -1 if a file could not be written
+ */
+int render_tile_stats(JuliaPlan* plan, unsigned char* buffer, char* prefix);
+
+#endif
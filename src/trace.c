@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "trace.h"
+
+//number of events a thread buffer can hold at first, doubled when full
+#define TRACE_INITIAL_EVENTS 4096
+
+typedef struct {
+    const char* name;
+    uint64_t start; //ns
+    uint64_t duration; //ns
+    long y0; //rows of the event, -1 if not set
+    long y1;
+} trace_record;
+
+//events of one thread. only the owning thread writes into its buffer.
+//a named buffer is given back by trace_thread_done and taken again by the next thread of the same name.
+typedef struct {
+    int tid;
+    char thread_name[32]; //empty if not named
+    atomic_bool in_use;
+    trace_record* records;
+    size_t count;
+    size_t capacity;
+} trace_buffer;
+
+static atomic_bool enabled = false;
+static uint64_t origin; //start time given to trace_enable, all timestamps are relative to it
+
+//buffers of all threads. a thread reserves its slot with a single atomic increment.
+static trace_buffer* _Atomic buffers[TRACE_MAX_THREADS];
+static atomic_int buffer_count = 0;
+static _Thread_local trace_buffer* local = NULL;
+
+uint64_t trace_now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+void trace_enable(uint64_t start) {
+    origin = start;
+    atomic_store(&enabled, true);
+}
+
+bool trace_enabled() {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+/**
+ * @brief get buffer of calling thread, create and register it on first use
+ * @return buffer or NULL if too many threads or out of memory
+ */
+static trace_buffer* local_buffer() {
+    if (local != NULL) {
+        return local;
+    }
+    int slot = atomic_fetch_add(&buffer_count, 1);
+    if (slot >= TRACE_MAX_THREADS) {
+        return NULL;
+    }
+    trace_buffer* buffer = malloc(sizeof(trace_buffer));
+    trace_record* records = malloc(sizeof(trace_record) * TRACE_INITIAL_EVENTS);
+    if (buffer == NULL || records == NULL) {
+        free(buffer);
+        free(records);
+        return NULL;
+    }
+    buffer->tid = slot;
+    buffer->thread_name[0] = '\0';
+    atomic_init(&buffer->in_use, true);
+    buffer->records = records;
+    buffer->count = 0;
+    buffer->capacity = TRACE_INITIAL_EVENTS;
+    buffers[slot] = buffer;
+    local = buffer;
+    return buffer;
+}
+
+void trace_thread_name(const char* name) {
+    if (!trace_enabled()) {
+        return;
+    }
+    if (local == NULL) {
+        //take the buffer of a finished thread of the same name, e.g. worker 1 of the previous render
+        int count = atomic_load(&buffer_count);
+        for (int i=0; i<count && i<TRACE_MAX_THREADS; i++) {
+            trace_buffer* buffer = atomic_load(&buffers[i]);
+            if (buffer == NULL || atomic_exchange(&buffer->in_use, true)) {
+                continue;
+            }
+            if (strcmp(buffer->thread_name, name) == 0) {
+                local = buffer;
+                return;
+            }
+            atomic_store(&buffer->in_use, false);
+        }
+    }
+    trace_buffer* buffer = local_buffer();
+    if (buffer != NULL) {
+        snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+    }
+}
+
+void trace_thread_done() {
+    if (local != NULL) {
+        atomic_store(&local->in_use, false);
+        local = NULL;
+    }
+}
+
+void trace_event_rows(const char* name, uint64_t start, long y0, long y1) {
+    if (!trace_enabled()) {
+        return;
+    }
+    uint64_t end = trace_now();
+    trace_buffer* buffer = local_buffer();
+    if (buffer == NULL) {
+        return;
+    }
+    if (buffer->count == buffer->capacity) {
+        trace_record* records = realloc(buffer->records, sizeof(trace_record) * buffer->capacity * 2);
+        if (records == NULL) {
+            return;
+        }
+        buffer->records = records;
+        buffer->capacity *= 2;
+    }
+    trace_record* r = &buffer->records[buffer->count++];
+    r->name = name;
+    r->start = start;
+    r->duration = end - start;
+    r->y0 = y0;
+    r->y1 = y1;
+}
+
+void trace_event(const char* name, uint64_t start) {
+    trace_event_rows(name, start, -1, -1);
+}
+
+int trace_write(char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not create file %s.\n", path);
+        return -1;
+    }
+
+    atomic_store(&enabled, false);
+    int count = atomic_load(&buffer_count);
+    if (count > TRACE_MAX_THREADS) {
+        count = TRACE_MAX_THREADS;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"julia\"}}");
+    for (int i=0; i<count; i++) {
+        trace_buffer* buffer = atomic_load(&buffers[i]);
+        if (buffer == NULL) {
+            continue;
+        }
+        if (buffer->thread_name[0] != '\0') {
+            fprintf(file, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                          "\"args\": {\"name\": \"%s\"}}", buffer->tid, buffer->thread_name);
+        }
+        for (size_t j=0; j<buffer->count; j++) {
+            trace_record* r = &buffer->records[j];
+            //timestamps in microseconds
+            fprintf(file, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    r->name, buffer->tid, (r->start - origin) / 1000.0, r->duration / 1000.0);
+            if (r->y0 >= 0) {
+                fprintf(file, ", \"args\": {\"y0\": %ld, \"y1\": %ld}", r->y0, r->y1);
+            }
+            fprintf(file, "}");
+        }
+        free(buffer->records);
+        free(buffer);
+        atomic_store(&buffers[i], NULL);
+    }
+    fprintf(file, "\n]}\n");
+    atomic_store(&buffer_count, 0);
+    local = NULL;
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Error: Could not write file %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
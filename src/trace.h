@@ -0,0 +1,64 @@
+#ifndef MY_TRACE
+#define MY_TRACE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//maximum number of threads which can record events
+#define TRACE_MAX_THREADS 256
+
+/**
+ * @brief enable recording of trace events. Must be called before any event is recorded.
+ * 
+ * @param start time from trace_now, which is shown as time 0 in the timeline
+ */
+void trace_enable(uint64_t start);
+
+/**
+ * @return true if trace events are recorded
+ */
+bool trace_enabled();
+
+/**
+ * @return current time in nanoseconds, used as start of an event
+ */
+uint64_t trace_now();
+
+/**
+ * @brief name the calling thread in the timeline. The name is copied. A thread which gets the name of
+ * a thread finished with trace_thread_done continues its timeline row.
+ */
+void trace_thread_name(const char* name);
+
+/**
+ * @brief give the buffer of a named thread back before the thread exits, so repeated renders do not
+ * use up TRACE_MAX_THREADS. Its events are kept until trace_write.
+ */
+void trace_thread_done();
+
+/**
+ * @brief record a complete event of the calling thread from start until now.
+ * Events are appended to a buffer owned by the calling thread, no locks are taken.
+ * Does nothing if tracing is not enabled.
+ * 
+ * @param name name of the event, must stay valid until trace_write
+ * @param start start time, from trace_now
+ */
+void trace_event(const char* name, uint64_t start);
+
+/**
+ * @brief same as trace_event, with the rows [y0, y1) of the image as arguments
+ */
+void trace_event_rows(const char* name, uint64_t start, long y0, long y1);
+
+/**
+ * @brief write all recorded events in Chrome trace event format (json), readable by
+ * chrome://tracing and Perfetto. Must only be called when all recording threads have finished.
+ * Frees all buffers and disables tracing.
+ * 
+ * @param path path of json file
+ * @return 0 on success, -1 if file could not be written
+ */
+int trace_write(char* path);
+
+#endif
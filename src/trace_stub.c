@@ -0,0 +1,43 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+//trace.c for libjulia: the timeline of trace.c needs global state, so the library records nothing.
+//render.c calls the same functions in both builds.
+
+void trace_enable(uint64_t start) {
+    (void) start;
+}
+
+bool trace_enabled() {
+    return false;
+}
+
+uint64_t trace_now() {
+    return 0;
+}
+
+void trace_thread_name(const char* name) {
+    (void) name;
+}
+
+void trace_thread_done() {
+}
+
+void trace_event(const char* name, uint64_t start) {
+    (void) name;
+    (void) start;
+}
+
+void trace_event_rows(const char* name, uint64_t start, long y0, long y1) {
+    (void) name;
+    (void) start;
+    (void) y0;
+    (void) y1;
+}
+
+int trace_write(char* path) {
+    (void) path;
+    return -1;
+}
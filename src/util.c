@@ -4,18 +4,9 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <math.h>
-#include <time.h>
+#include <stdlib.h>
 
-//Implementation versions
-#define INTRIN_V0 0 //optimized SIMD version
-#define INTRIN_V1 1 //less optimized SIMD version
-#define NAIVE 2
-
-//special value to use instead of iteration number for convergent pixels
-#define BLACK 0
-
-bool CORRECTNESS_TEST = false;
-unsigned* CORRECTNESS_BUFFER = NULL;
+#include "util.h"
 
 const size_t image_sizes[10] = {500, 1000, 1500, 2000, 2500, 3000, 3500, 4000, 4500, 5000};
 
@@ -23,25 +14,45 @@ const float complex c_values[10] = {-0.53 + 0.5 * I, -0.2 + 0.685 * I, 0.33 + 0.
                                 0.23 + -0.525 * I, 0 + -0.64 * I, -1.02 + -0.254 * I, -0.8 + -0.154 * I,
                                 -0.745 + 0.03 * I, 0.33 + 0.4 * I};
 
-typedef struct {
-    float complex c;
-    float complex start;
-    float res;
-    unsigned n;
-    float radius_sqr; //r^2, helper variable (escape radius squared)
-} Arguments;
+float complex get_random_c(unsigned* seed) {
+    return c_values[rand_r(seed) % 10];
+}
 
-typedef struct {
-    size_t width;
-    size_t height;
-    unsigned char* buffer;
-    float color_const; //equals 255/N. used in map_to_color()
-} Image;
+void init_args(Arguments* args, float complex c, float complex start, float res, unsigned n) {
+    args->c = c;
+    args->start = start;
+    args->res = res;
+    args->n = n;
+    float c_betrag = sqrtf(crealf(c) * crealf(c) + cimagf(c) * cimagf(c));
+    float radius = (c_betrag > 2) ? c_betrag : 2; //r = max{|c|, 2}
+    args->radius_sqr = radius*radius;
+    args->family = FAMILY_QUADRATIC;
+    args->degree = 2;
+    args->bailout = 0.0f;
+}
 
-float complex get_random_c() {
-    time_t t;
-    srand((unsigned) time(&t));
-    return c_values[rand() % 10];
+int init_family(Arguments* args, int family, unsigned degree, float bailout) {
+    if (family == FAMILY_MULTIBROT && (degree < MULTIBROT_MIN_DEGREE || degree > MULTIBROT_MAX_DEGREE)) {
+        fprintf(stderr, "Invalid argument. Degree of multibrot family must be between %d and %d.\n",
+                                                                MULTIBROT_MIN_DEGREE, MULTIBROT_MAX_DEGREE);
+        return -1;
+    }
+    if (family != FAMILY_QUADRATIC && family != FAMILY_MULTIBROT && family != FAMILY_BURNING_SHIP) {
+        fprintf(stderr, "Invalid argument. There is no iteration family with id %d\n", family);
+        return -1;
+    }
+    //points inside a smaller radius could still come back, iteration numbers would be wrong
+    if (bailout != 0.0f && bailout * bailout < args->radius_sqr) {
+        fprintf(stderr, "Invalid argument. Escape radius %f is smaller than max{|c|, 2}.\n", bailout);
+        return -1;
+    }
+    args->family = family;
+    args->degree = (family == FAMILY_MULTIBROT) ? degree : 2;
+    args->bailout = bailout;
+    if (bailout != 0.0f) {
+        args->radius_sqr = bailout * bailout;
+    }
+    return 0;
 }
 
 Arguments* get_args(float complex c, float complex start, float res, unsigned n) {
@@ -51,16 +62,20 @@ Arguments* get_args(float complex c, float complex start, float res, unsigned n)
         fprintf(stderr, "Could not allocate memory for arguments struct.\n");
         exit(1);
     }
-    args->c = c;
-    args->start = start;
-    args->res = res;
-    args->n = n;
-    float c_betrag = sqrtf(crealf(c) * crealf(c) + cimagf(c) * cimagf(c));
-    float radius = (c_betrag > 2) ? c_betrag : 2; //r = max{|c|, 2}
-    args->radius_sqr = radius*radius;
+    init_args(args, c, start, res, n);
     return args;
 }
 
+void init_img(Image* img, size_t width, size_t height, unsigned char* buffer, unsigned n) {
+    img->width = width;
+    img->height = height;
+    img->buffer = buffer;
+    img->field = NULL;
+    img->field16 = NULL;
+    img->window = full_region(img);
+    img->color_const = 255.0f / n;
+}
+
 Image* get_img(size_t width, size_t height, unsigned char* img, unsigned n) {
     Image* my_img = malloc(sizeof(Image));
 
@@ -68,13 +83,24 @@ Image* get_img(size_t width, size_t height, unsigned char* img, unsigned n) {
         fprintf(stderr, "Could not allocate memory for image struct.\n");
         exit(1);       
     }
-    my_img->width = width;
-    my_img->height = height;
-    my_img->buffer = img;
-    my_img->color_const = 255.0f / n;
+    init_img(my_img, width, height, img, n);
     return my_img;
 }
 
+Region full_region(Image* img) {
+    Region region = {0, 0, img->width, img->height};
+    return region;
+}
+
+void init_xmm_helpers(xmm_helpers* helpers, Arguments* args) {
+    helpers->cre = _mm_set1_ps(crealf(args->c));
+    helpers->cim = _mm_set1_ps(cimagf(args->c));
+    helpers->twos = _mm_set1_ps(2.0f);
+    helpers->ones = _mm_set1_epi32(1);
+    helpers->ns = _mm_set1_epi32(args->n);
+    helpers->radius_sqr = _mm_set1_ps(args->radius_sqr);
+}
+
 unsigned char map_to_color(unsigned iterations, float color_const) {
     if (iterations == BLACK) {
         return 0;
@@ -87,10 +113,15 @@ unsigned offset(Image* img, size_t y, size_t x) {
 }
 
 void color_pixel(Image* img, size_t y, size_t x, unsigned iterations) {
-    //if correctness test mode is enabled, write iterations number into correctness buffer and return.
-    if (CORRECTNESS_TEST) {
-        unsigned offset = y * img->width + x;
-        CORRECTNESS_BUFFER[offset] = iterations;
+    //if an iteration field is given, write iterations number into the field and return.
+    if (img->field != NULL) {
+        Region* w = &img->window;
+        img->field[(y - w->y0) * (w->x1 - w->x0) + x - w->x0] = iterations;
+        return;
+    }
+    if (img->field16 != NULL) {
+        Region* w = &img->window;
+        img->field16[(y - w->y0) * (w->x1 - w->x0) + x - w->x0] = iterations;
         return;
     }
     unsigned char color = map_to_color(iterations, img->color_const);
@@ -102,6 +133,34 @@ void color_pixel(Image* img, size_t y, size_t x, unsigned iterations) {
     img->buffer[o]   = color;  //blue
 }
 
+void color_field(Image* img, const unsigned* field) {
+    for (size_t y=0; y<img->height; y++) {
+        for (size_t x=0; x<img->width; x++) {
+            unsigned char color = map_to_color(field[y * img->width + x], img->color_const);
+            unsigned o = offset(img, y, x);
+
+            //black - lila coloring, same as color_pixel
+            img->buffer[o+2] = color >> 1; //red
+            img->buffer[o+1] = color >> 2;  //green
+            img->buffer[o]   = color;  //blue
+        }
+    }
+}
+
+void color_field16(Image* img, const uint16_t* field) {
+    for (size_t y=0; y<img->height; y++) {
+        for (size_t x=0; x<img->width; x++) {
+            unsigned char color = map_to_color(field[y * img->width + x], img->color_const);
+            unsigned o = offset(img, y, x);
+
+            //black - lila coloring, same as color_pixel
+            img->buffer[o+2] = color >> 1; //red
+            img->buffer[o+1] = color >> 2;  //green
+            img->buffer[o]   = color;  //blue
+        }
+    }
+}
+
 //Print functions for debugging
 void print_complex(float complex num) {
     printf("Zi = %.5f + %.5f i\n", crealf(num), cimagf(num));
@@ -1,23 +1,14 @@
 #ifndef MY_UTILS
 #define MY_UTILS
 
+#include <complex.h>
 #include <immintrin.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-//Implementation versions
-#define INTRIN_V0 0 //optimized SIMD version
-#define INTRIN_V1 1 //less optimized SIMD version
-#define NAIVE 2
-
-//special value to use instead of iteration number for convergent pixels
-#define BLACK 0
-
-//set this global variable true, so that color_pixel works in correctness test mode.
-//Which means color_pixel will not write rgb values into image buffer, instead it will write 
-//given 'unsigned iterations' argument into global array CORRECTNESS_BUFFER.
-//So that we will be able to compare different implementations by computed iteration numbers.
-extern bool CORRECTNESS_TEST;
-extern unsigned* CORRECTNESS_BUFFER;
+//implementation versions and BLACK are defined in the public header
+#include "julia.h"
 
 //10 different image sizes (for performance comparison and correctness test)
 extern const size_t image_sizes[10];
@@ -31,19 +22,54 @@ typedef struct {
     float res;
     unsigned n;
     float radius_sqr; //r^2, helper variable (escape radius squared)
+    int family; //iteration family, FAMILY_QUADRATIC by default
+    unsigned degree; //exponent of FAMILY_MULTIBROT
+    float bailout; //escape radius given by user, 0 if radius is max{|c|,2}
 } Arguments;
 
+//rectangle of pixels [x0, x1) x [y0, y1) of an image, e.g. a tile.
+//kernels compute only the pixels inside the region.
+typedef struct {
+    size_t x0;
+    size_t y0;
+    size_t x1;
+    size_t y1;
+} Region;
+
 typedef struct {
     size_t width;
     size_t height;
     unsigned char* buffer;
+    //if not NULL, color_pixel does not write rgb values into buffer, instead it writes
+    //the iteration number of each pixel into this array (width * height entries, row-major).
+    //So that we are able to compare different implementations by computed iteration numbers.
+    unsigned* field;
+    //same as field with 16-bit entries, used if not NULL and field is NULL.
+    //only valid if n <= FIELD16_MAX_N (see field16_fits)
+    uint16_t* field16;
+    //part of the image stored in field or field16. pixel (x, y) is written to
+    //field[(y - window.y0) * (window.x1 - window.x0) + x - window.x0], so a tile can be
+    //rendered into a buffer of its own size. complete image by default (see init_img).
+    Region window;
     float color_const; //equals 255/N. used in map_to_color()
 } Image;
 
+//sse registers filled with constants used by the SIMD kernels.
+//broadcast once per render (see init_xmm_helpers) and reused for every pixel.
+typedef struct {
+    __m128 cre; //filled with real parts of c
+    __m128 cim; //imaginary part
+    __m128 twos; //filled with 2 constants
+    __m128i ones; //filled with 1 constants
+    __m128i ns;   //filled with n (max iter) contants 
+    __m128 radius_sqr; //filled with r^2 with r = max{|c|, 2}
+} xmm_helpers;
+
 /**
+ * @param seed state of the random number generator, updated on every call (see rand_r)
  * @return returns a random c value from 10 selected fixed c values
  */
-float complex get_random_c();
+float complex get_random_c(unsigned* seed);
 
 /**
  * @brief get Arguments struct with given parameters.
@@ -52,11 +78,43 @@ float complex get_random_c();
  */
 Arguments* get_args(float complex c, float complex start, float res, unsigned n);
 
+/**
+ * @brief same as get_args, but fills an already existing struct instead of allocating one.
+ */
+void init_args(Arguments* args, float complex c, float complex start, float res, unsigned n);
+
+/**
+ * @brief select iteration family and escape radius of args initialised by init_args.
+ * For |z| > max{|c|, 2} all families escape, so bailout must not be smaller.
+ * 
+ * @param args julia arguments
+ * @param family FAMILY_QUADRATIC, FAMILY_MULTIBROT or FAMILY_BURNING_SHIP
+ * @param degree exponent of FAMILY_MULTIBROT, ignored for other families
+ * @param bailout escape radius, 0 keeps max{|c|, 2}
+ * @return 0 on success, -1 if family, degree or bailout are invalid
+ */
+int init_family(Arguments* args, int family, unsigned degree, float bailout);
+
 /**
  * @brief Get the Image struct with given parameters
  */
 Image* get_img(size_t width, size_t height, unsigned char* img, unsigned n);
 
+/**
+ * @brief same as get_img, but fills an already existing struct instead of allocating one.
+ */
+void init_img(Image* img, size_t width, size_t height, unsigned char* buffer, unsigned n);
+
+/**
+ * @brief region covering the complete image
+ */
+Region full_region(Image* img);
+
+/**
+ * @brief broadcast c, escape radius and other constants of given arguments into helper registers
+ */
+void init_xmm_helpers(xmm_helpers* helpers, Arguments* args);
+
 /**
  * @brief this function takes how many steps it takes for a series 
  * to get out of escape radius and maps it to a value [0,255]
@@ -83,7 +141,7 @@ unsigned offset(Image* img, size_t y, size_t x);
 
 /**
  * @brief coloring function. gets the iteration steps number as argument and colors the corresponding pixel
- * When working in CORRECTNESS_TEST mode, writes iteration number into CORRECTNESS_BUFFER and returns.
+ * If img->field or img->field16 is set, writes iteration number into the field and returns.
  * 
  * @param img struct containing info about image
  * @param y coordinate [0,height]
@@ -92,6 +150,90 @@ unsigned offset(Image* img, size_t y, size_t x);
  */
 void color_pixel(Image* img, size_t y, size_t x, unsigned iterations);
 
+/**
+ * @brief color every pixel of the image from already computed iteration numbers.
+ * Gives the same image as coloring the pixels directly while iterating.
+ * 
+ * @param img struct containing info about image, rgb values are written into img->buffer
+ * @param field iteration numbers, width * height entries, row-major
+ */
+void color_field(Image* img, const unsigned* field);
+
+/**
+ * @brief same as color_field for 16-bit iteration numbers
+ * 
+ * @param img struct containing info about image, rgb values are written into img->buffer
+ * @param field iteration numbers, width * height entries, row-major
+ */
+void color_field16(Image* img, const uint16_t* field);
+
+/**
+ * @return true if iteration numbers of n iterations fit into a 16-bit field
+ */
+static inline bool field16_fits(unsigned n) {
+    return n <= FIELD16_MAX_N;
+}
+
+/**
+ * @brief pack 4 iteration numbers (at most 65535) into the lower 4 16-bit lanes
+ */
+static inline __m128i pack_field16(__m128i values) {
+#ifdef __SSE4_1__
+    return _mm_packus_epi32(values, values);
+#else
+    //sse2 can only pack with signed saturation: shift 0..65535 into the signed range and back
+    __m128i biased = _mm_sub_epi32(values, _mm_set1_epi32(0x8000));
+    return _mm_xor_si128(_mm_packs_epi32(biased, biased), _mm_set1_epi16((short) 0x8000));
+#endif
+}
+
+/**
+ * @brief map the iteration counts of 4 lanes to the values passed into color_pixel:
+ * a count of n becomes BLACK and a count of 0 (point was already outside) becomes 1.
+ * 
+ * @param iterations number of iterations each lane stayed in the escape radius
+ * @param helpers helper registers of the render, ns holds n
+ */
+static inline __m128i lane_values(__m128i iterations, const xmm_helpers* helpers) {
+    __m128i convergent = _mm_cmpeq_epi32(iterations, helpers->ns);
+    __m128i outside = _mm_cmpeq_epi32(iterations, _mm_setzero_si128());
+    //BLACK is 0: clear convergent lanes, subtracting the compare result (-1) turns 0 into 1
+    return _mm_sub_epi32(_mm_andnot_si128(convergent, iterations), outside);
+}
+
+/**
+ * @brief write the iteration counts of the 4 neighbouring pixels (x .. x+3, y) computed by a SIMD kernel.
+ * Counts are mapped with lane_values, same mapping as the scalar loops of the kernels.
+ * Fields are written with one vector store,
+ * 16-bit fields are packed first. Otherwise every pixel goes through color_pixel.
+ * 
+ * @param img image data
+ * @param y row of the pixels
+ * @param x first pixel
+ * @param iterations number of iterations each pixel stayed in the escape radius
+ * @param helpers helper registers of the render, ns holds n
+ */
+static inline void store_lanes(Image* img, size_t y, size_t x, __m128i iterations, const xmm_helpers* helpers) {
+    __m128i values = lane_values(iterations, helpers);
+
+    const Region* w = &img->window;
+    size_t o = (y - w->y0) * (w->x1 - w->x0) + x - w->x0;
+    //same precedence as color_pixel, which writes the remaining columns
+    if (img->field != NULL) {
+        _mm_storeu_si128((__m128i*) (img->field + o), values);
+        return;
+    }
+    if (img->field16 != NULL) {
+        _mm_storel_epi64((__m128i*) (img->field16 + o), pack_field16(values));
+        return;
+    }
+    unsigned results[4];
+    _mm_storeu_si128((__m128i*) results, values);
+    for (int i=0; i<4; i++) {
+        color_pixel(img, y, x + i, results[i]);
+    }
+}
+
 //Print functions for debugging
 void print_complex(float complex num);
 